@@ -0,0 +1,753 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "indexer/indexer.h"
+#include "indexer/unicode_tokenizer.h"
+
+#include "corpus.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+	std::optional<std::regex> filter;
+	std::string filterSource{"all"};
+	std::size_t repetitions{3};
+	bool json{false};
+	std::filesystem::path out;
+
+	Bench::CorpusConfig corpus;
+	std::filesystem::path corpusDir{std::filesystem::temp_directory_path() / "indexer_bench_corpus"};
+	bool keepCorpus{false};
+
+	std::size_t searchQueries{1000};
+	std::size_t churnFiles{200};
+	std::size_t churnBurst{10};
+};
+
+struct Result
+{
+	std::string name;
+	std::string runName;
+	std::string aggregate;  // empty for plain runs
+	std::size_t repetitions;
+	std::size_t repetitionIndex;
+	std::size_t iterations;
+	double realTime;  // ns per iteration
+	std::vector<std::pair<std::string, double>> counters;
+};
+
+double nanoseconds(Clock::duration duration)
+{
+	return std::chrono::duration<double, std::nano>(duration).count();
+}
+
+double percentile(std::vector<double> sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0;
+	}
+	std::sort(sorted.begin(), sorted.end());
+	auto rank = static_cast<std::size_t>(std::ceil(p / 100 * static_cast<double>(sorted.size())));
+	return sorted[std::clamp(rank, std::size_t{1}, sorted.size()) - 1];
+}
+
+double peakRss()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return static_cast<double>(counters.PeakWorkingSetSize);
+#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return static_cast<double>(usage.ru_maxrss) * 1024;  // kilobytes on Linux
+#endif
+}
+
+std::string readFile(std::filesystem::path const& path)
+{
+	std::ifstream fin{path, std::ios::binary};
+	std::string contents(std::filesystem::file_size(path), '\0');
+	fin.read(contents.data(), static_cast<std::streamsize>(contents.size()));
+	contents.resize(static_cast<std::size_t>(fin.gcount()));
+	return contents;
+}
+
+class Runner
+{
+public:
+	Runner(Options const& options_, Bench::Corpus const& corpus_)
+		: options{options_}
+		, corpus{corpus_}
+	{
+	}
+
+	void run()
+	{
+		benchmark("BM_WordTokenizer", [this](std::size_t i, std::size_t n){ benchTokenizer<Indexer::WordTokenizer>("BM_WordTokenizer", i, n); });
+		benchmark("BM_UnicodeTokenizer", [this](std::size_t i, std::size_t n){ benchTokenizer<Indexer::UnicodeTokenizer>("BM_UnicodeTokenizer", i, n); });
+		benchmark("BM_AddPath", [this](std::size_t i, std::size_t n){ benchAddPath("BM_AddPath", std::nullopt, i, n); });
+		benchmark("BM_AddPath/bulk", [this](std::size_t i, std::size_t n){ benchAddPath("BM_AddPath/bulk", Indexer::BulkLoad{}, i, n); });
+		benchmark("BM_Search/common", [this](std::size_t i, std::size_t n){ benchSearch("BM_Search/common", commonTerms(), i, n, exactSearch()); });
+		benchmark("BM_Search/rare", [this](std::size_t i, std::size_t n){ benchSearch("BM_Search/rare", rareTerms(), i, n, exactSearch()); });
+		benchmark("BM_Search/scoped", [this](std::size_t i, std::size_t n){ benchSearch("BM_Search/scoped", commonTerms(), i, n, scopedSearch()); });
+		benchmark("BM_FuzzySearch/d1", [this](std::size_t i, std::size_t n){ benchSearch("BM_FuzzySearch/d1", misspelledTerms(), i, n, fuzzySearch(1)); });
+		benchmark("BM_FuzzySearch/d2", [this](std::size_t i, std::size_t n){ benchSearch("BM_FuzzySearch/d2", misspelledTerms(), i, n, fuzzySearch(2)); });
+		benchmark("BM_Reindex/churn", [this](std::size_t i, std::size_t n){ benchReindex(i, n); });
+		benchmark("BM_AddPath/wal", [this](std::size_t i, std::size_t n){ benchAddPath("BM_AddPath/wal", std::nullopt, i, n, true); });
+		benchmark("BM_Restart", [this](std::size_t i, std::size_t n){ benchRestart(i, n); });
+		removeSnapshot();
+	}
+
+	std::vector<Result> const& results() const { return allResults; }
+
+private:
+	void benchmark(std::string const& name, std::function<void(std::size_t, std::size_t)> const& body)
+	{
+		if (options.filter && not std::regex_search(name, *options.filter))
+		{
+			return;
+		}
+
+		auto first = allResults.size();
+		for (std::size_t i = 0; i < options.repetitions; i++)
+		{
+			body(i, options.repetitions);
+		}
+		if (options.repetitions > 1)
+		{
+			addAggregates(first);
+		}
+	}
+
+	void report(Result result)
+	{
+		result.counters.emplace_back("peak_rss", peakRss());
+		allResults.push_back(std::move(result));
+		if (not options.json)
+		{
+			printConsole(allResults.back());
+		}
+	}
+
+	void addAggregates(std::size_t first)
+	{
+		std::vector<Result> runs{allResults.begin() + static_cast<std::ptrdiff_t>(first), allResults.end()};
+
+		auto aggregate = [&](std::string const& kind, auto&& reduce) {
+			auto result = runs.front();
+			result.name = result.runName + "_" + kind;
+			result.aggregate = kind;
+			result.realTime = reduce([](Result const& r){ return r.realTime; });
+			for (std::size_t c = 0; c < result.counters.size(); c++)
+			{
+				result.counters[c].second = reduce([c](Result const& r){ return r.counters[c].second; });
+			}
+			allResults.push_back(result);
+			if (not options.json)
+			{
+				printConsole(allResults.back());
+			}
+		};
+
+		auto values = [&](auto&& field) {
+			std::vector<double> v;
+			for (auto const& r: runs)
+			{
+				v.push_back(field(r));
+			}
+			return v;
+		};
+
+		aggregate("mean", [&](auto&& field) {
+			auto v = values(field);
+			return std::accumulate(v.begin(), v.end(), 0.0) / static_cast<double>(v.size());
+		});
+		aggregate("median", [&](auto&& field) { return percentile(values(field), 50); });
+		aggregate("stddev", [&](auto&& field) {
+			auto v = values(field);
+			auto mean = std::accumulate(v.begin(), v.end(), 0.0) / static_cast<double>(v.size());
+			auto sum = 0.0;
+			for (auto x: v)
+			{
+				sum += (x - mean) * (x - mean);
+			}
+			return std::sqrt(sum / static_cast<double>(v.size() - 1));
+		});
+	}
+
+	template <class T>
+	void benchTokenizer(std::string const& name, std::size_t repetition, std::size_t repetitions)
+	{
+		if (contents.empty())
+		{
+			for (auto const& file: corpus.files)
+			{
+				contents.push_back(readFile(file));
+			}
+		}
+
+		T tokenizer;
+		std::size_t tokens = 0;
+		std::size_t bytes = 0;
+		auto start = Clock::now();
+		for (auto const& text: contents)
+		{
+			std::string_view rest = text;
+			while (not rest.empty())
+			{
+				auto lineEnd = std::min(rest.find('\n'), rest.size());
+				tokenizer.sendLine(rest.substr(0, lineEnd));
+				while (not tokenizer.done())
+				{
+					auto token = tokenizer.next();
+					tokens += not token.empty();
+				}
+				rest.remove_prefix(std::min(lineEnd + 1, rest.size()));
+			}
+			tokenizer.sendEof();
+			bytes += text.size();
+		}
+		auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+		report({
+			name, name, "", repetitions, repetition, contents.size(), elapsed * 1e9 / static_cast<double>(contents.size()),
+			{{"bytes_per_second", static_cast<double>(bytes) / elapsed}, {"items_per_second", static_cast<double>(tokens) / elapsed}},
+		});
+	}
+
+	void benchAddPath(std::string const& name, std::optional<Indexer::BulkLoad> bulkLoad, std::size_t repetition, std::size_t repetitions,
+		bool isPersisted = false)
+	{
+		indexer.reset();  // a fresh index each time, the old one must not be watching meanwhile
+
+		indexer = std::make_unique<Indexer::Indexer>();
+		if (isPersisted)  // every file added is logged
+		{
+			removeSnapshot();
+			indexer->persist(snapshotFile());
+		}
+		auto start = Clock::now();
+		if (bulkLoad)
+		{
+			indexer->addPath(corpus.root, Indexer::Recursive::Yes, *bulkLoad);
+		}
+		else
+		{
+			indexer->addPath(corpus.root, Indexer::Recursive::Yes);
+		}
+		auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+		report({
+			name, name, "", repetitions, repetition, 1, elapsed * 1e9,
+			{
+				{"bytes_per_second", static_cast<double>(corpus.totalBytes) / elapsed},
+				{"items_per_second", static_cast<double>(corpus.files.size()) / elapsed},
+			},
+		});
+	}
+
+	// restoring a persisted index and adding the unchanged corpus again, which only stats its files
+	void benchRestart(std::size_t repetition, std::size_t repetitions)
+	{
+		if (repetition == 0)
+		{
+			indexer.reset();
+			removeSnapshot();
+			indexer = std::make_unique<Indexer::Indexer>();
+			indexer->persist(snapshotFile());
+			indexer->addPath(corpus.root, Indexer::Recursive::Yes);
+			indexer->publishSnapshot(snapshotFile());
+		}
+		indexer.reset();
+
+		indexer = std::make_unique<Indexer::Indexer>();
+		auto start = Clock::now();
+		indexer->persist(snapshotFile());
+		indexer->addPath(corpus.root, Indexer::Recursive::Yes);
+		auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+		report({
+			"BM_Restart", "BM_Restart", "", repetitions, repetition, 1, elapsed * 1e9,
+			{{"items_per_second", static_cast<double>(corpus.files.size()) / elapsed}},
+		});
+	}
+
+	std::filesystem::path snapshotFile() const
+	{
+		return options.corpusDir.parent_path() / "indexer_bench_snapshot";
+	}
+
+	void removeSnapshot() const
+	{
+		std::error_code errorCode;
+		std::filesystem::remove(snapshotFile(), errorCode);
+		std::filesystem::remove(std::filesystem::path{snapshotFile()}.concat(".wal"), errorCode);
+	}
+
+	Indexer::Indexer& builtIndexer()
+	{
+		if (not indexer)
+		{
+			indexer = std::make_unique<Indexer::Indexer>();
+			indexer->addPath(corpus.root, Indexer::Recursive::Yes);
+		}
+		return *indexer;
+	}
+
+	std::vector<std::string> commonTerms() const
+	{
+		auto count = std::min<std::size_t>(16, corpus.vocabulary.size());
+		return {corpus.vocabulary.begin(), corpus.vocabulary.begin() + static_cast<std::ptrdiff_t>(count)};
+	}
+
+	std::vector<std::string> rareTerms() const
+	{
+		// words that made it into the corpus only once or twice
+		std::vector<std::string> terms;
+		for (auto rank = corpus.vocabulary.size(); rank-- > 0 && terms.size() < 16; )
+		{
+			if (corpus.occurrences[rank] > 0 && corpus.occurrences[rank] <= 2)
+			{
+				terms.push_back(corpus.vocabulary[rank]);
+			}
+		}
+		return terms;
+	}
+
+	// words across the frequency range with one letter changed
+	std::vector<std::string> misspelledTerms() const
+	{
+		std::vector<std::string> terms;
+		auto stride = std::max<std::size_t>(1, corpus.vocabulary.size() / 16);
+		for (std::size_t rank = 0; rank < corpus.vocabulary.size() && terms.size() < 16; rank += stride)
+		{
+			auto term = corpus.vocabulary[rank];
+			if (term.size() >= 4)
+			{
+				auto& c = term[term.size() / 2];
+				c = c == 'z' ? 'a' : static_cast<char>(c + 1);
+				terms.push_back(term);
+			}
+		}
+		return terms;
+	}
+
+	using Search = std::function<Indexer::PathSet(Indexer::Indexer const&, std::string const&)>;
+
+	static Search exactSearch()
+	{
+		return [](auto const& index, auto const& term) { return index.search(term); };
+	}
+
+	// in the first of the corpus' directories
+	Search scopedSearch() const
+	{
+		auto directory = corpus.files.empty() ? corpus.root : corpus.files.front().parent_path();
+		return [directory](auto const& index, auto const& term) { return index.search(term, directory); };
+	}
+
+	static Search fuzzySearch(unsigned maxDistance)
+	{
+		return [maxDistance](auto const& index, auto const& term) { return index.searchFuzzy(term, maxDistance); };
+	}
+
+	void benchSearch(std::string const& name, std::vector<std::string> const& terms, std::size_t repetition, std::size_t repetitions,
+		Search const& search)
+	{
+		if (terms.empty())
+		{
+			return;
+		}
+
+		auto& index = builtIndexer();
+		std::vector<double> latencies;
+		latencies.reserve(options.searchQueries);
+		std::size_t hits = 0;
+		for (std::size_t i = 0; i < options.searchQueries; i++)
+		{
+			auto start = Clock::now();
+			auto found = search(index, terms[i % terms.size()]);
+			latencies.push_back(nanoseconds(Clock::now() - start));
+			hits += found.size();
+		}
+
+		auto mean = std::accumulate(latencies.begin(), latencies.end(), 0.0) / static_cast<double>(latencies.size());
+		report({
+			name, name, "", repetitions, repetition, latencies.size(), mean,
+			{
+				{"p50_ns", percentile(latencies, 50)},
+				{"p90_ns", percentile(latencies, 90)},
+				{"p99_ns", percentile(latencies, 99)},
+				{"max_ns", percentile(latencies, 100)},
+				{"hits_per_query", static_cast<double>(hits) / static_cast<double>(latencies.size())},
+			},
+		});
+	}
+
+	// rewrites files in bursts and measures how long each takes to become searchable
+	void benchReindex(std::size_t repetition, std::size_t repetitions)
+	{
+		auto& index = builtIndexer();
+		Bench::Random random{options.corpus.seed + 1 + repetition};
+		Bench::ZipfSampler zipf{corpus.vocabulary.size(), options.corpus.zipfExponent};
+
+		struct Pending
+		{
+			std::filesystem::path file;
+			std::string marker;
+			Clock::time_point writtenAt;
+		};
+
+		std::vector<double> latencies;
+		std::size_t timeouts = 0;
+		for (std::size_t done = 0; done < options.churnFiles; )
+		{
+			std::vector<Pending> pending;
+			for (std::size_t i = 0; i < options.churnBurst && done < options.churnFiles; i++, done++)
+			{
+				auto const& file = corpus.files[random.below(corpus.files.size())];
+				if (std::any_of(pending.begin(), pending.end(), [&](auto const& p){ return p.file == file; }))
+				{
+					continue;
+				}
+
+				// uppercase never occurs in the generated vocabulary
+				auto marker = "CHURN" + std::to_string(repetition) + "X" + std::to_string(done);
+				auto text = marker + "\n";
+				for (std::size_t line = 0; line < 32; line++)
+				{
+					text += Bench::generateLine(random, zipf, corpus.vocabulary, 1 + random.below(12));
+				}
+				std::ofstream{file, std::ios::binary} << text;
+				pending.push_back({file, marker, Clock::now()});
+			}
+
+			auto deadline = Clock::now() + 5s;
+			while (not pending.empty() && Clock::now() < deadline)
+			{
+				std::erase_if(pending, [&](Pending const& p) {
+					if (not index.search(p.marker).contains(p.file))
+					{
+						return false;
+					}
+					latencies.push_back(nanoseconds(Clock::now() - p.writtenAt));
+					return true;
+				});
+				std::this_thread::sleep_for(100us);
+			}
+			timeouts += pending.size();
+		}
+
+		auto mean = latencies.empty() ? 0.0 : std::accumulate(latencies.begin(), latencies.end(), 0.0) / static_cast<double>(latencies.size());
+		report({
+			"BM_Reindex/churn", "BM_Reindex/churn", "", repetitions, repetition, latencies.size(), mean,
+			{
+				{"p50_ns", percentile(latencies, 50)},
+				{"p90_ns", percentile(latencies, 90)},
+				{"p99_ns", percentile(latencies, 99)},
+				{"max_ns", percentile(latencies, 100)},
+				{"timeouts", static_cast<double>(timeouts)},
+			},
+		});
+	}
+
+	static std::string humanReadable(double value, std::string const& suffix, bool binary)
+	{
+		constexpr char const* prefixes[] = {"", "k", "M", "G", "T"};
+		auto base = binary ? 1024.0 : 1000.0;
+		std::size_t i = 0;
+		for (; i + 1 < std::size(prefixes) && std::abs(value) >= base; i++)
+		{
+			value /= base;
+		}
+		std::ostringstream out;
+		out << std::setprecision(value < 100 ? 3 : 4) << value << prefixes[i] << (binary && i > 0 ? "i" : "") << suffix;
+		return out.str();
+	}
+
+	static std::string formatTime(double ns)
+	{
+		constexpr char const* units[] = {"ns", "us", "ms", "s"};
+		std::size_t i = 0;
+		for (; i + 1 < std::size(units) && ns >= 1000; i++)
+		{
+			ns /= 1000;
+		}
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(ns < 10 ? 2 : 0) << ns << " " << units[i];
+		return out.str();
+	}
+
+	void printConsole(Result const& result)
+	{
+		if (not printedHeader)
+		{
+			std::cout << std::string(100, '-') << "\n"
+				<< std::left << std::setw(32) << "Benchmark" << std::right << std::setw(14) << "Time" << std::setw(12) << "Iterations" << " UserCounters...\n"
+				<< std::string(100, '-') << "\n";
+			printedHeader = true;
+		}
+
+		std::cout << std::left << std::setw(32) << result.name << std::right << std::setw(14) << formatTime(result.realTime)
+			<< std::setw(12) << (result.aggregate.empty() ? std::to_string(result.iterations) : std::to_string(result.repetitions));
+		for (auto const& [counter, value]: result.counters)
+		{
+			std::cout << " " << counter << "=";
+			if (counter == "peak_rss")
+			{
+				std::cout << humanReadable(value, "B", true);
+			}
+			else if (counter == "bytes_per_second")
+			{
+				std::cout << humanReadable(value, "B/s", true);
+			}
+			else if (counter == "items_per_second")
+			{
+				std::cout << humanReadable(value, "/s", false);
+			}
+			else if (counter.ends_with("_ns"))
+			{
+				std::cout << formatTime(value);
+			}
+			else
+			{
+				std::cout << humanReadable(value, "", false);
+			}
+		}
+		std::cout << "\n";
+	}
+
+	Options const& options;
+	Bench::Corpus const& corpus;
+
+	std::unique_ptr<Indexer::Indexer> indexer;
+	std::vector<std::string> contents;
+
+	std::vector<Result> allResults;
+	bool printedHeader{false};
+};
+
+std::string jsonEscape(std::string_view text)
+{
+	std::string escaped;
+	for (auto c: text)
+	{
+		switch (c)
+		{
+			case '"': escaped += "\\\""; break;
+			case '\\': escaped += "\\\\"; break;
+			case '\n': escaped += "\\n"; break;
+			case '\t': escaped += "\\t"; break;
+			default: escaped.push_back(c); break;
+		}
+	}
+	return escaped;
+}
+
+void writeJson(std::ostream& out, Options const& options, Bench::Corpus const& corpus, std::vector<Result> const& results)
+{
+	auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	out << std::setprecision(17);
+	out << "{\n"
+		<< "  \"context\": {\n"
+		<< "    \"date\": \"" << std::put_time(std::gmtime(&now), "%Y-%m-%dT%H:%M:%SZ") << "\",\n"
+		<< "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+		<< "    \"library_build_type\": \"release\",\n"
+#else
+		<< "    \"library_build_type\": \"debug\",\n"
+#endif
+		<< "    \"benchmark_filter\": \"" << jsonEscape(options.filterSource) << "\",\n"
+		<< "    \"corpus\": {\n"
+		<< "      \"files\": " << corpus.files.size() << ",\n"
+		<< "      \"bytes\": " << corpus.totalBytes << ",\n"
+		<< "      \"mean_file_size\": " << options.corpus.meanFileSize << ",\n"
+		<< "      \"file_size_sigma\": " << options.corpus.fileSizeSigma << ",\n"
+		<< "      \"files_per_directory\": " << options.corpus.filesPerDirectory << ",\n"
+		<< "      \"vocabulary\": " << options.corpus.vocabularySize << ",\n"
+		<< "      \"zipf_exponent\": " << options.corpus.zipfExponent << ",\n"
+		<< "      \"seed\": " << options.corpus.seed << "\n"
+		<< "    }\n"
+		<< "  },\n"
+		<< "  \"benchmarks\": [";
+
+	for (std::size_t i = 0; i < results.size(); i++)
+	{
+		auto const& result = results[i];
+		out << (i == 0 ? "\n" : ",\n")
+			<< "    {\n"
+			<< "      \"name\": \"" << jsonEscape(result.name) << "\",\n"
+			<< "      \"run_name\": \"" << jsonEscape(result.runName) << "\",\n"
+			<< "      \"run_type\": \"" << (result.aggregate.empty() ? "iteration" : "aggregate") << "\",\n"
+			<< "      \"repetitions\": " << result.repetitions << ",\n";
+		if (result.aggregate.empty())
+		{
+			out << "      \"repetition_index\": " << result.repetitionIndex << ",\n";
+		}
+		else
+		{
+			out << "      \"aggregate_name\": \"" << result.aggregate << "\",\n";
+		}
+		out << "      \"iterations\": " << result.iterations << ",\n"
+			<< "      \"real_time\": " << result.realTime << ",\n"
+			<< "      \"time_unit\": \"ns\"";
+		for (auto const& [counter, value]: result.counters)
+		{
+			out << ",\n      \"" << counter << "\": " << value;
+		}
+		out << "\n    }";
+	}
+	out << "\n  ]\n}\n";
+}
+
+void printUsage()
+{
+	std::cerr << "usage: bench [options]\n"
+		"  --benchmark_filter=<regex>       run only the benchmarks matching the regex\n"
+		"  --benchmark_repetitions=<n>      repeat each benchmark n times and report aggregates (3)\n"
+		"  --benchmark_format=<console|json>\n"
+		"  --benchmark_out=<file>           also write JSON results to a file\n"
+		"  --corpus_files=<n>               number of generated files (2000)\n"
+		"  --corpus_file_size=<bytes>       mean file size (8192)\n"
+		"  --corpus_size_sigma=<x>          spread of the log-normal file size distribution (1.0)\n"
+		"  --corpus_files_per_dir=<n>       (100)\n"
+		"  --corpus_vocabulary=<n>          number of distinct words (50000)\n"
+		"  --corpus_zipf=<s>                Zipf exponent of word frequencies (1.1)\n"
+		"  --corpus_seed=<n>                (42)\n"
+		"  --corpus_dir=<path>              where the corpus is generated; its contents are replaced\n"
+		"  --keep_corpus                    do not delete the corpus afterwards\n"
+		"  --search_queries=<n>             queries per search benchmark run (1000)\n"
+		"  --churn_files=<n>                files rewritten per reindex benchmark run (200)\n"
+		"  --churn_burst=<n>                files rewritten back to back before waiting (10)\n";
+}
+
+std::optional<Options> parseOptions(int argc, char** argv)
+{
+	Options options;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view arg = argv[i];
+		auto equals = arg.find('=');
+		auto name = arg.substr(0, equals);
+		auto value = equals == std::string_view::npos ? std::string{} : std::string{arg.substr(equals + 1)};
+
+		try
+		{
+			if (name == "--benchmark_filter")
+			{
+				options.filter.emplace(value);
+				options.filterSource = value;
+			}
+			else if (name == "--benchmark_repetitions")
+				options.repetitions = std::max<std::size_t>(1, std::stoul(value));
+			else if (name == "--benchmark_format" && (value == "json" || value == "console"))
+				options.json = value == "json";
+			else if (name == "--benchmark_out")
+				options.out = value;
+			else if (name == "--corpus_files")
+				options.corpus.fileCount = std::stoul(value);
+			else if (name == "--corpus_file_size")
+				options.corpus.meanFileSize = std::max<std::size_t>(1, std::stoul(value));
+			else if (name == "--corpus_size_sigma")
+				options.corpus.fileSizeSigma = std::stod(value);
+			else if (name == "--corpus_files_per_dir")
+				options.corpus.filesPerDirectory = std::max<std::size_t>(1, std::stoul(value));
+			else if (name == "--corpus_vocabulary")
+				options.corpus.vocabularySize = std::max<std::size_t>(1, std::stoul(value));
+			else if (name == "--corpus_zipf")
+				options.corpus.zipfExponent = std::stod(value);
+			else if (name == "--corpus_seed")
+				options.corpus.seed = std::stoull(value);
+			else if (name == "--corpus_dir")
+				options.corpusDir = value;
+			else if (name == "--keep_corpus")
+				options.keepCorpus = true;
+			else if (name == "--search_queries")
+				options.searchQueries = std::max<std::size_t>(1, std::stoul(value));
+			else if (name == "--churn_files")
+				options.churnFiles = std::stoul(value);
+			else if (name == "--churn_burst")
+				options.churnBurst = std::max<std::size_t>(1, std::stoul(value));
+			else
+			{
+				std::cerr << "Unknown option: `" << arg << "`\n";
+				return std::nullopt;
+			}
+		}
+		catch (std::exception const&)
+		{
+			std::cerr << "Bad value for `" << name << "`: `" << value << "`\n";
+			return std::nullopt;
+		}
+	}
+	return options;
+}
+}
+
+int main(int argc, char** argv)
+{
+	auto options = parseOptions(argc, argv);
+	if (not options)
+	{
+		printUsage();
+		return 1;
+	}
+
+	auto corpusDir = std::filesystem::weakly_canonical(std::filesystem::absolute(options->corpusDir));
+	auto corpus = Bench::generateCorpus(corpusDir, options->corpus);
+	if (not options->json)
+	{
+		std::cout << "Running on " << std::thread::hardware_concurrency() << " threads, corpus of " << corpus.files.size() << " files, "
+			<< corpus.totalBytes << " bytes in " << corpusDir << "\n";
+	}
+
+	std::vector<Result> results;
+	{
+		Runner runner{*options, corpus};  // stops watching before the corpus is deleted
+		runner.run();
+		results = runner.results();
+	}
+
+	if (options->json)
+	{
+		writeJson(std::cout, *options, corpus, results);
+	}
+	if (not options->out.empty())
+	{
+		std::ofstream fout{options->out};
+		writeJson(fout, *options, corpus, results);
+	}
+
+	if (not options->keepCorpus)
+	{
+		std::filesystem::remove_all(corpusDir);
+	}
+	return 0;
+}
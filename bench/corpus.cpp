@@ -0,0 +1,149 @@
+#include "corpus.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <fstream>
+#include <numbers>
+
+Bench::Random::Random(std::uint64_t seed)
+{
+	for (auto& s: state)  // splitmix64
+	{
+		seed += 0x9E3779B97F4A7C15ULL;
+		auto z = seed;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		s = z ^ (z >> 31);
+	}
+}
+
+std::uint64_t Bench::Random::next()
+{
+	auto result = std::rotl(state[1] * 5, 7) * 9;
+	auto t = state[1] << 17;
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = std::rotl(state[3], 45);
+	return result;
+}
+
+double Bench::Random::uniform()
+{
+	return static_cast<double>(next() >> 11) * 0x1.0p-53;
+}
+
+double Bench::Random::normal()
+{
+	// Box-Muller; 1 - uniform() is never zero
+	return std::sqrt(-2.0 * std::log(1.0 - uniform())) * std::cos(2.0 * std::numbers::pi * uniform());
+}
+
+std::size_t Bench::Random::below(std::size_t bound)
+{
+	return static_cast<std::size_t>(uniform() * static_cast<double>(bound));
+}
+
+Bench::ZipfSampler::ZipfSampler(std::size_t size, double exponent)
+{
+	cumulative.reserve(size);
+	double sum = 0;
+	for (std::size_t rank = 1; rank <= size; rank++)
+	{
+		sum += 1.0 / std::pow(static_cast<double>(rank), exponent);
+		cumulative.push_back(sum);
+	}
+	for (auto& c: cumulative)
+	{
+		c /= sum;
+	}
+}
+
+std::size_t Bench::ZipfSampler::operator()(Random& random) const
+{
+	auto it = std::upper_bound(cumulative.begin(), cumulative.end(), random.uniform());
+	return std::min(static_cast<std::size_t>(it - cumulative.begin()), cumulative.size() - 1);
+}
+
+std::string Bench::wordForRank(std::size_t rank)
+{
+	// bijective base 26, so frequent words are also the short ones
+	std::string word;
+	for (auto n = rank + 1; n > 0; n = (n - 1) / 26)
+	{
+		word.push_back(static_cast<char>('a' + (n - 1) % 26));
+	}
+	return word;
+}
+
+std::string Bench::generateLine(Random& random, ZipfSampler const& zipf, std::vector<std::string> const& vocabulary, std::size_t wordCount)
+{
+	std::string line;
+	for (std::size_t i = 0; i < wordCount; i++)
+	{
+		if (i > 0)
+		{
+			line.push_back(' ');
+		}
+		line += vocabulary[zipf(random)];
+	}
+	line.push_back('\n');
+	return line;
+}
+
+Bench::Corpus Bench::generateCorpus(std::filesystem::path const& root, CorpusConfig const& config)
+{
+	Corpus corpus;
+	corpus.root = root;
+	corpus.occurrences.resize(config.vocabularySize);
+	corpus.vocabulary.reserve(config.vocabularySize);
+	for (std::size_t rank = 0; rank < config.vocabularySize; rank++)
+	{
+		corpus.vocabulary.push_back(wordForRank(rank));
+	}
+
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root);
+
+	Random random{config.seed};
+	ZipfSampler zipf{config.vocabularySize, config.zipfExponent};
+
+	auto sigma = config.fileSizeSigma;
+	auto mu = std::log(static_cast<double>(config.meanFileSize)) - sigma * sigma / 2;  // so that the mean is meanFileSize
+	auto maxFileSize = 64 * config.meanFileSize;
+
+	std::string contents;
+	for (std::size_t i = 0; i < config.fileCount; i++)
+	{
+		auto directory = root / ("dir" + std::to_string(i / config.filesPerDirectory));
+		if (i % config.filesPerDirectory == 0)
+		{
+			std::filesystem::create_directory(directory);
+		}
+
+		auto targetSize = std::clamp(static_cast<std::size_t>(std::exp(mu + sigma * random.normal())), std::size_t{1}, maxFileSize);
+
+		contents.clear();
+		while (contents.size() < targetSize)
+		{
+			auto wordCount = 1 + random.below(12);
+			for (std::size_t w = 0; w < wordCount; w++)
+			{
+				auto rank = zipf(random);
+				corpus.occurrences[rank]++;
+				contents += corpus.vocabulary[rank];
+				contents.push_back(w + 1 < wordCount ? ' ' : '\n');
+			}
+		}
+
+		auto file = directory / ("file" + std::to_string(i) + ".txt");
+		std::ofstream{file, std::ios::binary} << contents;
+		corpus.files.push_back(file);
+		corpus.totalBytes += contents.size();
+	}
+
+	return corpus;
+}
@@ -0,0 +1,68 @@
+#ifndef INDEXER_BENCH_CORPUS_H_
+#define INDEXER_BENCH_CORPUS_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace Bench
+{
+struct CorpusConfig
+{
+	std::size_t fileCount{2000};
+	std::size_t meanFileSize{8192};
+	double fileSizeSigma{1.0};  // of the log-normal size distribution, 0 makes all files the same size
+	std::size_t filesPerDirectory{100};
+	std::size_t vocabularySize{50000};
+	double zipfExponent{1.1};
+	std::uint64_t seed{42};
+};
+
+struct Corpus
+{
+	std::filesystem::path root;
+	std::vector<std::filesystem::path> files;
+	std::uintmax_t totalBytes{0};
+
+	std::vector<std::string> vocabulary;  // by frequency rank
+	std::vector<std::size_t> occurrences;  // by frequency rank
+};
+
+// Deterministic xoshiro256** generator, so that the corpus only depends on the seed and not on the standard library.
+class Random
+{
+public:
+	explicit Random(std::uint64_t seed);
+
+	std::uint64_t next();
+	double uniform();  // [0, 1)
+	double normal();
+	std::size_t below(std::size_t bound);
+
+private:
+	std::uint64_t state[4];
+};
+
+// Draws ranks from a Zipf distribution over [0, size).
+class ZipfSampler
+{
+public:
+	ZipfSampler(std::size_t size, double exponent);
+
+	std::size_t operator()(Random&) const;
+
+private:
+	std::vector<double> cumulative;
+};
+
+std::string wordForRank(std::size_t rank);
+
+// Replaces the contents of `root` with a fresh corpus.
+Corpus generateCorpus(std::filesystem::path const& root, CorpusConfig const&);
+
+// A line of `wordCount` words drawn from the same distribution as the corpus, newline-terminated.
+std::string generateLine(Random&, ZipfSampler const&, std::vector<std::string> const& vocabulary, std::size_t wordCount);
+}
+
+#endif // INDEXER_BENCH_CORPUS_H_
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "indexer/client.h"
+
+#include "corpus.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+	std::filesystem::path socket;
+	std::size_t clients{8};
+	std::size_t requests{2000};  // per client
+	std::size_t batch{1};  // terms per search request
+	std::size_t pipeline{1};  // requests in flight per client
+
+	Bench::CorpusConfig corpus;
+	std::filesystem::path corpusDir{std::filesystem::temp_directory_path() / "indexer_loadgen_corpus"};
+	bool addCorpus{true};
+	bool keepCorpus{false};
+};
+
+void printUsage()
+{
+	std::cerr << "usage: loadgen --socket=<path> [options]\n"
+		"  --socket=<path>                  where indexerd listens\n"
+		"  --clients=<n>                    concurrent connections (8)\n"
+		"  --requests=<n>                   search requests per client (2000)\n"
+		"  --batch=<n>                      terms per search request (1)\n"
+		"  --pipeline=<n>                   requests each client keeps in flight (1)\n"
+		"  --corpus_files=<n>               number of generated files (2000)\n"
+		"  --corpus_vocabulary=<n>          number of distinct words (50000)\n"
+		"  --corpus_seed=<n>                (42)\n"
+		"  --corpus_dir=<path>              where the corpus is generated; its contents are replaced\n"
+		"  --no_corpus                      search what the server has indexed already, with the same vocabulary\n"
+		"  --keep_corpus                    do not delete the corpus afterwards\n";
+}
+
+std::optional<Options> parseOptions(int argc, char** argv)
+{
+	Options options;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view arg = argv[i];
+		auto equals = arg.find('=');
+		auto name = arg.substr(0, equals);
+		auto value = equals == std::string_view::npos ? std::string{} : std::string{arg.substr(equals + 1)};
+
+		try
+		{
+			if (name == "--socket")
+				options.socket = value;
+			else if (name == "--clients")
+				options.clients = std::max<std::size_t>(1, std::stoul(value));
+			else if (name == "--requests")
+				options.requests = std::stoul(value);
+			else if (name == "--batch")
+				options.batch = std::max<std::size_t>(1, std::stoul(value));
+			else if (name == "--pipeline")
+				options.pipeline = std::max<std::size_t>(1, std::stoul(value));
+			else if (name == "--corpus_files")
+				options.corpus.fileCount = std::stoul(value);
+			else if (name == "--corpus_vocabulary")
+				options.corpus.vocabularySize = std::max<std::size_t>(1, std::stoul(value));
+			else if (name == "--corpus_seed")
+				options.corpus.seed = std::stoull(value);
+			else if (name == "--corpus_dir")
+				options.corpusDir = value;
+			else if (name == "--no_corpus")
+				options.addCorpus = false;
+			else if (name == "--keep_corpus")
+				options.keepCorpus = true;
+			else
+				return std::nullopt;
+		}
+		catch (std::exception const&)
+		{
+			return std::nullopt;
+		}
+	}
+	if (options.socket.empty())
+	{
+		return std::nullopt;
+	}
+	return options;
+}
+
+double percentile(std::vector<double>& sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0;
+	}
+	auto rank = static_cast<std::size_t>(std::ceil(p / 100 * static_cast<double>(sorted.size())));
+	return sorted[std::clamp(rank, std::size_t{1}, sorted.size()) - 1];
+}
+
+// searches with terms drawn like the corpus' words, keeping `pipeline` requests in flight;
+// returns the latency of each request in microseconds
+std::vector<double> runClient(Options const& options, std::size_t clientIndex)
+{
+	Indexer::Client client{options.socket};
+	Bench::Random random{options.corpus.seed + 1 + clientIndex};
+	Bench::ZipfSampler sampler{options.corpus.vocabularySize, options.corpus.zipfExponent};
+
+	std::vector<double> latencies;
+	latencies.reserve(options.requests);
+	std::deque<Clock::time_point> sentAt;  // searches are answered in order
+	std::size_t sent = 0;
+	while (latencies.size() < options.requests)
+	{
+		while (sent < options.requests && sentAt.size() < options.pipeline)
+		{
+			Indexer::Protocol::Request request{.opcode = Indexer::Protocol::Opcode::Search};
+			for (std::size_t i = 0; i < options.batch; i++)
+			{
+				request.arguments.push_back(Bench::wordForRank(sampler(random)));
+			}
+			client.send(std::move(request));
+			sentAt.push_back(Clock::now());
+			sent++;
+		}
+
+		auto response = client.receive();
+		if (response.status == Indexer::Protocol::Status::Error)
+		{
+			throw std::runtime_error{response.message};
+		}
+		latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sentAt.front()).count());
+		sentAt.pop_front();
+	}
+	return latencies;
+}
+}
+
+// Load generator for indexerd: several clients searching at once, with pipelined and batched requests
+int main(int argc, char** argv)
+{
+	auto options = parseOptions(argc, argv);
+	if (not options)
+	{
+		printUsage();
+		return 1;
+	}
+
+	try
+	{
+		std::optional<std::filesystem::path> corpusDir;
+		if (options->addCorpus)
+		{
+			corpusDir = std::filesystem::weakly_canonical(std::filesystem::absolute(options->corpusDir));
+			auto corpus = Bench::generateCorpus(*corpusDir, options->corpus);
+			auto start = Clock::now();
+			Indexer::Client{options->socket}.add(*corpusDir, true);
+			std::cout << "Indexed " << corpus.files.size() << " files, " << corpus.totalBytes << " bytes in "
+				<< std::chrono::duration<double>(Clock::now() - start).count() << " s\n";
+		}
+
+		std::vector<std::vector<double>> clientLatencies(options->clients);
+		std::vector<std::thread> clients;
+		auto start = Clock::now();
+		for (std::size_t i = 0; i < options->clients; i++)
+		{
+			clients.emplace_back([&, i]()
+			{
+				try
+				{
+					clientLatencies[i] = runClient(*options, i);
+				}
+				catch (std::exception const& e)
+				{
+					std::cerr << "client " << i << ": " << e.what() << '\n';
+				}
+			});
+		}
+		for (auto& client: clients)
+		{
+			client.join();
+		}
+		auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+		std::vector<double> latencies;
+		for (auto const& l: clientLatencies)
+		{
+			latencies.insert(latencies.end(), l.begin(), l.end());
+		}
+		std::sort(latencies.begin(), latencies.end());
+		auto requests = static_cast<double>(latencies.size());
+
+		std::cout << std::fixed << std::setprecision(1)
+			<< options->clients << " clients, " << latencies.size() << " requests of " << options->batch << " terms, "
+				<< options->pipeline << " in flight each\n"
+			<< requests / elapsed << " requests/s, " << requests * static_cast<double>(options->batch) / elapsed << " queries/s\n"
+			<< "latency: p50 " << percentile(latencies, 50) << " us, p99 " << percentile(latencies, 99) << " us, max "
+				<< (latencies.empty() ? 0 : latencies.back()) << " us\n";
+
+		if (corpusDir && not options->keepCorpus)
+		{
+			std::filesystem::remove_all(*corpusDir);
+		}
+	}
+	catch (std::exception const& e)
+	{
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef INDEXER_APPEND_FILE_H_
+#define INDEXER_APPEND_FILE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+namespace Indexer
+{
+class AppendFileImpl;
+
+// A file opened for appending, created if missing; sync() makes what was appended durable
+class AppendFile
+{
+public:
+	explicit AppendFile(std::filesystem::path const& path);
+	AppendFile(AppendFile&&);
+	AppendFile& operator=(AppendFile&&);
+	~AppendFile();
+
+	// all of these throw std::runtime_error on failure
+	void append(std::string_view data);
+	void sync();
+	void truncate(std::uint64_t size);  // appends continue from the new end
+
+	// makes a rename onto `file` durable by syncing the directory it's in, throws std::runtime_error on failure
+	static void syncDirectoryOf(std::filesystem::path const& file);
+
+private:
+	std::unique_ptr<AppendFileImpl> pImpl;
+};
+}
+
+#endif // INDEXER_APPEND_FILE_H_
@@ -0,0 +1,131 @@
+#ifndef INDEXER_BOUNDED_QUEUE_H_
+#define INDEXER_BOUNDED_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace Indexer
+{
+// Bounded multi-producer multi-consumer queue after Dmitry Vyukov's: each cell carries a sequence
+// number telling producers and consumers whose turn it is, so neither side takes a lock.
+// push() and pop() sleep on that sequence number while the queue is full or empty.
+template <class T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(std::size_t capacity)  // rounded up to a power of two
+		: mask{std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1}
+		, cells{std::make_unique<Cell[]>(mask + 1)}
+	{
+		for (std::size_t i = 0; i <= mask; i++)
+		{
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	BoundedQueue(BoundedQueue const&) = delete;
+	BoundedQueue& operator=(BoundedQueue const&) = delete;
+
+	void push(T value)
+	{
+		auto position = tail.load(std::memory_order_relaxed);
+		while (true)
+		{
+			auto& cell = cells[position & mask];
+			auto sequence = cell.sequence.load(std::memory_order_acquire);
+			auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+			if (difference == 0)
+			{
+				if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					cell.value = std::move(value);
+					cell.sequence.store(position + 1, std::memory_order_release);
+					cell.sequence.notify_all();
+					return;
+				}
+			}
+			else if (difference < 0)  // full, wait for this cell to be consumed
+			{
+				cell.sequence.wait(sequence, std::memory_order_acquire);
+				position = tail.load(std::memory_order_relaxed);
+			}
+			else
+			{
+				position = tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	T pop()
+	{
+		while (true)
+		{
+			std::size_t sequence;
+			std::size_t position;
+			if (auto value = tryPop(sequence, position))
+			{
+				return std::move(*value);
+			}
+			cells[position & mask].sequence.wait(sequence, std::memory_order_acquire);  // empty, wait for a producer
+		}
+	}
+
+	std::optional<T> tryPop()
+	{
+		std::size_t sequence;
+		std::size_t position;
+		return tryPop(sequence, position);
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<std::size_t> sequence;
+		T value;
+	};
+
+	// on failure, leaves the sequence number the cell at `position` had
+	std::optional<T> tryPop(std::size_t& sequence, std::size_t& position)
+	{
+		position = head.load(std::memory_order_relaxed);
+		while (true)
+		{
+			auto& cell = cells[position & mask];
+			sequence = cell.sequence.load(std::memory_order_acquire);
+			auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+			if (difference == 0)
+			{
+				if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					std::optional<T> value{std::move(cell.value)};
+					cell.sequence.store(position + mask + 1, std::memory_order_release);
+					cell.sequence.notify_all();
+					return value;
+				}
+			}
+			else if (difference < 0)
+			{
+				return std::nullopt;
+			}
+			else
+			{
+				position = head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	static constexpr std::size_t cacheLine = 64;
+
+	std::size_t mask;
+	std::unique_ptr<Cell[]> cells;
+	alignas(cacheLine) std::atomic<std::size_t> tail{0};  // producers and consumers don't share a line
+	alignas(cacheLine) std::atomic<std::size_t> head{0};
+};
+}
+
+#endif // INDEXER_BOUNDED_QUEUE_H_
@@ -0,0 +1,82 @@
+#ifndef INDEXER_BULK_INVERTER_H_
+#define INDEXER_BULK_INVERTER_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "indexer/file_id_allocator.h"
+#include "indexer/token_list.h"
+
+namespace Indexer
+{
+// Builds posting lists by sorting (term id, file id) pairs rather than inserting them into hash sets
+// one at a time. Pairs are collected in buffers; a full buffer is sorted and written out as a run,
+// and merge() k-way merges every run into one sorted posting list per term.
+class BulkInverter
+{
+public:
+	using TermId = std::uint32_t;
+
+	// `runBytes` bounds the pairs held in memory across all buffers, runs are named `runPrefix`<n>
+	BulkInverter(std::size_t runBytes, unsigned bufferCount, std::filesystem::path runPrefix);
+
+	BulkInverter(BulkInverter const&) = delete;
+	BulkInverter& operator=(BulkInverter const&) = delete;
+	~BulkInverter();
+
+	// thread-safe
+	template <class Tokens>
+	void add(FileId fileId, Tokens const& tokens)
+	{
+		std::vector<TermId> ids;
+		ids.reserve(tokens.size());
+		{
+			std::unique_lock pin{mutex};
+			for (auto const& token: tokens)
+			{
+				ids.push_back(termId(token));
+			}
+		}
+		add(fileId, ids);
+	}
+
+	// calls `emit` once per term with its sorted, deduplicated file ids; not thread-safe
+	void merge(std::function<void(std::string const& term, std::span<FileId const> fileIds)> const& emit);
+
+	[[nodiscard]] std::size_t runCount() const { return runs.size(); }
+
+private:
+	struct Posting
+	{
+		TermId term;
+		FileId file;
+
+		auto operator<=>(Posting const&) const = default;
+	};
+	using Buffer = std::vector<Posting>;
+
+	TermId termId(std::string_view token);
+	void add(FileId, std::vector<TermId> const&);
+	void writeRun(Buffer&);
+
+	std::size_t bufferCapacity;  // in postings
+	std::filesystem::path runPrefix;
+
+	std::mutex mutex;
+	std::unordered_map<std::string, TermId, TokenHasher, std::equal_to<>> termIds;
+	std::vector<std::string const*> terms;  // by term id, pointing into termIds
+	std::vector<std::unique_ptr<Buffer>> buffers;
+	std::vector<Buffer*> freeBuffers;
+	std::vector<std::filesystem::path> runs;
+};
+}
+
+#endif // INDEXER_BULK_INVERTER_H_
@@ -0,0 +1,40 @@
+#ifndef INDEXER_CLIENT_H_
+#define INDEXER_CLIENT_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "indexer/protocol.h"
+
+namespace Indexer
+{
+class ClientImpl;
+
+// Blocking connection to an indexerd Server. Requests are buffered until flush() or receive(),
+// so several can go out in one write; responses then come back by request id.
+class Client
+{
+public:
+	explicit Client(std::filesystem::path const& socketPath);
+	Client(Client&&);
+	Client& operator=(Client&&);
+	~Client();
+
+	std::uint32_t send(Protocol::Request);  // assigns the request id
+	void flush();
+	Protocol::Response receive();  // the next response, whichever request it answers
+
+	// one round trip each, with no other requests in flight; throw on an Error response
+	void add(std::filesystem::path const&, bool isRecursive = false);
+	std::vector<std::vector<std::string>> search(std::vector<std::string> terms);
+	std::string stats();
+
+private:
+	std::unique_ptr<ClientImpl> pImpl;
+};
+}
+
+#endif // INDEXER_CLIENT_H_
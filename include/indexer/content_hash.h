@@ -0,0 +1,31 @@
+#ifndef INDEXER_CONTENT_HASH_H_
+#define INDEXER_CONTENT_HASH_H_
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace Indexer
+{
+// Streaming XXH64
+class ContentHasher
+{
+public:
+	explicit ContentHasher(std::uint64_t seed = 0);
+
+	void update(std::string_view data);
+	[[nodiscard]] std::uint64_t digest() const;
+
+	[[nodiscard]] static std::uint64_t hash(std::string_view data, std::uint64_t seed = 0);
+
+private:
+	std::uint64_t seed;
+	std::array<std::uint64_t, 4> accumulators;
+	std::uint64_t totalLength{0};
+
+	std::array<char, 32> buffer{};
+	std::size_t bufferSize{0};
+};
+}
+
+#endif // INDEXER_CONTENT_HASH_H_
@@ -0,0 +1,37 @@
+#ifndef INDEXER_FILE_FILTER_H_
+#define INDEXER_FILE_FILTER_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include "indexer/glob.h"
+
+namespace Indexer
+{
+struct FileFilter
+{
+	std::uintmax_t maxFileSize{std::numeric_limits<std::uintmax_t>::max()};
+	bool skipBinaryFiles{true};
+
+	// .gitignore and .ignore files from the enclosing repository root down
+	bool respectIgnoreFiles{true};
+
+	// patterns without a `/` are matched against the file name, the rest against the full path
+	std::vector<Glob> excludes;
+
+	// cheap checks on the path alone, done before descending into directories
+	[[nodiscard]] bool isExcluded(std::filesystem::path const&) const;
+
+	// size limit and content sniffing, done before a file is handed to a worker
+	[[nodiscard]] bool isIndexable(std::filesystem::path const&) const;
+	[[nodiscard]] bool acceptsContents(std::string_view contents, std::uintmax_t fileSize) const;
+};
+
+// NUL bytes or malformed UTF-8 in the first block of a file
+[[nodiscard]] bool looksBinary(std::string_view firstBlock, bool isTruncated);
+}
+
+#endif // INDEXER_FILE_FILTER_H_
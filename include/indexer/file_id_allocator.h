@@ -0,0 +1,68 @@
+#ifndef INDEXER_FILE_ID_ALLOCATOR_H_
+#define INDEXER_FILE_ID_ALLOCATOR_H_
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace Indexer
+{
+using FileId = std::uint32_t;
+
+// Hands out the lowest free id first, so ids stay dense enough to index plain vectors
+class FileIdAllocator
+{
+public:
+	static constexpr FileId none = ~FileId{0};
+
+	FileId allocate()
+	{
+		if (freeIds.empty())
+		{
+			return next++;
+		}
+		auto fileId = freeIds.top();
+		freeIds.pop();
+		return fileId;
+	}
+
+	void release(FileId fileId)
+	{
+		freeIds.push(fileId);
+	}
+
+	// every id ever handed out is below this
+	[[nodiscard]] std::size_t capacity() const { return next; }
+	[[nodiscard]] std::size_t size() const { return next - freeIds.size(); }
+
+	[[nodiscard]] bool shouldCompact() const
+	{
+		return freeIds.size() >= minCompactionHoles && freeIds.size() * 4 >= next;
+	}
+
+	// renumbers the live ids, all listed in `order`, into [0, size()) in that order;
+	// returns the new id of every old one, `none` for the free ones
+	std::vector<FileId> compact(std::vector<FileId> const& order)
+	{
+		assert(order.size() == size());
+		std::vector<FileId> remap(next, none);
+		for (FileId i = 0; i < order.size(); i++)
+		{
+			remap[order[i]] = i;
+		}
+		freeIds = {};
+		next = static_cast<FileId>(order.size());
+		return remap;
+	}
+
+private:
+	static constexpr std::size_t minCompactionHoles = 4096;
+
+	FileId next{0};
+	std::priority_queue<FileId, std::vector<FileId>, std::greater<>> freeIds;
+};
+}
+
+#endif // INDEXER_FILE_ID_ALLOCATOR_H_
@@ -0,0 +1,38 @@
+#ifndef INDEXER_FILE_READER_H_
+#define INDEXER_FILE_READER_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Indexer
+{
+class FileReaderImpl;
+
+// Reads whole files a batch at a time. With io_uring, the opens, stats and reads of a batch are all
+// in flight at once, so the device sees a queue rather than one request per worker thread.
+// Where io_uring is unavailable, nothing is read and callers read the files themselves.
+class FileReader
+{
+public:
+	explicit FileReader(unsigned queueDepth = 64);
+	FileReader(FileReader&&);
+	FileReader& operator=(FileReader&&);
+	~FileReader();
+
+	[[nodiscard]] bool isAvailable() const;
+
+	// contents by position in `paths`; nullopt for files that couldn't be read, or that are larger than `maxSize`.
+	// Thread-safe, batches from different threads take turns
+	[[nodiscard]] std::vector<std::optional<std::string>> read(std::span<std::filesystem::path const> paths, std::uintmax_t maxSize);
+
+private:
+	std::unique_ptr<FileReaderImpl> pImpl;
+};
+}
+
+#endif // INDEXER_FILE_READER_H_
@@ -25,13 +25,14 @@ public:
 
 	enum class EventType
 	{
-		Created, Modified, Deleted
+		Created, Modified, Deleted, Moved
 	};
 	struct Event
 	{
 		EventType type;
 		std::filesystem::path path;
 		bool isDirectory;
+		std::filesystem::path oldPath{};  // where it was moved from, for Moved
 	};
 	std::vector<Event> pollEvents();
 
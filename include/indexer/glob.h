@@ -0,0 +1,39 @@
+#ifndef INDEXER_GLOB_H_
+#define INDEXER_GLOB_H_
+
+#include <bitset>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Indexer
+{
+// Shell-style pattern, compiled once and matched many times.
+// `*` and `?` do not cross `/`, `**` does, `**/` matches zero or more leading directories.
+class Glob
+{
+public:
+	explicit Glob(std::string_view pattern);
+
+	[[nodiscard]] bool matches(std::string_view text) const;
+
+	[[nodiscard]] std::string const& pattern() const { return source; }
+
+private:
+	enum class TokenType
+	{
+		Literal, AnyCharacter, CharacterClass, AnyRun, AnyPath, AnyDirectories
+	};
+	struct Token
+	{
+		TokenType type;
+		std::string literal;
+		std::bitset<256> characterClass;
+	};
+
+	std::string source;
+	std::vector<Token> tokens;
+};
+}
+
+#endif // INDEXER_GLOB_H_
@@ -0,0 +1,49 @@
+#ifndef INDEXER_IGNORE_RULES_H_
+#define INDEXER_IGNORE_RULES_H_
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "indexer/glob.h"
+
+namespace Indexer
+{
+// Compiled .gitignore/.ignore rules of one directory, chained to those of its parent
+class IgnoreRules
+{
+public:
+	// the parent's rules, unchanged, if the directory has no ignore files of its own
+	[[nodiscard]] static std::shared_ptr<IgnoreRules const> load(
+		std::filesystem::path const& directory, std::shared_ptr<IgnoreRules const> parent);
+
+	[[nodiscard]] bool isIgnored(std::filesystem::path const&, bool isDirectory) const;
+
+	static bool isIgnoreFile(std::filesystem::path const&);
+
+private:
+	struct Rule
+	{
+		Glob glob;
+		bool isNegated;
+		bool isDirectoryOnly;
+		bool isAnchored;  // matched against the path relative to the directory instead of the file name
+	};
+
+	enum class Verdict
+	{
+		Ignored, Included, Unknown
+	};
+	Verdict judge(std::string_view fullPath, std::string_view name, bool isDirectory) const;
+
+	void parse(std::filesystem::path const& ignoreFile);
+
+	std::string directoryPrefix;  // generic form, with the trailing slash
+	std::vector<Rule> rules;
+	std::shared_ptr<IgnoreRules const> parent;
+};
+}
+
+#endif // INDEXER_IGNORE_RULES_H_
@@ -0,0 +1,134 @@
+#ifndef INDEXER_INDEX_SNAPSHOT_H_
+#define INDEXER_INDEX_SNAPSHOT_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "indexer/mapped_file.h"
+#include "indexer/tokenizer.h"
+
+namespace Indexer
+{
+// A published index is a single file of fixed-width records that refer to each other by offset,
+// so that any process can map it and search it in place:
+//
+//   header | terms, sorted | postings, by term | files | strings
+//
+// Publishing writes a new file next to the old one and renames it over it, readers that already
+// mapped the old one keep it until they refresh(). Each publication gets the next generation number.
+// The files also keep what Indexer::persist() needs to restore an index from them, and how each
+// tokenizer normalizes search needles, so that they are searched the way the index would.
+namespace Snapshot
+{
+struct Header
+{
+	char magic[8];
+	std::uint64_t generation;
+	std::uint64_t termCount;
+	std::uint64_t fileCount;
+	std::uint64_t postingCount;
+	std::uint64_t stringBytes;
+	std::uint64_t logSequence;  // the last write-ahead log record included
+	std::uint64_t normalizations;  // offset into the strings, a Normalization for each tokenizer
+	std::uint64_t tokenizerCount;
+};
+
+struct Term
+{
+	std::uint64_t name;  // offset into the strings
+	std::uint64_t firstPosting;
+	std::uint32_t nameLength;
+	std::uint32_t postingCount;
+};
+
+struct File
+{
+	std::uint64_t path;  // offset into the strings
+	std::uint64_t pathLength;
+	std::uint64_t size;
+	std::int64_t lastWriteTime;  // file_time_type ticks
+	std::int64_t indexedAt;
+	std::uint64_t contentHash;
+	std::uint64_t tokenizer;
+};
+
+using Posting = std::uint32_t;  // index into the files
+
+inline constexpr char magic[8] = {'I', 'D', 'X', 'S', 'N', 'A', 'P', '3'};
+}
+
+// Collects an index for publication, see Indexer::publishSnapshot()
+class SnapshotWriter
+{
+public:
+	Snapshot::Posting addFile(std::string_view path, Snapshot::File metadata = {});  // its path is filled in
+	void addTerm(std::string_view term, std::vector<Snapshot::Posting> postings);  // in any order
+	void addTokenizer(Normalization normalization) { normalizations.push_back(static_cast<char>(normalization)); }  // in index order
+
+	// atomically and durably replaces `file`, readers of the previous generation are unaffected;
+	// throws std::runtime_error if it can't
+	void write(std::filesystem::path const& file, std::uint64_t logSequence = 0);
+
+private:
+	struct PendingTerm
+	{
+		std::uint64_t name;
+		std::uint32_t nameLength;
+		std::vector<Snapshot::Posting> postings;
+	};
+
+	std::vector<Snapshot::File> files;
+	std::vector<PendingTerm> terms;
+	std::string strings;
+	std::string normalizations;  // by tokenizer
+};
+
+// Read-only view of a published index, searched in place
+class IndexSnapshot
+{
+public:
+	explicit IndexSnapshot(std::filesystem::path file);  // throws if it isn't a valid snapshot
+
+	// the needle is normalized for each tokenizer and only matches the files of those it was normalized
+	// for, like Indexer::search(); the paths point into the mapping, they stay valid until the next refresh()
+	[[nodiscard]] std::vector<std::string_view> search(std::string_view needle) const;
+
+	[[nodiscard]] std::uint64_t generation() const { return header().generation; }
+	[[nodiscard]] std::size_t fileCount() const { return header().fileCount; }
+	[[nodiscard]] std::size_t termCount() const { return header().termCount; }
+	[[nodiscard]] std::uint64_t logSequence() const { return header().logSequence; }
+
+	// for reading the whole index back, terms are sorted
+	[[nodiscard]] std::string_view term(std::size_t index) const;
+	[[nodiscard]] std::span<Snapshot::Posting const> postingsOf(std::size_t term) const;  // may hold postings past fileCount() if corrupt
+	[[nodiscard]] Snapshot::File const& file(Snapshot::Posting posting) const { return files()[posting]; }
+	[[nodiscard]] std::string_view path(Snapshot::Posting) const;
+
+	// maps the latest publication if there's a newer one; true if it did
+	bool refresh();
+
+	// generation of the snapshot at `file`, if there's a valid one
+	[[nodiscard]] static std::optional<std::uint64_t> generationOf(std::filesystem::path const& file);
+
+private:
+	Snapshot::Header const& header() const;
+	std::span<Snapshot::Term const> terms() const;
+	std::span<Snapshot::Posting const> postings() const;
+	std::span<Snapshot::File const> files() const;
+	std::string_view strings() const;
+	Normalization normalizationOf(Snapshot::Posting) const;
+	std::optional<std::size_t> find(std::string_view term) const;
+
+	static void validate(std::string_view contents);
+
+	std::filesystem::path snapshotFile;
+	MappedFile mapping;
+};
+}
+
+#endif // INDEXER_INDEX_SNAPSHOT_H_
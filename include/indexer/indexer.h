@@ -3,172 +3,371 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <set>
 #include <string>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "indexer/bounded_queue.h"
+#include "indexer/bulk_inverter.h"
+#include "indexer/content_hash.h"
+#include "indexer/file_filter.h"
+#include "indexer/file_id_allocator.h"
+#include "indexer/file_reader.h"
 #include "indexer/filesystem_watcher.h"
+#include "indexer/ignore_rules.h"
+#include "indexer/indexer_runtime.h"
+#include "indexer/indexing_task.h"
+#include "indexer/memory_usage.h"
+#include "indexer/metrics.h"
+#include "indexer/path_table.h"
+#include "indexer/posting_segment.h"
 #include "indexer/path_utils.h"
+#include "indexer/priority_queue.h"
+#include "indexer/token_list.h"
+#include "indexer/tokenizer.h"
+#include "indexer/tokenizer_registry.h"
+#include "indexer/write_ahead_log.h"
 
 namespace Indexer
 {
-class Tokenizer
+enum class Recursive
 {
-public:
-	virtual void sendLine(std::string_view newLine) = 0;
-	virtual void sendEof() = 0;
-
-	virtual std::unique_ptr<Tokenizer> clone() const = 0;
+	No, Yes
+};
 
-	[[nodiscard]] virtual std::string_view next() = 0;
-	virtual bool done() const = 0;
+// files queued by the filesystem watcher go ahead of those from addPath, which go ahead of addPathAsync
+enum class Priority
+{
+	Interactive, Normal, Background
+};
 
-	virtual ~Tokenizer() = default;
+// for large initial builds: postings are sorted in runs of up to `runBytes` spilled to disk,
+// then merged once every file was read; the files only become searchable after that
+struct BulkLoad
+{
+	std::size_t runBytes{64 << 20};
 };
 
-template <class T>
-concept DerivedTokenizer = std::derived_from<T, Tokenizer>;
+using PathSet = std::unordered_set<std::filesystem::path, PathHasher>;
 
-class WordTokenizer final: public Tokenizer
+class IndexSnapshot;
+
+class Indexer
 {
 public:
-	virtual void sendLine(std::string_view newLine) override
+	Indexer(): Indexer{nullptr} {}
+
+	// indexers sharing a runtime share its watcher and tokenizing workers; without one, it gets its own
+	explicit Indexer(std::shared_ptr<IndexerRuntime> runtime_)
+		: Indexer{TokenizerRegistry{}, std::move(runtime_)}
 	{
-		source = newLine;
-		cursor = std::find_if(source.begin(), source.end(), isWordCharacter);
-		isDone = false;
-		findNext();
 	}
 
-	virtual void sendEof() override {}
-
-	virtual std::unique_ptr<Tokenizer> clone() const override { return std::make_unique<WordTokenizer>(); }
-
-	[[nodiscard]] virtual std::string_view next() override
+	template <DerivedTokenizer T>
+	Indexer(T tokenizer_, std::shared_ptr<IndexerRuntime> runtime_ = nullptr)
+		: Indexer{TokenizerRegistry{TokenizerRegistry::factoryOf(std::move(tokenizer_))}, std::move(runtime_)}
 	{
-		auto t = nextToken;
-		findNext();
-		return t;
 	}
 
-	virtual bool done() const override { return isDone; }
-
-private:
-	void findNext()
+	explicit Indexer(TokenizerRegistry tokenizers_, std::shared_ptr<IndexerRuntime> runtime_ = nullptr)
+		: tokenizers{std::move(tokenizers_)}
+		, runtime{runtime_ ? std::move(runtime_) : std::make_shared<IndexerRuntime>()}
 	{
-		if (isDone)
-		{
-			return;
-		}
-
-		if (cursor == source.end())
-		{
-			isDone = true;
-			return;
-		}
+		runtime->attach(*this);
+	}
 
-		auto end = std::find_if_not(cursor, source.end(), isWordCharacter);
-		nextToken = std::string_view{cursor, end}; 
-		cursor = std::find_if(end, source.end(), isWordCharacter);
+	~Indexer()
+	{
+		stopTasks();
+		runtime->stopEvents(*this);
+		stopPipeline();  // after the events, which may still be queueing files
+		runtime->detach(*this);
 	}
 
-	static constexpr auto isWordCharacter = [](auto c){ return c >= 0 && c < 256 && std::isalnum(c); };
+	// applies to paths added from now on
+	void setFileFilter(FileFilter filter) { fileFilter = std::move(filter); }
 
-	std::string_view source;
-	std::string_view nextToken;
-	std::string_view::iterator cursor;
-	bool isDone{true};
-};
+	void addPath(std::filesystem::path const&, Recursive = Recursive::No);
+	void addPath(std::filesystem::path const&, Recursive, BulkLoad);
 
-enum class Recursive
-{
-	No, Yes
-};
+	// returns right away, the path is indexed in the background; searches see files as they are merged
+	[[nodiscard]] IndexingTask addPathAsync(std::filesystem::path const&, Recursive = Recursive::No, std::stop_token = {},
+		Priority = Priority::Background);
 
-using PathSet = std::unordered_set<std::filesystem::path, PathHasher>;
+	[[nodiscard]] PathSet search(std::string const& needle) const;
+	// only the files under `directory`, without going through the others' paths
+	[[nodiscard]] PathSet search(std::string const& needle, std::filesystem::path const& directory) const;
 
-class Indexer
-{
-public:
-	Indexer(): tokenizer{std::make_unique<WordTokenizer>()} {}
+	// files with any term within `maxDistance` (up to 2) single-byte edits of the needle
+	[[nodiscard]] PathSet searchFuzzy(std::string const& needle, unsigned maxDistance) const;
+	[[nodiscard]] std::vector<std::string> similarTerms(std::string const& needle, unsigned maxDistance) const;
 
-	template <DerivedTokenizer T>
-	Indexer(T const& tokenizer_): tokenizer{std::make_unique<T>(tokenizer_)} {}
+	// renumbers files into a dense id range, each directory's files next to each other for scoped searches;
+	// also done automatically once enough ids are freed
+	void compactFileIds();
 
-	template <DerivedTokenizer T>
-	Indexer(T&& tokenizer_): tokenizer{std::make_unique<T>(std::move(tokenizer_))} {}
+	[[nodiscard]] IndexerStats stats() const;
 
-	~Indexer()
-	{
-		doStop = true;
-		watcher.requestStop();
-		filesystemWatcherThread.join();
-	}
+	// once the estimated size of the index exceeds the budget, the least recently used posting lists
+	// are moved to memory-mapped files in `spillDirectory`; search reads them from there
+	void setMemoryBudget(std::size_t bytes, std::filesystem::path spillDirectory = std::filesystem::temp_directory_path());
 
-	void addPath(std::filesystem::path const&, Recursive = Recursive::No);
+	// spans around tokenizing, merging into the index and searching, dumped as Chrome trace JSON
+	void setTracing(bool enabled) { metrics.setTracing(enabled); }
+	void writeTrace(std::ostream& out) const { metrics.writeTrace(out); }
 
-	[[nodiscard]] PathSet search(std::string const& needle) const;
+	// writes the index to `file` for other processes to map and search read-only, see IndexSnapshot;
+	// they keep the generation they have until they refresh()
+	void publishSnapshot(std::filesystem::path const& file) const;
+
+	// keeps the index across restarts: restores it from the snapshot at `snapshotFile` and the changes
+	// logged after it to `snapshotFile`.wal, then logs every change from here on. Publishing to
+	// `snapshotFile` again truncates the log. Must come before any paths are added; adding them
+	// again afterwards picks up what changed meanwhile, reading only the files whose stat did.
+	void persist(std::filesystem::path const& snapshotFile, WriteAheadLog::Options = {});
 
 private:
+	friend class IndexerRuntime;
+
 	void addDirectory(std::filesystem::path const&, Recursive);
 
+	bool isIgnored(std::filesystem::path const&, bool isDirectory);
+	std::shared_ptr<IgnoreRules const> ignoreRulesFor(std::filesystem::path const& directory);
+	bool isUnderAddedPath(std::filesystem::path const&) const;
+	static bool isInRepository(std::filesystem::path const& directory);  // it or one of its ancestors has a .git
+	void forgetIgnoreRules(std::filesystem::path const& directory);
+
 	void addFile(std::filesystem::path const&);
-	void addFileAsync(std::filesystem::path const&, std::thread::id parent);
+	std::shared_ptr<IndexingTask::State> currentTask() const;  // if called from an addPathAsync thread
+	void stopTasks();
 	void removeFile(std::filesystem::path const&);
+	void removeFilesUnder(std::filesystem::path const& directory);
+	void removeFileUnsafe(FileId);
 	void reindexFile(std::filesystem::path const&);
+	bool reindexAppended(FileId, std::filesystem::path const&, std::filesystem::file_time_type lastWriteTime);
+	void replaceTokensUnsafe(FileId, std::shared_ptr<TokenList>);  // of an indexed file
+	void finishBulkBuild();
+	TokenList tokenize(TokenizerRegistry::Index, std::string_view contents) const;
+
+	// record how long they waited for the lock
+	std::unique_lock<std::mutex> lockIndex() const;
+	void relockIndex(std::unique_lock<std::mutex>&) const;
+
+	// byte-identical files share their token set
+	std::shared_ptr<TokenList> findTokens(std::uint64_t contentHash);
+	std::shared_ptr<TokenList> shareTokens(TokenList) const;  // accounted for in forwardIndexBytes
+
+	struct PostingList;
+	PostingList& postingsFor(std::string_view token);  // loads spilled lists back, creates missing ones
+	void addPosting(std::string_view token, FileId);
+	void removePosting(std::string_view token, FileId);
+	void findFilesUnsafe(std::string_view term, std::vector<FileId>& files) const;
+	void findFilesUnsafe(std::string_view term, PathTable::Scope const&, std::vector<FileId>& files) const;
+	void keepFilesOfUnsafe(TokenizerRegistry::Needle const&, std::vector<FileId>& files, std::size_t first) const;  // from `first` on
+	PathSet pathsOfUnsafe(std::vector<FileId>& files, bool mayRepeat) const;
+	void similarTermsUnsafe(std::string_view needle, unsigned maxDistance, std::vector<std::string>& terms) const;
+
+	std::size_t memoryUsageUnsafe() const;
+	void enforceMemoryBudgetUnsafe();
+	std::filesystem::path spillFileUnsafe(std::string const& name);
+	void loadSpilledPostingsUnsafe();
+
+	struct Scope
+	{
+		bool isAdded;  // explicitly, see addedPaths
+		std::optional<Recursive> parentRecursion;  // how its parent directory is indexed, if it is
+	};
+	Scope scopeOf(std::filesystem::path const&) const;
 
 	void awaitCreation(std::filesystem::path const&);
-	void watchFilesystem();
+	void handleEvent(FilesystemWatcher::Event const&);
+	void handleCreated(std::filesystem::path const&, bool isDirectory);
+	void handleDeleted(std::filesystem::path const&, bool isDirectory);
+	void handleMoved(std::filesystem::path const& from, std::filesystem::path const& to, bool isDirectory);
+	void resolveCreationWatches(std::filesystem::path const&);
 
-	int getFileId(std::filesystem::path const& path)
+	FileId getFileId(std::filesystem::path const& path)
 	{
-		static int next = 0;
-
-		if (fileToId.contains(path))
+		if (auto fileId = filePaths.find(path))
 		{
-			return fileToId.at(path);
+			return *fileId;
 		}
 		else
 		{
-			auto fileId = next++;
-			fileToId.insert({path, fileId});
-			idToFile.insert({fileId, path});
-			return fileId;
+			auto newId = fileIds.allocate();
+			filePaths.insert(newId, path);
+			if (fileIds.capacity() > fileInfo.size())
+			{
+				fileInfo.resize(fileIds.capacity());
+				forwardIndex.resize(fileIds.capacity());
+			}
+			return newId;
 		}
 	}
 
-	std::unique_ptr<Tokenizer> tokenizer;
+	bool isIndexed(FileId fileId) const { return fileId < fileInfo.size() && fileInfo[fileId].has_value(); }
+
+	void restoreSnapshotUnsafe(IndexSnapshot const&);
+	void applyChangeUnsafe(WriteAheadLog::Change);
+	void logIndexedUnsafe(FileId);
+
+	void compactFileIdsUnsafe();
+	void compactFileIdsIfSparseUnsafe();  // not from removeFileUnsafe, callers may be holding other ids
+	bool isPendingBulk(FileId fileId) const { return bulkBuild && bulkBuild->pendingFiles.contains(fileId); }
 
-	unsigned maxWorkers{std::thread::hardware_concurrency()};
-	unsigned numWorkers{0};
-	std::unordered_map<std::thread::id, unsigned> threadWorkers;
+	TokenizerRegistry tokenizers;
+	FileFilter fileFilter;
+	mutable Metrics metrics;
+	FileReader fileReader;
 
-	std::mutex workerMutex;
+	unsigned numWorkers{0};  // busy tokenizing
+	unsigned pendingFiles{0};  // queued for a tokenizer
+	std::unordered_map<std::thread::id, unsigned> threadWorkers;  // files each thread is waiting on
+	std::unordered_map<std::thread::id, std::shared_ptr<IndexingTask::State>> threadTasks;  // for the threads of addPathAsync
+	std::unordered_map<std::thread::id, Priority> threadPriorities;  // likewise, other threads queue as Normal
+	std::vector<std::pair<std::thread, std::shared_ptr<IndexingTask::State>>> taskThreads;  // joined once done
+
+	mutable std::mutex workerMutex;
 	std::condition_variable workerSync;
 
+	std::mutex ignoreRulesMutex;
+	std::unordered_map<std::filesystem::path, std::shared_ptr<IgnoreRules const>, PathHasher> ignoreRules;
+
+	mutable std::mutex indexMutex;
+
 	// paths that were *explicitly* added by the user
 	PathSet addedPaths;
 	std::unordered_map<std::filesystem::path, Recursive, PathHasher> indexedDirectories;
+	std::unordered_map<std::filesystem::path, PathSet, PathHasher> creationWatches;
 
-	mutable std::mutex indexMutex;
+	PathSet modifiedInPipeline;  // reindexed once merged
 
-	std::unordered_map<std::filesystem::path, PathSet, PathHasher> creationWatches;
+	FileIdAllocator fileIds;
+	PathTable filePaths;
+
+	struct FileInfo
+	{
+		std::uintmax_t size;
+		std::filesystem::file_time_type lastWriteTime;
+		std::filesystem::file_time_type indexedAt;  // stat is only trusted for writes well before this
+		ContentHasher hasher;  // kept to extend contentHash on appends
+		std::uint64_t contentHash;
+		std::uint64_t tailHash;  // of the last appendWindow bytes, tells appends from rewrites
+		bool endsWithNewline;
+		TokenizerRegistry::Index tokenizer;  // also the seed of contentHash, the same contents tokenize differently
+
+		bool isUnchanged(std::uintmax_t size_, std::filesystem::file_time_type lastWriteTime_) const;  // going by stat
+	};
+	static FileInfo makeFileInfo(std::string_view contents, TokenizerRegistry::Index, std::filesystem::file_time_type lastWriteTime, std::filesystem::file_time_type indexedAt);
+	// without the contents, appends to it are reindexed in full
+	static FileInfo restoredFileInfo(std::uintmax_t size, std::int64_t lastWriteTime, std::int64_t indexedAt, std::uint64_t contentHash, std::uint64_t tokenizer);
+	std::vector<std::optional<FileInfo>> fileInfo;  // by file id
+
+	std::vector<std::shared_ptr<TokenList>> forwardIndex;  // by file id, for updating
+	std::unordered_map<std::uint64_t, std::weak_ptr<TokenList>> contentTokens;  // for deduplication
+
+	struct PostingList
+	{
+		std::unordered_set<FileId> files;
+		mutable std::uint64_t lastUsed{0};  // the least recently used lists are spilled first
+	};
+	std::unordered_map<std::string, PostingList, TokenHasher, std::equal_to<>> invertedIndex;  // for querying
+	mutable std::uint64_t useCounter{0};
 
-	std::unordered_map<int, std::filesystem::path> idToFile;
-	std::unordered_map<std::filesystem::path, int, PathHasher> fileToId;
+	struct SpilledList
+	{
+		std::size_t segment;
+		PostingSegment::Extent extent;
+	};
+	std::unordered_map<std::string, SpilledList, TokenHasher, std::equal_to<>> spilledPostings;  // never also in invertedIndex
+	std::vector<std::unique_ptr<PostingSegment>> postingSegments;  // null once all its lists were loaded back
+	std::size_t spilledBytes{0};
+
+	// every term in invertedIndex or spilledPostings, in order, for fuzzy search to seek through
+	std::set<std::string, std::less<>> termDictionary;
+
+	// files read by addPath(..., BulkLoad) wait here for the inverter's merge
+	struct BulkBuild
+	{
+		BulkBuild(std::thread::id owner_, std::size_t runBytes, unsigned bufferCount, std::filesystem::path runPrefix)
+			: owner{owner_}
+			, inverter{runBytes, bufferCount, std::move(runPrefix)}
+		{
+		}
 
-	std::unordered_map<int, std::unordered_set<std::string>> forwardIndex;  // for updating
-	std::unordered_map<std::string, std::unordered_set<int>> invertedIndex;  // for querying
+		std::thread::id owner;  // only files added from this thread go through the inverter
+		BulkInverter inverter;
 
-	std::atomic<bool> doStop{false};
-	FilesystemWatcher watcher;
-	std::thread filesystemWatcherThread{&Indexer::watchFilesystem, this};
+		struct PendingFile
+		{
+			FileInfo info;
+			std::shared_ptr<TokenList> tokens;
+		};
+		std::unordered_map<FileId, PendingFile> pendingFiles;
+		std::vector<FileId> releasedIds;  // not recycled or compacted until the merge, the inverter still holds them
+		PathSet modifiedPaths;  // while pending, reindexed after the merge
+	};
+	std::unique_ptr<BulkBuild> bulkBuild;
+
+	// Ingest is a pipeline: addFile queues a path, a reader thread reads queued files in batches,
+	// the runtime's workers tokenize them and a merger thread applies whole batches of files to the index
+	// under one lock. The bounded queues hold back addDirectory when the later stages fall behind.
+	// Reading and tokenizing take files by priority, so watched changes don't wait behind a bulk add.
+	struct IngestJob
+	{
+		std::filesystem::path path;
+		std::thread::id parent;  // whose addPath waits for it
+		Priority priority;
+		std::shared_ptr<IndexingTask::State> task{};  // for progress and cancellation
+		std::optional<std::string> contents{};  // if read in a batch
+		std::filesystem::file_time_type readAt{};
+		std::optional<FileInfo> info{};
+		std::shared_ptr<TokenList> tokens{};
+	};
+	static constexpr std::size_t priorityCount = 3;
+	using IngestQueue = PriorityQueue<std::unique_ptr<IngestJob>, priorityCount>;  // null once closed and drained
+	static constexpr std::size_t readBatchSize = 64;
+	static constexpr std::uintmax_t maxBatchedFileSize = 1 << 20;  // larger files are sniffed before being read
+	static constexpr std::size_t mergeBatchSize = 256;
+
+	void startPipeline();
+	void stopPipeline();
+	void readFiles();
+	void tokenizeNext();  // called by the runtime for each file pushed to tokenizeQueue
+	void mergeFiles();
+	void mergeBatch(std::vector<std::unique_ptr<IngestJob>> const&);
+
+	IngestQueue readQueue{1024};
+	IngestQueue tokenizeQueue{256};
+	BoundedQueue<std::unique_ptr<IngestJob>> mergeQueue{1024};  // null once the last file was tokenized
+	std::once_flag pipelineStarted;
+	std::thread readThread;
+	std::thread mergeThread;
+
+	std::size_t memoryBudget{std::numeric_limits<std::size_t>::max()};
+	std::filesystem::path spillDirectory;
+	std::string spillFilePrefix;
+
+	// estimates, see memory_usage.h
+	std::size_t dictionaryBytes{0};
+	std::size_t postingsBytes{0};
+	// token sets are freed wherever their last owner lets go, the counter outlives us for that
+	std::shared_ptr<std::atomic<std::size_t>> forwardIndexBytes{std::make_shared<std::atomic<std::size_t>>(0)};
+
+	std::unique_ptr<WriteAheadLog> changeLog;  // null unless persisted, and while replaying it
+	std::filesystem::path persistedSnapshot;
+
+	std::shared_ptr<IndexerRuntime> runtime;
 };
 }
 
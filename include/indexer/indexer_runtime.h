@@ -0,0 +1,86 @@
+#ifndef INDEXER_INDEXER_RUNTIME_H_
+#define INDEXER_INDEXER_RUNTIME_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "indexer/filesystem_watcher.h"
+#include "indexer/path_utils.h"
+
+namespace Indexer
+{
+class Indexer;
+
+// The threads several indexers can share: one filesystem watcher with the thread polling it, and
+// one pool of tokenizing workers. Each indexer gets the events under the paths it added, queued
+// for a thread of its own to handle, as handling them can block on its backed up pipeline; the
+// workers take one file from each indexer with files queued in turn, so a large add to one of
+// them doesn't hold up the others. An Indexer constructed without a runtime gets its own.
+class IndexerRuntime
+{
+public:
+	explicit IndexerRuntime(unsigned workerCount = std::max(std::thread::hardware_concurrency(), 1u));
+	IndexerRuntime(IndexerRuntime const&) = delete;
+	IndexerRuntime& operator=(IndexerRuntime const&) = delete;
+	~IndexerRuntime();  // outlives its indexers, they hold it by shared_ptr
+
+	[[nodiscard]] unsigned workerCount() const { return static_cast<unsigned>(workers.size()); }
+
+private:
+	friend class Indexer;
+
+	void attach(Indexer&);
+	void stopEvents(Indexer&);  // returns once no event is being handled by it, drops its watches and queued events
+	void detach(Indexer&);  // returns once no worker is in it
+
+	void addRoot(Indexer&, std::filesystem::path const&);  // events under it go to the indexer
+	void watchFile(Indexer&, std::filesystem::path const&);
+	void watchDirectory(Indexer&, std::filesystem::path const&);
+	void unwatch(Indexer&, std::filesystem::path const&);  // the watch goes once no indexer holds it
+	void queueFile(Indexer&);  // after it pushed a file to its tokenizeQueue
+	[[nodiscard]] bool isEventThread() const;  // handling a filesystem event for some indexer
+
+	struct Client
+	{
+		Indexer* indexer;
+		std::vector<std::filesystem::path> roots;
+		bool isReceivingEvents{true};
+		std::deque<FilesystemWatcher::Event> events;  // not handled yet, a flood backs up here rather than in the watcher
+		std::condition_variable eventSync;  // events queued, or stopping
+		std::thread eventThread;  // started with the first event
+		std::size_t queuedFiles{0};
+		unsigned activeThreads{0};  // workers inside the indexer right now
+	};
+	Client& clientFor(Indexer const&);  // with mutex held
+
+	void watchFilesystem();
+	void handleEvents(Client&);
+	void work();
+
+	std::mutex mutex;
+	std::condition_variable workSync;  // files queued, or stopping
+	std::condition_variable idleSync;  // a thread left an indexer
+	std::vector<std::unique_ptr<Client>> clients;
+	std::size_t nextClient{0};  // where the workers' round robin continues
+	std::size_t queuedFiles{0};  // over all clients
+	bool isStopping{false};
+
+	std::unordered_map<std::filesystem::path, std::unordered_set<Indexer const*>, PathHasher> watchOwners;
+
+	std::atomic<bool> doStop{false};
+	FilesystemWatcher watcher;
+	std::thread watcherThread;
+	std::vector<std::thread> workers;
+};
+}
+
+#endif // INDEXER_INDEXER_RUNTIME_H_
@@ -0,0 +1,69 @@
+#ifndef INDEXER_INDEXING_TASK_H_
+#define INDEXER_INDEXING_TASK_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+
+namespace Indexer
+{
+struct IndexingProgress
+{
+	std::uint64_t filesDiscovered{0};  // queued for indexing
+	std::uint64_t filesIndexed{0};
+	std::uint64_t filesSkipped{0};  // gone, binary, too large or cancelled by the time they were read
+	std::uint64_t bytesRead{0};
+	bool isDone{false};
+};
+
+// Handle to an addPathAsync() running in the background
+class IndexingTask
+{
+public:
+	[[nodiscard]] IndexingProgress progress() const;
+	[[nodiscard]] bool isDone() const { return progress().isDone; }
+
+	void wait() const;
+	template <class Rep, class Period>
+	bool waitFor(std::chrono::duration<Rep, Period> timeout) const  // true if done
+	{
+		std::unique_lock pin{state->mutex};
+		return state->doneSync.wait_for(pin, timeout, [this](){ return state->isDone; });
+	}
+
+	// files already tokenized are still merged, the rest are skipped; wait() for it to take effect
+	void cancel() { state->stopSource.request_stop(); }
+
+private:
+	friend class Indexer;
+
+	struct State
+	{
+		std::stop_source stopSource;
+		std::optional<std::stop_callback<std::function<void()>>> callerStop;  // forwards the caller's token
+
+		std::atomic<std::uint64_t> filesDiscovered{0};
+		std::atomic<std::uint64_t> filesIndexed{0};
+		std::atomic<std::uint64_t> filesSkipped{0};
+		std::atomic<std::uint64_t> bytesRead{0};
+
+		mutable std::mutex mutex;
+		mutable std::condition_variable doneSync;
+		bool isDone{false};
+
+		[[nodiscard]] bool isCancelled() const { return stopSource.stop_requested(); }
+	};
+
+	explicit IndexingTask(std::shared_ptr<State> state_): state{std::move(state_)} {}
+
+	std::shared_ptr<State> state;
+};
+}
+
+#endif // INDEXER_INDEXING_TASK_H_
@@ -0,0 +1,45 @@
+#ifndef INDEXER_LEVENSHTEIN_AUTOMATON_H_
+#define INDEXER_LEVENSHTEIN_AUTOMATON_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Indexer
+{
+// Accepts the strings within `maxDistance` single-byte insertions, deletions and substitutions
+// of `word`. A state is the row of the edit distance table for the input so far, keeping only
+// the entries still within `maxDistance`: at most 2 * maxDistance + 1 of them.
+class LevenshteinAutomaton
+{
+public:
+	static constexpr unsigned maxSupportedDistance = 2;
+
+	struct State
+	{
+		struct Entry
+		{
+			std::uint32_t position;  // in `word`
+			std::uint32_t distance;
+		};
+		std::array<Entry, 2 * maxSupportedDistance + 1> entries;
+		std::uint32_t size{0};
+	};
+
+	LevenshteinAutomaton(std::string_view word_, unsigned maxDistance_);  // throws std::invalid_argument beyond maxSupportedDistance
+
+	[[nodiscard]] State start() const;
+	[[nodiscard]] State step(State const&, char) const;
+	[[nodiscard]] bool canMatch(State const& state) const { return state.size > 0; }
+	[[nodiscard]] bool isMatch(State const& state) const { return state.size > 0 && state.entries[state.size - 1].position == word.size(); }
+
+	[[nodiscard]] bool matches(std::string_view text) const;
+
+private:
+	std::string word;
+	unsigned maxDistance;
+};
+}
+
+#endif // INDEXER_LEVENSHTEIN_AUTOMATON_H_
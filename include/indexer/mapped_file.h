@@ -0,0 +1,28 @@
+#ifndef INDEXER_MAPPED_FILE_H_
+#define INDEXER_MAPPED_FILE_H_
+
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+namespace Indexer
+{
+class MappedFileImpl;
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+	explicit MappedFile(std::filesystem::path const& path);
+	MappedFile(MappedFile&&);
+	MappedFile& operator=(MappedFile&&);
+	~MappedFile();
+
+	[[nodiscard]] std::string_view contents() const;
+
+private:
+	std::unique_ptr<MappedFileImpl> pImpl;
+};
+}
+
+#endif // INDEXER_MAPPED_FILE_H_
@@ -0,0 +1,28 @@
+#ifndef INDEXER_MEMORY_USAGE_H_
+#define INDEXER_MEMORY_USAGE_H_
+
+#include <cstddef>
+#include <string>
+
+// Rough heap footprint of the standard containers the index is built from, for memory accounting.
+// Estimates, not measurements: allocator overhead and load factors are ignored.
+namespace Indexer
+{
+// a node of a hash container holding `T`, plus its share of the bucket array
+template <class T>
+constexpr std::size_t hashNodeBytes = sizeof(void*) + sizeof(T) + sizeof(std::size_t) + sizeof(void*);
+
+// a node of a tree container holding `T`: three links and the color
+template <class T>
+constexpr std::size_t treeNodeBytes = 3 * sizeof(void*) + sizeof(int) + sizeof(T);
+
+// short strings live inside the object itself
+template <class Char>
+std::size_t heapBytes(std::basic_string<Char> const& string)
+{
+	auto capacity = string.capacity() * sizeof(Char);
+	return capacity < 2 * sizeof(void*) ? 0 : capacity + sizeof(Char);
+}
+}
+
+#endif // INDEXER_MEMORY_USAGE_H_
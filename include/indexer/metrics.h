@@ -0,0 +1,159 @@
+#ifndef INDEXER_METRICS_H_
+#define INDEXER_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+namespace Indexer
+{
+// Durations bucketed by powers of two of their length in nanoseconds
+struct Histogram
+{
+	static constexpr std::size_t bucketCount = 64;
+
+	std::array<std::uint64_t, bucketCount> buckets{};  // bucket i holds durations in [2^(i-1), 2^i) ns
+	std::uint64_t count{0};
+	std::uint64_t total{0};  // ns
+	std::uint64_t max{0};  // ns
+
+	[[nodiscard]] std::chrono::nanoseconds mean() const;
+	// upper bound of the bucket holding the percentile, so at most twice the real value
+	[[nodiscard]] std::chrono::nanoseconds percentile(double) const;
+};
+
+struct IndexerStats
+{
+	std::chrono::steady_clock::duration uptime{};
+
+	// current state
+	unsigned activeWorkers{0};
+	unsigned pendingFiles{0};  // queued for a tokenizing worker
+	std::size_t queuedInteractive{0};  // of those, by priority
+	std::size_t queuedNormal{0};
+	std::size_t queuedBackground{0};
+	std::size_t indexedFiles{0};
+	std::size_t distinctTokens{0};
+
+	// estimated memory, by structure
+	std::size_t dictionaryBytes{0};
+	std::size_t postingsBytes{0};  // in memory only
+	std::size_t forwardIndexBytes{0};
+	std::size_t pathBytes{0};
+	std::size_t spilledTokens{0};  // posting lists served from disk
+	std::size_t spilledBytes{0};
+	std::size_t memoryBudget{0};
+
+	// totals since construction
+	std::uint64_t filesIndexed{0};
+	std::uint64_t filesRemoved{0};
+	std::uint64_t fullReindexes{0};
+	std::uint64_t appendReindexes{0};
+	std::uint64_t unchangedReindexes{0};  // modification events that turned out not to change the contents
+	std::uint64_t movesInPlace{0};
+	std::uint64_t filesReadInBatches{0};  // through FileReader rather than by their worker
+	std::uint64_t bytesTokenized{0};
+	std::uint64_t searches{0};
+
+	std::uint64_t createdEvents{0};
+	std::uint64_t modifiedEvents{0};
+	std::uint64_t deletedEvents{0};
+	std::uint64_t movedEvents{0};
+
+	Histogram tokenizeTime;
+	Histogram mergeTime;  // updating the inverted index
+	Histogram indexLockWait;
+	Histogram searchTime;
+
+	[[nodiscard]] double tokenizeBytesPerSecond() const;
+	[[nodiscard]] double watcherEventsPerSecond() const;
+	[[nodiscard]] std::size_t memoryBytes() const { return dictionaryBytes + postingsBytes + forwardIndexBytes + pathBytes; }
+};
+
+std::ostream& operator<<(std::ostream&, IndexerStats const&);
+
+// Counters and histograms sharded per thread, so recording never contends;
+// stats() sums the shards. Trace spans are kept per shard too, while tracing is on.
+class Metrics
+{
+public:
+	enum class Counter
+	{
+		FilesIndexed, FilesRemoved, FullReindexes, AppendReindexes, UnchangedReindexes, MovesInPlace, FilesReadInBatches, BytesTokenized, Searches,
+		CreatedEvents, ModifiedEvents, DeletedEvents, MovedEvents,
+		Count
+	};
+	enum class Timer
+	{
+		Tokenize, Merge, IndexLockWait, Search,
+		Count
+	};
+
+	Metrics();
+
+	void add(Counter, std::uint64_t value = 1) const;
+	void record(Timer, std::chrono::steady_clock::duration) const;
+
+	void setTracing(bool);  // starting drops the spans of any previous trace
+	[[nodiscard]] bool isTracing() const { return tracing.load(std::memory_order_relaxed); }
+	void addSpan(char const* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) const;
+	void writeTrace(std::ostream&) const;  // Chrome trace event format, one tid per shard
+
+	// fills in the counters and histograms, leaves the gauges alone
+	void collect(IndexerStats&) const;
+
+	[[nodiscard]] std::chrono::steady_clock::time_point startTime() const { return createdAt; }
+
+private:
+	struct Shard;
+	struct Pool;
+	struct Leases;
+
+	Shard& localShard() const;
+
+	static thread_local Leases leases;
+
+	std::shared_ptr<Pool> pool;  // shared with the threads holding a shard, which may outlive us
+	std::chrono::steady_clock::time_point createdAt;
+	std::atomic<bool> tracing{false};
+};
+
+// Times a scope into a histogram and, while tracing, into a trace span
+class TraceSpan
+{
+public:
+	TraceSpan(Metrics const& metrics_, char const* name_, Metrics::Timer timer_)
+		: metrics{metrics_}
+		, name{name_}
+		, timer{timer_}
+		, start{std::chrono::steady_clock::now()}
+	{
+	}
+
+	TraceSpan(TraceSpan const&) = delete;
+	TraceSpan& operator=(TraceSpan const&) = delete;
+
+	~TraceSpan()
+	{
+		auto end = std::chrono::steady_clock::now();
+		metrics.record(timer, end - start);
+		if (metrics.isTracing())
+		{
+			metrics.addSpan(name, start, end);
+		}
+	}
+
+private:
+	Metrics const& metrics;
+	char const* name;
+	Metrics::Timer timer;
+	std::chrono::steady_clock::time_point start;
+};
+}
+
+#endif // INDEXER_METRICS_H_
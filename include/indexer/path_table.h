@@ -0,0 +1,141 @@
+#ifndef INDEXER_PATH_TABLE_H_
+#define INDEXER_PATH_TABLE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "indexer/file_id_allocator.h"
+#include "indexer/memory_usage.h"
+
+namespace Indexer
+{
+// File paths stored as (directory, name) pairs over a table of interned directories,
+// so common prefixes are kept once and moving a directory doesn't touch its contents
+class PathTable
+{
+public:
+	PathTable();
+	PathTable(PathTable const&) = delete;  // the child sets point back at the table
+	PathTable& operator=(PathTable const&) = delete;
+
+	void insert(FileId, std::filesystem::path const&);
+	void erase(FileId);
+
+	[[nodiscard]] std::optional<FileId> find(std::filesystem::path const&) const;
+	[[nodiscard]] bool contains(std::filesystem::path const& path) const { return find(path).has_value(); }
+	[[nodiscard]] FileId at(std::filesystem::path const&) const;
+
+	[[nodiscard]] bool contains(FileId fileId) const { return fileId < files.size() && files[fileId].has_value(); }
+	[[nodiscard]] std::filesystem::path path(FileId) const;
+
+	[[nodiscard]] std::vector<FileId> filesUnder(std::filesystem::path const& directory) const;
+
+	// both are O(path depth) and return the ids of files that were overwritten at the destination
+	std::optional<FileId> moveFile(std::filesystem::path const& from, std::filesystem::path const& to);
+	std::vector<FileId> moveDirectory(std::filesystem::path const& from, std::filesystem::path const& to);
+
+	// every file id, each directory's files right before those of its subdirectories, for
+	// FileIdAllocator::compact() to give every directory a contiguous id range
+	[[nodiscard]] std::vector<FileId> directoryOrder() const;
+
+	// see FileIdAllocator::compact(), also places every file
+	void remap(std::vector<FileId> const& newIds);
+
+	// bounds each directory's files by the id range they have now, O(files * path depth)
+	void placeFiles();
+
+	// Where to look for the files under a directory: since the last placeFiles() they were all in
+	// [begin, end) or were put in `others` by insert() and the moves. Either may also hold files
+	// from elsewhere, see isUnder().
+	struct Scope
+	{
+		std::uint32_t directory;
+		FileId begin;
+		FileId end;
+		std::unordered_set<FileId> const* others;  // valid until the table changes
+	};
+	[[nodiscard]] std::optional<Scope> scope(std::filesystem::path const& directory) const;
+	[[nodiscard]] bool isUnder(FileId, Scope const&) const;  // O(path depth)
+
+	// enough files were added or moved since the last placeFiles() that scopes lose their point
+	[[nodiscard]] bool shouldPlaceFiles() const
+	{
+		return hasMovedDirectories || (unplaced.size() >= minUnplacedFiles && unplaced.size() * 4 >= fileCount);
+	}
+
+	[[nodiscard]] std::size_t size() const { return fileCount; }
+
+	// estimated, see memory_usage.h
+	[[nodiscard]] std::size_t memoryUsage() const
+	{
+		return directories.capacity() * sizeof(Directory) + files.capacity() * sizeof(std::optional<File>) + entryBytes;
+	}
+
+private:
+	using Name = std::filesystem::path::string_type;
+	using NameView = std::basic_string_view<Name::value_type>;
+	using DirectoryId = std::uint32_t;
+	static constexpr DirectoryId rootId = 0;
+	static constexpr std::size_t minUnplacedFiles = 1024;
+
+	struct Directory;
+	struct File;
+
+	// A directory's entries are sets of ids, hashed and compared by the name each entry keeps itself,
+	// so that every name is stored once; looked up by NameView
+	template <class Entry>
+	struct ByName
+	{
+		using is_transparent = void;
+
+		NameView nameOf(std::uint32_t id) const;
+		NameView nameOf(NameView name) const { return name; }
+
+		std::size_t operator()(auto const& entry) const { return std::hash<NameView>{}(nameOf(entry)); }
+		bool operator()(auto const& a, auto const& b) const { return nameOf(a) == nameOf(b); }
+
+		PathTable const* table;
+	};
+	template <class Entry>
+	using Entries = std::unordered_set<std::uint32_t, ByName<Entry>, ByName<Entry>>;
+
+	struct Directory
+	{
+		DirectoryId parent;
+		Name name;
+		Entries<Directory> subdirectories;
+		Entries<File> files;
+		FileId firstId{0};  // of the files below it at the last placeFiles()
+		FileId endId{0};
+	};
+	Directory newDirectory(DirectoryId parent, Name name) const;
+	struct File
+	{
+		DirectoryId directory;
+		Name name;
+	};
+
+	std::optional<DirectoryId> findDirectory(std::filesystem::path const&) const;
+	DirectoryId makeDirectory(std::filesystem::path const&);
+	std::filesystem::path directoryPath(DirectoryId) const;
+
+	std::vector<Directory> directories;
+	std::vector<std::optional<File>> files;  // by file id
+	std::size_t fileCount{0};
+	std::size_t entryBytes{0};  // set nodes and names out of line
+
+	std::unordered_set<FileId> unplaced;  // inserted since the last placeFiles()
+	bool hasMovedDirectories{false};  // since the last placeFiles(), so directory ranges can't be trusted
+};
+
+template <>
+PathTable::NameView PathTable::ByName<PathTable::Directory>::nameOf(std::uint32_t) const;
+template <>
+PathTable::NameView PathTable::ByName<PathTable::File>::nameOf(std::uint32_t) const;
+}
+
+#endif // INDEXER_PATH_TABLE_H_
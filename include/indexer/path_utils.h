@@ -1,6 +1,7 @@
 #ifndef INDEXER_PATH_UTILS_H_
 #define INDEXER_PATH_UTILS_H_
 
+#include <algorithm>
 #include <filesystem>
 #include <functional>
 
@@ -23,6 +24,12 @@ inline std::filesystem::path tail(std::filesystem::path const& path)
 {
 	return path.lexically_relative(head(path));
 }
+
+// `root` itself or anything below it
+inline bool isWithin(std::filesystem::path const& path, std::filesystem::path const& root)
+{
+	return std::mismatch(root.begin(), root.end(), path.begin(), path.end()).first == root.end();
+}
 }
 
 #endif // INDEXER_PATH_UTILS_H_
@@ -0,0 +1,48 @@
+#ifndef INDEXER_POSTING_SEGMENT_H_
+#define INDEXER_POSTING_SEGMENT_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "indexer/file_id_allocator.h"
+#include "indexer/mapped_file.h"
+
+namespace Indexer
+{
+// Posting lists spilled out of memory: written once, then read in place through a memory mapping.
+// The file is deleted along with the segment.
+class PostingSegment
+{
+public:
+	struct Extent
+	{
+		std::size_t offset;  // in file ids
+		std::size_t count;
+	};
+
+	// `postings` holds every list back to back, each list is then read back through its Extent
+	PostingSegment(std::filesystem::path file, std::vector<FileId> const& postings, std::size_t listCount);
+
+	PostingSegment(PostingSegment const&) = delete;
+	PostingSegment& operator=(PostingSegment const&) = delete;
+	~PostingSegment();
+
+	[[nodiscard]] std::span<FileId const> postings(Extent) const;
+
+	// lists that haven't been loaded back into memory yet, the segment can go once there are none
+	[[nodiscard]] std::size_t liveLists() const { return liveListCount; }
+	void releaseList() { liveListCount--; }
+
+	[[nodiscard]] std::size_t sizeBytes() const { return mapping->contents().size(); }
+
+private:
+	std::filesystem::path file;
+	std::optional<MappedFile> mapping;
+	std::size_t liveListCount;
+};
+}
+
+#endif // INDEXER_POSTING_SEGMENT_H_
@@ -0,0 +1,156 @@
+#ifndef INDEXER_PRIORITY_QUEUE_H_
+#define INDEXER_PRIORITY_QUEUE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <thread>
+
+#include "indexer/bounded_queue.h"
+
+namespace Indexer
+{
+// One bounded queue per priority class, 0 being the most urgent. pop() takes from the most urgent
+// class that has anything queued, except that a class passed over `starvationLimit` times in a row
+// is served next, so lower classes keep trickling through under a steady stream of urgent work.
+// Once close()d and drained, pop() returns a default-constructed T to every consumer.
+template <class T, std::size_t classCount>
+class PriorityQueue
+{
+public:
+	static constexpr unsigned starvationLimit = 8;
+
+	explicit PriorityQueue(std::size_t capacity)  // of each class
+	{
+		for (auto& queue: queues)
+		{
+			queue = std::make_unique<BoundedQueue<T>>(capacity);
+		}
+	}
+
+	PriorityQueue(PriorityQueue const&) = delete;
+	PriorityQueue& operator=(PriorityQueue const&) = delete;
+
+	void push(std::size_t priority, T value)  // blocks while this class is full, the others are unaffected
+	{
+		depths[priority].fetch_add(1, std::memory_order_relaxed);
+		queues[priority]->push(std::move(value));
+		release();
+	}
+
+	T pop()
+	{
+		while (not tryAcquire())  // one of the queued values is ours once this succeeds, or the close
+		{
+			available.wait(0, std::memory_order_relaxed);
+		}
+		return take();
+	}
+
+	std::optional<T> tryPop()
+	{
+		if (not tryAcquire())
+		{
+			return std::nullopt;
+		}
+		return take();
+	}
+
+	// no pushes after this
+	void close()
+	{
+		isClosed.store(true, std::memory_order_release);
+		release();
+	}
+
+	[[nodiscard]] std::size_t size(std::size_t priority) const { return depths[priority].load(std::memory_order_relaxed); }
+
+private:
+	// a counting semaphore, std::counting_semaphore::try_acquire() spins before giving up
+	bool tryAcquire()
+	{
+		auto count = available.load(std::memory_order_acquire);
+		while (count > 0)
+		{
+			if (available.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void release()
+	{
+		available.fetch_add(1, std::memory_order_release);
+		available.notify_all();
+	}
+
+	T take()
+	{
+		while (true)
+		{
+			if (auto value = tryPopScheduled())
+			{
+				return std::move(*value);
+			}
+			if (isClosed.load(std::memory_order_acquire))  // nothing left and nothing coming
+			{
+				release();  // for the next consumer
+				return T{};
+			}
+			std::this_thread::yield();  // a producer is still filling a cell ahead of ours
+		}
+	}
+
+	std::optional<T> tryPopScheduled()
+	{
+		for (std::size_t i = 1; i < classCount; i++)
+		{
+			if (passedOver[i].load(std::memory_order_relaxed) >= starvationLimit)
+			{
+				if (auto value = tryPop(i))
+				{
+					return value;
+				}
+			}
+		}
+		for (std::size_t i = 0; i < classCount; i++)
+		{
+			if (auto value = tryPop(i))
+			{
+				for (auto j = i + 1; j < classCount; j++)
+				{
+					if (depths[j].load(std::memory_order_relaxed) > 0)
+					{
+						passedOver[j].fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+				return value;
+			}
+		}
+		return std::nullopt;
+	}
+
+	std::optional<T> tryPop(std::size_t priority)
+	{
+		auto value = queues[priority]->tryPop();
+		if (value)
+		{
+			depths[priority].fetch_sub(1, std::memory_order_relaxed);
+			passedOver[priority].store(0, std::memory_order_relaxed);
+		}
+		return value;
+	}
+
+	std::array<std::unique_ptr<BoundedQueue<T>>, classCount> queues;
+	std::array<std::atomic<std::size_t>, classCount> depths{};  // counted from before a blocked push
+	std::array<std::atomic<unsigned>, classCount> passedOver{};
+	std::atomic<std::size_t> available{0};  // values queued, plus one once closed
+	std::atomic<bool> isClosed{false};
+};
+}
+
+#endif // INDEXER_PRIORITY_QUEUE_H_
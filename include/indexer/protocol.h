@@ -0,0 +1,67 @@
+#ifndef INDEXER_PROTOCOL_H_
+#define INDEXER_PROTOCOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Messages between indexerd and its clients. Each one is a frame: its length (not counting the
+// length itself), the request id and the opcode, then for responses a status, then the payload.
+// Integers are little-endian u32 unless noted, strings and lists are prefixed with their length.
+//
+//   Add     request: u8 recursive, absolute path  response: -
+//   Search  request: terms                       response: for each term, the paths holding it
+//   Stats   request: -                           response: the stats as text
+//
+// A response with the Error status carries the reason instead of its payload.
+namespace Indexer::Protocol
+{
+enum class Opcode: std::uint8_t
+{
+	Add, Search, Stats
+};
+
+enum class Status: std::uint8_t
+{
+	Ok, Error
+};
+
+struct Request
+{
+	std::uint32_t id{0};
+	Opcode opcode{Opcode::Search};
+	std::vector<std::string> arguments{};  // the path for Add, the terms for Search
+	bool isRecursive{false};  // for Add
+};
+
+struct Response
+{
+	std::uint32_t id{0};
+	Opcode opcode{Opcode::Search};
+	Status status{Status::Ok};
+	std::vector<std::vector<std::string>> results{};  // by term, for Search
+	std::string message{};  // the stats for Stats, the reason for Error
+};
+
+inline constexpr std::size_t maxFrameSize = 64 << 20;
+
+class ProtocolError: public std::runtime_error
+{
+public:
+	using std::runtime_error::runtime_error;
+};
+
+// append one frame
+void encode(Request const&, std::string& out);
+void encode(Response const&, std::string& out);
+
+// decode the frame at the start of `in`: the bytes it took, or 0 if it isn't all there yet;
+// throws ProtocolError if it is malformed, the stream can't be trusted after that
+std::size_t decode(std::string_view in, Request&);
+std::size_t decode(std::string_view in, Response&);
+}
+
+#endif // INDEXER_PROTOCOL_H_
@@ -0,0 +1,32 @@
+#ifndef INDEXER_SERVER_H_
+#define INDEXER_SERVER_H_
+
+#include <filesystem>
+#include <memory>
+
+namespace Indexer
+{
+class Indexer;
+class ServerImpl;
+
+// Serves one Indexer to local clients over a Unix domain socket, see protocol.h for the messages.
+// All connections are served from the thread in run(). Clients may pipeline requests: searches and
+// stats are answered in order as soon as they are read, adds run in the background and are
+// answered once done, possibly after later requests.
+class Server
+{
+public:
+	Server(Indexer&, std::filesystem::path socketPath);  // replaces a stale socket file
+	Server(Server const&) = delete;
+	Server& operator=(Server const&) = delete;
+	~Server();
+
+	void run();  // until requestStop()
+	void requestStop();  // from any thread
+
+private:
+	std::unique_ptr<ServerImpl> pImpl;
+};
+}
+
+#endif // INDEXER_SERVER_H_
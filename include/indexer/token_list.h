@@ -0,0 +1,99 @@
+#ifndef INDEXER_TOKEN_LIST_H_
+#define INDEXER_TOKEN_LIST_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Indexer
+{
+// for maps keyed by std::string and looked up by string_view, with std::equal_to<>
+struct TokenHasher
+{
+	using is_transparent = void;
+	std::size_t operator()(std::string_view token) const { return std::hash<std::string_view>{}(token); }
+};
+
+// A file's distinct tokens, sorted and packed into one buffer: two allocations however many there are.
+class TokenList
+{
+public:
+	class Iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::string_view;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = std::string_view;
+
+		Iterator() = default;
+		Iterator(TokenList const* list_, std::size_t index_): list{list_}, index{index_} {}
+
+		std::string_view operator*() const { return (*list)[index]; }
+		Iterator& operator++() { index++; return *this; }
+		Iterator operator++(int) { auto old = *this; index++; return old; }
+		bool operator==(Iterator const& other) const { return index == other.index; }
+
+	private:
+		TokenList const* list{nullptr};
+		std::size_t index{0};
+	};
+
+	TokenList() = default;
+
+	[[nodiscard]] std::size_t size() const { return ends.size(); }
+	[[nodiscard]] bool empty() const { return ends.empty(); }
+	[[nodiscard]] std::string_view operator[](std::size_t index) const
+	{
+		auto begin = index == 0 ? 0 : ends[index - 1];
+		return std::string_view{bytes}.substr(begin, ends[index] - begin);
+	}
+	[[nodiscard]] Iterator begin() const { return {this, 0}; }
+	[[nodiscard]] Iterator end() const { return {this, size()}; }
+
+	[[nodiscard]] bool contains(std::string_view token) const;
+	[[nodiscard]] static TokenList merged(TokenList const&, TokenList const&);
+	[[nodiscard]] static TokenList fromSorted(std::span<std::string_view const> tokens);  // already distinct and in order
+	[[nodiscard]] std::size_t memoryUsage() const { return sizeof(*this) + bytes.capacity() + ends.capacity() * sizeof(ends[0]); }
+
+private:
+	friend class TokenCollector;
+
+	std::string bytes;
+	std::vector<std::uint32_t> ends;  // of each token in `bytes`
+};
+
+// Deduplicates the tokens of one file at a time: an open addressing table over copies of them in
+// an arena. take() leaves it empty but keeps the memory, for the next file to reuse.
+class TokenCollector
+{
+public:
+	void insert(std::string_view token);
+	[[nodiscard]] std::size_t size() const { return entries.size(); }
+	[[nodiscard]] TokenList take();
+
+private:
+	struct Entry
+	{
+		std::uint32_t offset;  // in `arena`
+		std::uint32_t length;
+		std::size_t hash;
+		std::size_t slot;
+	};
+
+	[[nodiscard]] std::string_view token(Entry const& entry) const { return std::string_view{arena}.substr(entry.offset, entry.length); }
+	void grow();
+
+	std::string arena;
+	std::vector<Entry> entries;
+	std::vector<std::uint32_t> slots;  // entry index + 1, 0 for none
+};
+}
+
+#endif // INDEXER_TOKEN_LIST_H_
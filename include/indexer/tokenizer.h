@@ -0,0 +1,111 @@
+#ifndef INDEXER_TOKENIZER_H_
+#define INDEXER_TOKENIZER_H_
+
+#include <algorithm>
+#include <cctype>
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace Indexer
+{
+// what a search needle goes through to match the tokens of a tokenizer; an enumeration rather
+// than code so that published indexes can record it for readers without the tokenizers
+enum class Normalization : std::uint8_t
+{
+	None,
+	FoldCase,  // simple Unicode case folding, see Unicode::foldCase()
+};
+
+[[nodiscard]] std::string normalized(std::string_view needle, Normalization);
+
+class Tokenizer
+{
+public:
+	virtual void sendLine(std::string_view newLine) = 0;
+	virtual void sendEof() = 0;
+
+	virtual std::unique_ptr<Tokenizer> clone() const = 0;
+
+	[[nodiscard]] virtual std::string_view next() = 0;
+	virtual bool done() const = 0;
+
+	[[nodiscard]] virtual Normalization normalization() const { return Normalization::None; }
+	[[nodiscard]] std::string normalize(std::string_view needle) const { return normalized(needle, normalization()); }
+
+	virtual ~Tokenizer() = default;
+};
+
+template <class T>
+concept DerivedTokenizer = std::derived_from<T, Tokenizer>;
+
+// runs of the characters IsWordCharacter accepts
+template <class IsWordCharacter>
+class CharacterClassTokenizer final: public Tokenizer
+{
+public:
+	virtual void sendLine(std::string_view newLine) override
+	{
+		source = newLine;
+		cursor = std::find_if(source.begin(), source.end(), isWordCharacter);
+		isDone = false;
+		findNext();
+	}
+
+	virtual void sendEof() override {}
+
+	virtual std::unique_ptr<Tokenizer> clone() const override { return std::make_unique<CharacterClassTokenizer>(); }
+
+	[[nodiscard]] virtual std::string_view next() override
+	{
+		auto t = nextToken;
+		findNext();
+		return t;
+	}
+
+	virtual bool done() const override { return isDone; }
+
+private:
+	void findNext()
+	{
+		if (isDone)
+		{
+			return;
+		}
+
+		if (cursor == source.end())
+		{
+			isDone = true;
+			return;
+		}
+
+		auto end = std::find_if_not(cursor, source.end(), isWordCharacter);
+		nextToken = std::string_view{cursor, end}; 
+		cursor = std::find_if(end, source.end(), isWordCharacter);
+	}
+
+	static constexpr IsWordCharacter isWordCharacter{};
+
+	std::string_view source;
+	std::string_view nextToken;
+	std::string_view::iterator cursor;
+	bool isDone{true};
+};
+
+struct IsAlphanumeric
+{
+	bool operator()(auto c) const { return c >= 0 && c < 256 && std::isalnum(c); }
+};
+
+struct IsIdentifierCharacter
+{
+	bool operator()(auto c) const { return c == '_' || IsAlphanumeric{}(c); }
+};
+
+using WordTokenizer = CharacterClassTokenizer<IsAlphanumeric>;
+using IdentifierTokenizer = CharacterClassTokenizer<IsIdentifierCharacter>;  // keeps snake_case names whole
+}
+
+#endif // INDEXER_TOKENIZER_H_
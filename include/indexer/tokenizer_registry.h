@@ -0,0 +1,73 @@
+#ifndef INDEXER_TOKENIZER_REGISTRY_H_
+#define INDEXER_TOKENIZER_REGISTRY_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "indexer/glob.h"
+#include "indexer/tokenizer.h"
+
+namespace Indexer
+{
+// Which tokenizer each file gets: the first pattern matching its path, else the first sniffer
+// accepting its contents, else the fallback. Each thread tokenizing makes its own instance of
+// each tokenizer once and reuses it for every file after that.
+class TokenizerRegistry
+{
+public:
+	using Factory = std::function<std::unique_ptr<Tokenizer>()>;
+	using Sniffer = std::function<bool(std::string_view contents)>;
+
+	TokenizerRegistry();  // WordTokenizer for everything
+	explicit TokenizerRegistry(Factory fallback);
+
+	template <DerivedTokenizer T>
+	static Factory factoryOf(T prototype)
+	{
+		return [prototype = std::make_shared<T>(std::move(prototype))]() { return prototype->clone(); };
+	}
+
+	// patterns without a `/` are matched against the file name, the rest against the full path
+	TokenizerRegistry& add(std::string_view pattern, Factory);
+	TokenizerRegistry& add(Sniffer, Factory);
+
+	// identifiers in source code and scripts kept whole, words everywhere else
+	[[nodiscard]] static TokenizerRegistry sourceCode();
+
+	using Index = std::uint16_t;  // 0 is the fallback
+	[[nodiscard]] Index select(std::filesystem::path const&, std::string_view contents) const;
+	[[nodiscard]] Tokenizer& get(Index) const;  // this thread's instance
+
+	[[nodiscard]] std::size_t size() const { return entries.size(); }
+	[[nodiscard]] Normalization normalizationOf(Index index) const { return entries[index].normalizer->normalization(); }
+
+	struct Needle
+	{
+		std::string term;
+		std::vector<Index> tokenizers;  // those that normalize the needle to it, it only matches their files
+	};
+	// what the needle becomes for each tokenizer, without duplicates
+	[[nodiscard]] std::vector<Needle> normalize(std::string_view needle) const;
+
+private:
+	struct Entry
+	{
+		std::optional<Glob> pattern;
+		Sniffer sniffer;
+		Factory factory;
+		std::unique_ptr<Tokenizer> normalizer;
+	};
+	TokenizerRegistry& add(Entry);
+
+	std::vector<Entry> entries;
+	std::uint64_t id;  // tells this registry's instances in the threads' pools from those of previous ones
+};
+}
+
+#endif // INDEXER_TOKENIZER_REGISTRY_H_
@@ -0,0 +1,342 @@
+#ifndef INDEXER_UNICODE_H_
+#define INDEXER_UNICODE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Just enough Unicode for tokenizing: UTF-8 decoding, which code points make up words, and
+// simple (one to one) case folding. The classification approximates the Alphabetic, Mark and
+// Decimal_Number properties by block for the scripts in use today; folding covers the BMP
+// scripts with case. Both tables are built at compile time from the ranges below.
+namespace Indexer::Unicode
+{
+inline constexpr char32_t invalid = 0xFFFFFFFF;  // from decode(), for malformed UTF-8
+inline constexpr char32_t maxCodePoint = 0x10FFFF;
+
+namespace Detail
+{
+struct Range
+{
+	char32_t first;
+	char32_t last;
+};
+
+// letters, combining marks and digits
+inline constexpr Range wordRanges[] = {
+	{0x0030, 0x0039}, {0x0041, 0x005A}, {0x0061, 0x007A}, {0x00AA, 0x00AA}, {0x00B5, 0x00B5}, {0x00BA, 0x00BA},
+	{0x00C0, 0x00D6}, {0x00D8, 0x00F6}, {0x00F8, 0x02C1}, {0x02C6, 0x02D1}, {0x02E0, 0x02E4}, {0x02EC, 0x02EC},
+	{0x02EE, 0x02EE}, {0x0300, 0x0374}, {0x0376, 0x0377}, {0x037A, 0x037D}, {0x037F, 0x037F}, {0x0386, 0x0386},
+	{0x0388, 0x038A}, {0x038C, 0x038C}, {0x038E, 0x03A1}, {0x03A3, 0x03F5}, {0x03F7, 0x0481}, {0x0483, 0x052F},
+	{0x0531, 0x0556}, {0x0559, 0x0559}, {0x0560, 0x0588}, {0x0591, 0x05BD}, {0x05BF, 0x05BF}, {0x05C1, 0x05C2},
+	{0x05C4, 0x05C5}, {0x05C7, 0x05C7}, {0x05D0, 0x05EA}, {0x05EF, 0x05F2}, {0x0610, 0x061A}, {0x0620, 0x0669},
+	{0x066E, 0x06D3}, {0x06D5, 0x06DC}, {0x06DF, 0x06E8}, {0x06EA, 0x06FC}, {0x06FF, 0x06FF}, {0x0710, 0x074A},
+	{0x074D, 0x07B1}, {0x07C0, 0x07F5}, {0x0800, 0x082D}, {0x0840, 0x085B}, {0x0860, 0x086A}, {0x08A0, 0x08E1},
+	{0x08E3, 0x0963}, {0x0966, 0x096F}, {0x0971, 0x0DF3}, {0x0E01, 0x0E3A}, {0x0E40, 0x0E4E}, {0x0E50, 0x0E59},
+	{0x0E81, 0x0EDF}, {0x0F00, 0x0F00}, {0x0F18, 0x0F19}, {0x0F20, 0x0F29}, {0x0F35, 0x0F35}, {0x0F37, 0x0F37},
+	{0x0F39, 0x0F39}, {0x0F3E, 0x0FBC}, {0x0FC6, 0x0FC6}, {0x1000, 0x1049}, {0x1050, 0x109D}, {0x10A0, 0x10C5},
+	{0x10C7, 0x10C7}, {0x10CD, 0x10CD}, {0x10D0, 0x10FA}, {0x10FC, 0x135A}, {0x135D, 0x135F}, {0x1380, 0x138F},
+	{0x13A0, 0x13F5}, {0x13F8, 0x13FD}, {0x1401, 0x166C}, {0x166F, 0x167F}, {0x1681, 0x169A}, {0x16A0, 0x16EA},
+	{0x16EE, 0x16F8}, {0x1700, 0x1734}, {0x1740, 0x1753}, {0x1760, 0x1773}, {0x1780, 0x17D3}, {0x17D7, 0x17D7},
+	{0x17DC, 0x17DD}, {0x17E0, 0x17E9}, {0x180B, 0x180D}, {0x1810, 0x1819}, {0x1820, 0x1878}, {0x1880, 0x18AA},
+	{0x18B0, 0x18F5}, {0x1900, 0x193B}, {0x1946, 0x196D}, {0x1970, 0x1974}, {0x1980, 0x19AB}, {0x19B0, 0x19C9},
+	{0x19D0, 0x19D9}, {0x1A00, 0x1A1B}, {0x1A20, 0x1A7C}, {0x1A7F, 0x1A89}, {0x1A90, 0x1A99}, {0x1AA7, 0x1AA7},
+	{0x1AB0, 0x1ACE}, {0x1B00, 0x1B4C}, {0x1B50, 0x1B59}, {0x1B6B, 0x1B73}, {0x1B80, 0x1BF3}, {0x1C00, 0x1C37},
+	{0x1C40, 0x1C49}, {0x1C4D, 0x1C7D}, {0x1C80, 0x1C88}, {0x1C90, 0x1CBA}, {0x1CBD, 0x1CBF}, {0x1CD0, 0x1CD2},
+	{0x1CD4, 0x1CFA}, {0x1D00, 0x1F15}, {0x1F18, 0x1F1D}, {0x1F20, 0x1F45}, {0x1F48, 0x1F4D}, {0x1F50, 0x1F57},
+	{0x1F59, 0x1F59}, {0x1F5B, 0x1F5B}, {0x1F5D, 0x1F5D}, {0x1F5F, 0x1F7D}, {0x1F80, 0x1FB4}, {0x1FB6, 0x1FBC},
+	{0x1FBE, 0x1FBE}, {0x1FC2, 0x1FC4}, {0x1FC6, 0x1FCC}, {0x1FD0, 0x1FD3}, {0x1FD6, 0x1FDB}, {0x1FE0, 0x1FEC},
+	{0x1FF2, 0x1FF4}, {0x1FF6, 0x1FFC}, {0x2071, 0x2071}, {0x207F, 0x207F}, {0x2090, 0x209C}, {0x20D0, 0x20F0},
+	{0x2102, 0x2102}, {0x2107, 0x2107}, {0x210A, 0x2113}, {0x2115, 0x2115}, {0x2119, 0x211D}, {0x2124, 0x2124},
+	{0x2126, 0x2126}, {0x2128, 0x2128}, {0x212A, 0x212D}, {0x212F, 0x2139}, {0x213C, 0x213F}, {0x2145, 0x2149},
+	{0x214E, 0x214E}, {0x2160, 0x2188}, {0x2C00, 0x2CE4}, {0x2CEB, 0x2CF3}, {0x2D00, 0x2D25}, {0x2D27, 0x2D27},
+	{0x2D2D, 0x2D2D}, {0x2D30, 0x2D67}, {0x2D6F, 0x2D6F}, {0x2D7F, 0x2D96}, {0x2DA0, 0x2DFF}, {0x3005, 0x3007},
+	{0x3021, 0x302F}, {0x3031, 0x3035}, {0x3038, 0x303C}, {0x3041, 0x3096}, {0x3099, 0x309A}, {0x309D, 0x309F},
+	{0x30A1, 0x30FA}, {0x30FC, 0x30FF}, {0x3105, 0x312F}, {0x3131, 0x318E}, {0x31A0, 0x31BF}, {0x31F0, 0x31FF},
+	{0x3400, 0x4DBF}, {0x4E00, 0xA48C}, {0xA4D0, 0xA4FD}, {0xA500, 0xA60C}, {0xA610, 0xA62B}, {0xA640, 0xA672},
+	{0xA674, 0xA67D}, {0xA67F, 0xA6F1}, {0xA717, 0xA71F}, {0xA722, 0xA788}, {0xA78B, 0xA7CA}, {0xA7D0, 0xA7D9},
+	{0xA7F2, 0xA827}, {0xA82C, 0xA82C}, {0xA840, 0xA873}, {0xA880, 0xA8C5}, {0xA8D0, 0xA8D9}, {0xA8E0, 0xA8F7},
+	{0xA8FB, 0xA8FB}, {0xA8FD, 0xA92D}, {0xA930, 0xA953}, {0xA960, 0xA97C}, {0xA980, 0xA9C0}, {0xA9CF, 0xA9D9},
+	{0xA9E0, 0xA9FE}, {0xAA00, 0xAA36}, {0xAA40, 0xAA4D}, {0xAA50, 0xAA59}, {0xAA60, 0xAA76}, {0xAA7A, 0xAAC2},
+	{0xAADB, 0xAADD}, {0xAAE0, 0xAAEF}, {0xAAF2, 0xAAF6}, {0xAB01, 0xAB2E}, {0xAB30, 0xAB5A}, {0xAB5C, 0xAB69},
+	{0xAB70, 0xABEA}, {0xABEC, 0xABED}, {0xABF0, 0xABF9}, {0xAC00, 0xD7A3}, {0xD7B0, 0xD7C6}, {0xD7CB, 0xD7FB},
+	{0xF900, 0xFA6D}, {0xFA70, 0xFAD9}, {0xFB00, 0xFB06}, {0xFB13, 0xFB17}, {0xFB1D, 0xFB28}, {0xFB2A, 0xFB4F},
+	{0xFB50, 0xFBB1}, {0xFBD3, 0xFD3D}, {0xFD50, 0xFD8F}, {0xFD92, 0xFDC7}, {0xFDF0, 0xFDFB}, {0xFE00, 0xFE0F},
+	{0xFE20, 0xFE2F}, {0xFE70, 0xFE74}, {0xFE76, 0xFEFC}, {0xFF10, 0xFF19}, {0xFF21, 0xFF3A}, {0xFF41, 0xFF5A},
+	{0xFF66, 0xFFBE}, {0xFFC2, 0xFFC7}, {0xFFCA, 0xFFCF}, {0xFFD2, 0xFFD7}, {0xFFDA, 0xFFDC}, {0x10000, 0x100FA},
+	{0x10280, 0x1031F}, {0x1032D, 0x1034A}, {0x10350, 0x1037A}, {0x10380, 0x1039D}, {0x103A0, 0x103CF},
+	{0x10400, 0x1049D}, {0x104A0, 0x104A9}, {0x104B0, 0x104FB}, {0x10500, 0x10563}, {0x10570, 0x105BC},
+	{0x10600, 0x10767}, {0x10780, 0x107BA}, {0x10800, 0x10855}, {0x10860, 0x10876}, {0x10880, 0x1089E},
+	{0x10900, 0x10915}, {0x10920, 0x10939}, {0x10980, 0x109B7}, {0x10A00, 0x10A3F}, {0x10A60, 0x10A7C},
+	{0x10C00, 0x10C48}, {0x10C80, 0x10CF2}, {0x10D00, 0x10D39}, {0x11000, 0x11046}, {0x11066, 0x110C2},
+	{0x11100, 0x1113F}, {0x11150, 0x111C4}, {0x11200, 0x1123E}, {0x11280, 0x112F9}, {0x11300, 0x11374},
+	{0x11400, 0x1144A}, {0x11450, 0x11459}, {0x11480, 0x114D9}, {0x11580, 0x115C0}, {0x11600, 0x11640},
+	{0x11650, 0x11659}, {0x11680, 0x116C9}, {0x11700, 0x1173B}, {0x11800, 0x1183A}, {0x118A0, 0x118E9},
+	{0x11A00, 0x11A3E}, {0x11A50, 0x11A99}, {0x11C00, 0x11C40}, {0x11C50, 0x11C59}, {0x11D00, 0x11D59},
+	{0x12000, 0x12399}, {0x12400, 0x1246E}, {0x12480, 0x12543}, {0x13000, 0x1342E}, {0x14400, 0x14646},
+	{0x16800, 0x16A38}, {0x16A40, 0x16A69}, {0x16AD0, 0x16AF4}, {0x16B00, 0x16B36}, {0x16B40, 0x16B59},
+	{0x16E40, 0x16E7F}, {0x16F00, 0x16F9F}, {0x16FE0, 0x16FE4}, {0x17000, 0x187F7}, {0x18800, 0x18CD5},
+	{0x1B000, 0x1B122}, {0x1B150, 0x1B152}, {0x1B164, 0x1B167}, {0x1B170, 0x1B2FB}, {0x1BC00, 0x1BC99},
+	{0x1D165, 0x1D169}, {0x1D16D, 0x1D172}, {0x1D17B, 0x1D182}, {0x1D400, 0x1D6C0}, {0x1D6C2, 0x1D6DA},
+	{0x1D6DC, 0x1D6FA}, {0x1D6FC, 0x1D714}, {0x1D716, 0x1D734}, {0x1D736, 0x1D74E}, {0x1D750, 0x1D76E},
+	{0x1D770, 0x1D788}, {0x1D78A, 0x1D7A8}, {0x1D7AA, 0x1D7C2}, {0x1D7C4, 0x1D7CB}, {0x1D7CE, 0x1D7FF},
+	{0x1E800, 0x1E8C4}, {0x1E900, 0x1E94B}, {0x1E950, 0x1E959}, {0x1EE00, 0x1EEBB}, {0x20000, 0x2A6DF},
+	{0x2A700, 0x2EBE0}, {0x2F800, 0x2FA1D}, {0x30000, 0x3134A}, {0xE0100, 0xE01EF},
+};
+
+// upper case and title case to folded: `first`, and every `stride`-th code point after it up to `last`
+struct FoldRange
+{
+	char32_t first;
+	char32_t last;
+	std::int32_t delta;
+	char32_t stride;
+};
+
+inline constexpr FoldRange foldRanges[] = {
+	{0x0041, 0x005A, 32, 1}, {0x00B5, 0x00B5, 775, 1}, {0x00C0, 0x00D6, 32, 1}, {0x00D8, 0x00DE, 32, 1},
+	{0x0100, 0x012E, 1, 2}, {0x0132, 0x0136, 1, 2}, {0x0139, 0x0147, 1, 2}, {0x014A, 0x0176, 1, 2},
+	{0x0178, 0x0178, -121, 1}, {0x0179, 0x017D, 1, 2}, {0x017F, 0x017F, -268, 1}, {0x01CD, 0x01DB, 1, 2},
+	{0x01DE, 0x01EE, 1, 2}, {0x01F8, 0x021E, 1, 2}, {0x0222, 0x0232, 1, 2}, {0x0246, 0x024E, 1, 2},
+	{0x0386, 0x0386, 38, 1}, {0x0388, 0x038A, 37, 1}, {0x038C, 0x038C, 64, 1}, {0x038E, 0x038F, 63, 1},
+	{0x0391, 0x03A1, 32, 1}, {0x03A3, 0x03AB, 32, 1}, {0x03C2, 0x03C2, 1, 1}, {0x03D8, 0x03EE, 1, 2},
+	{0x0400, 0x040F, 80, 1}, {0x0410, 0x042F, 32, 1}, {0x0460, 0x0480, 1, 2}, {0x048A, 0x04BE, 1, 2},
+	{0x04C0, 0x04C0, 15, 1}, {0x04C1, 0x04CD, 1, 2}, {0x04D0, 0x052E, 1, 2}, {0x0531, 0x0556, 48, 1},
+	{0x10A0, 0x10C5, 7264, 1}, {0x10C7, 0x10C7, 7264, 1}, {0x10CD, 0x10CD, 7264, 1}, {0x13F8, 0x13FD, -8, 1},
+	{0x1E00, 0x1E94, 1, 2}, {0x1E9E, 0x1E9E, -7615, 1}, {0x1EA0, 0x1EFE, 1, 2}, {0x1F08, 0x1F0F, -8, 1},
+	{0x1F18, 0x1F1D, -8, 1}, {0x1F28, 0x1F2F, -8, 1}, {0x1F38, 0x1F3F, -8, 1}, {0x1F48, 0x1F4D, -8, 1},
+	{0x1F59, 0x1F5F, -8, 2}, {0x1F68, 0x1F6F, -8, 1}, {0x1F88, 0x1F8F, -8, 1}, {0x1F98, 0x1F9F, -8, 1},
+	{0x1FA8, 0x1FAF, -8, 1}, {0x1FB8, 0x1FB9, -8, 1}, {0x1FBA, 0x1FBB, -74, 1}, {0x1FBC, 0x1FBC, -9, 1},
+	{0x1FC8, 0x1FCB, -86, 1}, {0x1FCC, 0x1FCC, -9, 1}, {0x1FD8, 0x1FD9, -8, 1}, {0x1FDA, 0x1FDB, -100, 1},
+	{0x1FE8, 0x1FE9, -8, 1}, {0x1FEA, 0x1FEB, -112, 1}, {0x1FEC, 0x1FEC, -7, 1}, {0x1FF8, 0x1FF9, -128, 1},
+	{0x1FFA, 0x1FFB, -126, 1}, {0x1FFC, 0x1FFC, -9, 1}, {0x2126, 0x2126, -7517, 1}, {0x212A, 0x212A, -8383, 1},
+	{0x212B, 0x212B, -8262, 1}, {0x2160, 0x216F, 16, 1}, {0x2C00, 0x2C2F, 48, 1}, {0x2C80, 0x2CE2, 1, 2},
+	{0xA640, 0xA66C, 1, 2}, {0xA680, 0xA69A, 1, 2}, {0xA722, 0xA72E, 1, 2}, {0xA732, 0xA76E, 1, 2},
+	{0xA779, 0xA77B, 1, 2}, {0xA77E, 0xA786, 1, 2}, {0xA78B, 0xA78B, 1, 1}, {0xA790, 0xA792, 1, 2},
+	{0xA796, 0xA7A8, 1, 2}, {0xFF21, 0xFF3A, 32, 1},
+};
+
+// Two-stage tables: the code points are split into blocks of 256, each block's entry in `blockIndex`
+// points at its row in `rows`. Blocks with the same contents share a row, which keeps them small.
+inline constexpr std::size_t blockBits = 8;
+inline constexpr std::size_t blockSize = 1 << blockBits;
+
+template <class Row, std::size_t blockCount, std::size_t maxRows>
+struct TwoStageTable
+{
+	std::array<std::uint8_t, blockCount> blockIndex{};
+	std::array<Row, maxRows> rows{};
+	std::size_t rowCount{0};
+
+	constexpr void add(std::size_t block, Row const& row)
+	{
+		if (block > 0 && rows[blockIndex[block - 1]] == row)  // runs of empty or full blocks
+		{
+			blockIndex[block] = blockIndex[block - 1];
+			return;
+		}
+		for (std::size_t i = 0; i < rowCount; i++)
+		{
+			if (rows[i] == row)
+			{
+				blockIndex[block] = static_cast<std::uint8_t>(i);
+				return;
+			}
+		}
+		rows[rowCount] = row;  // running out of rows fails constant evaluation
+		blockIndex[block] = static_cast<std::uint8_t>(rowCount++);
+	}
+};
+
+using WordRow = std::array<std::uint64_t, blockSize / 64>;  // a bit per code point
+using WordTable = TwoStageTable<WordRow, (maxCodePoint + 1) / blockSize, 128>;
+
+constexpr WordTable makeWordTable()
+{
+	WordTable table;
+	std::size_t nextRange = 0;  // the ranges are sorted, each block only looks at those reaching into it
+	for (std::size_t block = 0; block < table.blockIndex.size(); block++)
+	{
+		auto base = static_cast<char32_t>(block * blockSize);
+		auto end = static_cast<char32_t>(base + blockSize);
+		WordRow row{};
+		for (auto r = nextRange; r < std::size(wordRanges) && wordRanges[r].first < end; r++)
+		{
+			for (auto c = std::max(wordRanges[r].first, base); c <= std::min<char32_t>(wordRanges[r].last, end - 1); c++)
+			{
+				row[(c - base) / 64] |= std::uint64_t{1} << ((c - base) % 64);
+			}
+		}
+		while (nextRange < std::size(wordRanges) && wordRanges[nextRange].last < end)
+		{
+			nextRange++;
+		}
+		table.add(block, row);
+	}
+	return table;
+}
+
+using FoldRow = std::array<std::int16_t, blockSize>;  // delta to the folded code point
+using FoldTable = TwoStageTable<FoldRow, 0x10000 / blockSize, 32>;  // only the BMP has folding here
+
+constexpr FoldTable makeFoldTable()
+{
+	FoldTable table;
+	for (std::size_t block = 0; block < table.blockIndex.size(); block++)
+	{
+		auto base = static_cast<char32_t>(block * blockSize);
+		FoldRow row{};
+		for (auto range: foldRanges)
+		{
+			if (range.last < base || range.first >= base + blockSize)
+			{
+				continue;
+			}
+			for (auto c = range.first; c <= range.last; c += range.stride)
+			{
+				if (c >= base && c < base + blockSize)
+				{
+					row[c - base] = static_cast<std::int16_t>(range.delta);
+				}
+			}
+		}
+		table.add(block, row);
+	}
+	return table;
+}
+
+inline constexpr WordTable wordTable = makeWordTable();
+inline constexpr FoldTable foldTable = makeFoldTable();
+
+// ASCII on its own, most text is mostly ASCII
+inline constexpr auto asciiWordTable = []()
+{
+	std::array<bool, 128> table{};
+	for (char32_t c = 0; c < 128; c++)
+	{
+		table[c] = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+	}
+	return table;
+}();
+}
+
+constexpr bool isWordCharacter(char32_t c)
+{
+	if (c < 128)
+	{
+		return Detail::asciiWordTable[c];
+	}
+	if (c > maxCodePoint)
+	{
+		return false;
+	}
+	auto const& row = Detail::wordTable.rows[Detail::wordTable.blockIndex[c >> Detail::blockBits]];
+	auto offset = c & (Detail::blockSize - 1);
+	return (row[offset / 64] >> (offset % 64)) & 1;
+}
+
+constexpr char32_t foldCase(char32_t c)
+{
+	if (c < 128)
+	{
+		return c >= 'A' && c <= 'Z' ? c + 32 : c;
+	}
+	if (c > 0xFFFF)
+	{
+		return c;
+	}
+	auto const& row = Detail::foldTable.rows[Detail::foldTable.blockIndex[c >> Detail::blockBits]];
+	return static_cast<char32_t>(static_cast<std::int32_t>(c) + row[c & (Detail::blockSize - 1)]);
+}
+
+// decodes the code point at `position` and moves past it; rejects overlong forms and surrogates,
+// a malformed sequence gives `invalid` and skips a single byte
+constexpr char32_t decode(std::string_view text, std::size_t& position)
+{
+	auto byte = [&](std::size_t i) { return static_cast<unsigned char>(text[i]); };
+	auto lead = byte(position);
+	if (lead < 0x80)
+	{
+		position++;
+		return lead;
+	}
+
+	std::size_t length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 0;
+	if (length == 0 || lead > 0xF4 || position + length > text.size())
+	{
+		position++;
+		return invalid;
+	}
+	char32_t c = lead & (0x7F >> length);
+	for (std::size_t i = 1; i < length; i++)
+	{
+		if ((byte(position + i) & 0xC0) != 0x80)
+		{
+			position++;
+			return invalid;
+		}
+		c = (c << 6) | (byte(position + i) & 0x3F);
+	}
+	constexpr char32_t minimum[] = {0, 0, 0x80, 0x800, 0x10000};
+	if (c < minimum[length] || c > maxCodePoint || (c >= 0xD800 && c <= 0xDFFF))
+	{
+		position++;
+		return invalid;
+	}
+	position += length;
+	return c;
+}
+
+inline void encode(char32_t c, std::string& out)
+{
+	if (c < 0x80)
+	{
+		out += static_cast<char>(c);
+	}
+	else if (c < 0x800)
+	{
+		out += static_cast<char>(0xC0 | (c >> 6));
+		out += static_cast<char>(0x80 | (c & 0x3F));
+	}
+	else if (c < 0x10000)
+	{
+		out += static_cast<char>(0xE0 | (c >> 12));
+		out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+		out += static_cast<char>(0x80 | (c & 0x3F));
+	}
+	else
+	{
+		out += static_cast<char>(0xF0 | (c >> 18));
+		out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+		out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+		out += static_cast<char>(0x80 | (c & 0x3F));
+	}
+}
+
+// case folds UTF-8 text, malformed bytes are kept as they are
+inline void appendFolded(std::string_view text, std::string& out)
+{
+	std::size_t position = 0;
+	while (position < text.size())
+	{
+		auto byte = static_cast<unsigned char>(text[position]);
+		if (byte < 0x80)
+		{
+			out += static_cast<char>(byte >= 'A' && byte <= 'Z' ? byte + 32 : byte);
+			position++;
+			continue;
+		}
+		auto c = decode(text, position);
+		if (c == invalid)
+		{
+			out += text[position - 1];
+			continue;
+		}
+		encode(foldCase(c), out);
+	}
+}
+}
+
+#endif // INDEXER_UNICODE_H_
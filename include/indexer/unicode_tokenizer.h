@@ -0,0 +1,52 @@
+#ifndef INDEXER_UNICODE_TOKENIZER_H_
+#define INDEXER_UNICODE_TOKENIZER_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "indexer/tokenizer.h"
+
+namespace Indexer
+{
+// Words are runs of letters, marks and digits in any script, decoded from UTF-8; malformed bytes
+// separate words. Tokens are case folded, and so are search needles, so "Straße", "STRASSE" and
+// "strasse" don't all match, but "ΣΟΦΟΣ" and "σοφος" do (simple folding only, no normalization).
+class UnicodeTokenizer final: public Tokenizer
+{
+public:
+	struct Options
+	{
+		bool foldCase{true};
+		std::size_t maxTokenBytes{255};  // longer tokens are dropped, they are rarely words
+	};
+
+	UnicodeTokenizer() = default;
+	explicit UnicodeTokenizer(Options options_): options{options_} {}
+
+	virtual void sendLine(std::string_view newLine) override;
+	virtual void sendEof() override {}
+
+	virtual std::unique_ptr<Tokenizer> clone() const override { return std::make_unique<UnicodeTokenizer>(options); }
+
+	[[nodiscard]] virtual std::string_view next() override;  // valid until the next call
+	virtual bool done() const override { return isDone; }
+
+	[[nodiscard]] virtual Normalization normalization() const override { return options.foldCase ? Normalization::FoldCase : Normalization::None; }
+
+private:
+	void findNext();
+
+	Options options;
+
+	std::string_view source;
+	std::size_t cursor{0};
+	std::string_view nextToken;
+	bool needsFolding{false};  // otherwise it's returned as a view into the line
+	std::string folded;
+	bool isDone{true};
+};
+}
+
+#endif // INDEXER_UNICODE_TOKENIZER_H_
@@ -0,0 +1,105 @@
+#ifndef INDEXER_WRITE_AHEAD_LOG_H_
+#define INDEXER_WRITE_AHEAD_LOG_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "indexer/append_file.h"
+#include "indexer/token_list.h"
+
+namespace Indexer
+{
+// Changes to the index since its last snapshot, see Indexer::persist(). The file holds a header
+// and then one record per change, each numbered by a sequence that keeps growing across truncations:
+//
+//   header: magic | sequence of the last record dropped by truncation
+//   record: body length (u32) | XXH64 of the body | sequence (u64) | type | fields, lengths as varints
+//
+// append() only encodes the record into a buffer. A flusher thread commits whatever piled up
+// in one write and one sync per commitInterval, so a crash loses at most the last interval;
+// a record it tore fails its checksum, replay stops there and the tail is cut off.
+class WriteAheadLog
+{
+public:
+	struct Change
+	{
+		enum class Type: std::uint8_t
+		{
+			Indexed = 1, Removed, Moved
+		};
+
+		Type type;
+		std::string path;
+
+		// Indexed: the file's metadata and all of its tokens, whether it was new or reindexed
+		std::uint64_t size{0};
+		std::int64_t lastWriteTime{0};  // file_time_type ticks
+		std::int64_t indexedAt{0};
+		std::uint64_t contentHash{0};
+		std::uint64_t tokenizer{0};
+		std::shared_ptr<TokenList> tokens{};
+
+		// Moved: `path` was renamed to `target`
+		std::string target{};
+		bool isDirectory{false};
+	};
+
+	struct Options
+	{
+		std::chrono::milliseconds commitInterval{10};
+		std::size_t maxBatchBytes{4 << 20};  // appends wait for the flusher beyond this much uncommitted
+	};
+
+	// opens the log at `file_`, created if missing; throws if it isn't a write-ahead log
+	explicit WriteAheadLog(std::filesystem::path file_): WriteAheadLog{std::move(file_), Options{}} {}
+	WriteAheadLog(std::filesystem::path file_, Options options_);
+
+	WriteAheadLog(WriteAheadLog const&) = delete;
+	WriteAheadLog& operator=(WriteAheadLog const&) = delete;
+	~WriteAheadLog();  // commits what's left
+
+	// the committed records after `afterSequence`, in order
+	void replay(std::uint64_t afterSequence, std::function<void(Change)> const&);
+
+	// returns the change's sequence; durable once the flusher committed it, or after sync()
+	std::uint64_t append(Change const&);
+	void sync();
+	[[nodiscard]] std::uint64_t lastSequence() const;
+
+	// drops the records up to `sequence`, once a snapshot holds them; sequences continue after it either way
+	void truncateThrough(std::uint64_t sequence);
+
+private:
+	void flush();
+	void disable(std::exception const&);
+
+	std::filesystem::path file;
+	Options options;
+
+	std::mutex fileMutex;  // the flusher writing, truncation replacing the file
+	std::optional<AppendFile> output;
+
+	mutable std::mutex mutex;
+	std::condition_variable wakeFlusher;
+	std::condition_variable committed;
+	std::string pending;  // encoded, not written yet
+	std::uint64_t appendedSequence{0};
+	std::uint64_t committedSequence{0};
+	bool isSyncRequested{false};
+	bool isStopping{false};
+	bool isDisabled{false};
+
+	std::thread flusher;
+};
+}
+
+#endif // INDEXER_WRITE_AHEAD_LOG_H_
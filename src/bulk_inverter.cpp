@@ -0,0 +1,156 @@
+#include "indexer/bulk_inverter.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <queue>
+
+#include "indexer/mapped_file.h"
+
+namespace
+{
+constexpr std::size_t minBufferPostings = 1024;
+}
+
+Indexer::BulkInverter::BulkInverter(std::size_t runBytes, unsigned bufferCount, std::filesystem::path runPrefix_)
+	: bufferCapacity{std::max(runBytes / std::max(bufferCount, 1u) / sizeof(Posting), minBufferPostings)}
+	, runPrefix{std::move(runPrefix_)}
+{
+}
+
+Indexer::BulkInverter::~BulkInverter()
+{
+	for (auto const& run: runs)
+	{
+		std::error_code errorCode;
+		std::filesystem::remove(run, errorCode);
+	}
+}
+
+Indexer::BulkInverter::TermId Indexer::BulkInverter::termId(std::string_view token)
+{
+	if (auto it = termIds.find(token); it != termIds.end())
+	{
+		return it->second;
+	}
+	auto it = termIds.emplace(std::string{token}, static_cast<TermId>(terms.size())).first;
+	terms.push_back(&it->first);  // node-based, stays put on rehashing
+	return it->second;
+}
+
+void Indexer::BulkInverter::add(FileId fileId, std::vector<TermId> const& fileTermIds)
+{
+	Buffer* buffer;
+	{
+		std::unique_lock pin{mutex};
+		if (freeBuffers.empty())
+		{
+			buffers.push_back(std::make_unique<Buffer>());
+			buffers.back()->reserve(bufferCapacity);
+			freeBuffers.push_back(buffers.back().get());
+		}
+		buffer = freeBuffers.back();
+		freeBuffers.pop_back();
+	}
+
+	// the buffer is ours alone until it goes back on the free list
+	for (auto term: fileTermIds)
+	{
+		buffer->push_back({term, fileId});
+	}
+	if (buffer->size() >= bufferCapacity)
+	{
+		writeRun(*buffer);
+	}
+
+	std::unique_lock pin{mutex};
+	freeBuffers.push_back(buffer);
+}
+
+void Indexer::BulkInverter::writeRun(Buffer& buffer)
+{
+	std::sort(buffer.begin(), buffer.end());
+
+	auto run = runPrefix;
+	{
+		std::unique_lock pin{mutex};
+		run += std::to_string(runs.size());
+		runs.push_back(run);
+	}
+
+	std::ofstream fout{run, std::ios::binary | std::ios::trunc};
+	fout.write(reinterpret_cast<char const*>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(Posting)));
+	if (not fout.flush())
+	{
+		std::cerr << "Could not write bulk index run " << run << ", keeping it in memory\n";
+		std::unique_lock pin{mutex};
+		std::erase(runs, run);
+		return;
+	}
+	buffer.clear();
+}
+
+void Indexer::BulkInverter::merge(std::function<void(std::string const& term, std::span<FileId const> fileIds)> const& emit)
+{
+	std::vector<MappedFile> mappings;
+	std::vector<std::span<Posting const>> sources;
+	for (auto const& run: runs)
+	{
+		auto contents = mappings.emplace_back(run).contents();
+		// mappings are page aligned and runs hold nothing but postings
+		sources.emplace_back(reinterpret_cast<Posting const*>(contents.data()), contents.size() / sizeof(Posting));
+	}
+	for (auto const& buffer: buffers)  // whatever didn't fill up a run
+	{
+		std::sort(buffer->begin(), buffer->end());
+		sources.emplace_back(buffer->data(), buffer->size());
+	}
+
+	using Head = std::pair<Posting, std::size_t>;  // and the source it came from
+	std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+	std::vector<std::size_t> positions(sources.size());
+	for (std::size_t source = 0; source < sources.size(); source++)
+	{
+		if (not sources[source].empty())
+		{
+			heads.push({sources[source].front(), source});
+		}
+	}
+
+	std::vector<FileId> fileIds;
+	TermId currentTerm = 0;
+	while (not heads.empty())
+	{
+		auto [posting, source] = heads.top();
+		heads.pop();
+		if (++positions[source] < sources[source].size())
+		{
+			heads.push({sources[source][positions[source]], source});
+		}
+
+		if (posting.term != currentTerm && not fileIds.empty())
+		{
+			emit(*terms[currentTerm], fileIds);
+			fileIds.clear();
+		}
+		currentTerm = posting.term;
+		if (fileIds.empty() || fileIds.back() != posting.file)  // the same file may have been added twice
+		{
+			fileIds.push_back(posting.file);
+		}
+	}
+	if (not fileIds.empty())
+	{
+		emit(*terms[currentTerm], fileIds);
+	}
+
+	mappings.clear();
+	for (auto const& run: runs)
+	{
+		std::error_code errorCode;
+		std::filesystem::remove(run, errorCode);
+	}
+	runs.clear();
+	buffers.clear();
+	freeBuffers.clear();
+}
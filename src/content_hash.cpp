@@ -0,0 +1,137 @@
+#include "indexer/content_hash.h"
+
+#include <bit>
+#include <cstring>
+
+namespace
+{
+constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t prime3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+std::uint64_t read64(char const* p)
+{
+	std::uint64_t value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+std::uint32_t read32(char const* p)
+{
+	std::uint32_t value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+std::uint64_t round(std::uint64_t accumulator, std::uint64_t input)
+{
+	accumulator += input * prime2;
+	accumulator = std::rotl(accumulator, 31);
+	return accumulator * prime1;
+}
+
+std::uint64_t mergeRound(std::uint64_t accumulator, std::uint64_t value)
+{
+	accumulator ^= round(0, value);
+	return accumulator * prime1 + prime4;
+}
+}
+
+Indexer::ContentHasher::ContentHasher(std::uint64_t seed_)
+	: seed{seed_}
+	, accumulators{seed_ + prime1 + prime2, seed_ + prime2, seed_, seed_ - prime1}
+{
+}
+
+void Indexer::ContentHasher::update(std::string_view data)
+{
+	totalLength += data.size();
+
+	if (bufferSize + data.size() < buffer.size())  // not enough for a full stripe yet
+	{
+		std::memcpy(buffer.data() + bufferSize, data.data(), data.size());
+		bufferSize += data.size();
+		return;
+	}
+
+	auto const* p = data.data();
+	auto const* end = p + data.size();
+
+	if (bufferSize > 0)  // complete the pending stripe first
+	{
+		auto fill = buffer.size() - bufferSize;
+		std::memcpy(buffer.data() + bufferSize, p, fill);
+		p += fill;
+		for (std::size_t i = 0; i < accumulators.size(); i++)
+		{
+			accumulators[i] = round(accumulators[i], read64(buffer.data() + 8 * i));
+		}
+		bufferSize = 0;
+	}
+
+	for (; end - p >= 32; p += 32)
+	{
+		for (std::size_t i = 0; i < accumulators.size(); i++)
+		{
+			accumulators[i] = round(accumulators[i], read64(p + 8 * i));
+		}
+	}
+
+	bufferSize = static_cast<std::size_t>(end - p);
+	std::memcpy(buffer.data(), p, bufferSize);
+}
+
+std::uint64_t Indexer::ContentHasher::digest() const
+{
+	std::uint64_t h;
+	if (totalLength >= 32)
+	{
+		auto const& [v1, v2, v3, v4] = accumulators;
+		h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+		for (auto v: accumulators)
+		{
+			h = mergeRound(h, v);
+		}
+	}
+	else
+	{
+		h = seed + prime5;
+	}
+	h += totalLength;
+
+	auto const* p = buffer.data();
+	auto const* end = p + bufferSize;
+	for (; end - p >= 8; p += 8)
+	{
+		h ^= round(0, read64(p));
+		h = std::rotl(h, 27) * prime1 + prime4;
+	}
+	if (end - p >= 4)
+	{
+		h ^= read32(p) * prime1;
+		h = std::rotl(h, 23) * prime2 + prime3;
+		p += 4;
+	}
+	for (; p < end; p++)
+	{
+		h ^= static_cast<unsigned char>(*p) * prime5;
+		h = std::rotl(h, 11) * prime1;
+	}
+
+	// avalanche
+	h ^= h >> 33;
+	h *= prime2;
+	h ^= h >> 29;
+	h *= prime3;
+	h ^= h >> 32;
+	return h;
+}
+
+std::uint64_t Indexer::ContentHasher::hash(std::string_view data, std::uint64_t seed)
+{
+	ContentHasher hasher{seed};
+	hasher.update(data);
+	return hasher.digest();
+}
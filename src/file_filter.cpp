@@ -0,0 +1,104 @@
+#include "indexer/file_filter.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+
+namespace
+{
+constexpr std::size_t sniffBlockSize = 4096;
+
+// length of the UTF-8 sequence introduced by a leading byte, 0 if it cannot start one
+std::size_t sequenceLength(unsigned char leadingByte)
+{
+	if (leadingByte < 0x80)
+	{
+		return 1;
+	}
+	else if (leadingByte >= 0xC2 && leadingByte <= 0xDF)
+	{
+		return 2;
+	}
+	else if (leadingByte >= 0xE0 && leadingByte <= 0xEF)
+	{
+		return 3;
+	}
+	else if (leadingByte >= 0xF0 && leadingByte <= 0xF4)
+	{
+		return 4;
+	}
+	return 0;
+}
+}
+
+bool Indexer::FileFilter::isExcluded(std::filesystem::path const& path) const
+{
+	auto const fullPath = path.generic_string();
+	auto const fileName = path.filename().string();
+	return std::any_of(excludes.begin(), excludes.end(), [&](auto const& glob) {
+		auto matchesFullPath = glob.pattern().find('/') != std::string::npos;
+		return glob.matches(matchesFullPath ? fullPath : fileName);
+	});
+}
+
+bool Indexer::FileFilter::isIndexable(std::filesystem::path const& path) const
+{
+	std::error_code errorCode;
+	auto size = std::filesystem::file_size(path, errorCode);
+	if (errorCode || size > maxFileSize)
+	{
+		return false;
+	}
+
+	if (not skipBinaryFiles)
+	{
+		return true;
+	}
+
+	std::array<char, sniffBlockSize> block;
+	std::ifstream f{path, std::ios::binary};
+	f.read(block.data(), block.size());
+	return acceptsContents({block.data(), static_cast<std::size_t>(f.gcount())}, size);
+}
+
+bool Indexer::FileFilter::acceptsContents(std::string_view contents, std::uintmax_t fileSize) const
+{
+	if (fileSize > maxFileSize)
+	{
+		return false;
+	}
+
+	auto firstBlock = contents.substr(0, sniffBlockSize);
+	return not skipBinaryFiles || not looksBinary(firstBlock, firstBlock.size() < fileSize);
+}
+
+bool Indexer::looksBinary(std::string_view firstBlock, bool isTruncated)
+{
+	for (std::size_t i = 0; i < firstBlock.size(); )
+	{
+		auto byte = static_cast<unsigned char>(firstBlock[i]);
+		if (byte == 0)
+		{
+			return true;
+		}
+
+		auto length = sequenceLength(byte);
+		if (length == 0)
+		{
+			return true;
+		}
+		if (i + length > firstBlock.size())
+		{
+			return not isTruncated;  // a sequence cut off by the end of the block is fine
+		}
+		for (std::size_t j = 1; j < length; j++)
+		{
+			if ((static_cast<unsigned char>(firstBlock[i + j]) & 0xC0) != 0x80)
+			{
+				return true;
+			}
+		}
+		i += length;
+	}
+	return false;
+}
@@ -0,0 +1,226 @@
+#include "indexer/glob.h"
+
+#include <optional>
+
+Indexer::Glob::Glob(std::string_view pattern)
+	: source{pattern}
+{
+	auto appendLiteral = [this](char c) {
+		if (tokens.empty() || tokens.back().type != TokenType::Literal)
+		{
+			tokens.push_back({TokenType::Literal, {}, {}});
+		}
+		tokens.back().literal.push_back(c);
+	};
+
+	for (std::size_t i = 0; i < pattern.size(); i++)
+	{
+		auto c = pattern[i];
+		switch (c)
+		{
+			case '*':
+				if (i + 1 < pattern.size() && pattern[i + 1] == '*')
+				{
+					while (i + 1 < pattern.size() && pattern[i + 1] == '*')
+					{
+						i++;
+					}
+					auto atComponentStart = i < 2 || pattern[i - 2] == '/';
+					if (atComponentStart && i + 1 < pattern.size() && pattern[i + 1] == '/')
+					{
+						i++;
+						tokens.push_back({TokenType::AnyDirectories, {}, {}});
+					}
+					else
+					{
+						tokens.push_back({TokenType::AnyPath, {}, {}});
+					}
+				}
+				else
+				{
+					tokens.push_back({TokenType::AnyRun, {}, {}});
+				}
+				break;
+
+			case '?':
+				tokens.push_back({TokenType::AnyCharacter, {}, {}});
+				break;
+
+			case '[':
+				{
+					auto j = i + 1;
+					auto negated = j < pattern.size() && (pattern[j] == '!' || pattern[j] == '^');
+					if (negated)
+					{
+						j++;
+					}
+
+					std::bitset<256> characterClass;
+					auto first = j;
+					for (; j < pattern.size() && (pattern[j] != ']' || j == first); j++)
+					{
+						auto from = static_cast<unsigned char>(pattern[j]);
+						auto to = from;
+						if (j + 2 < pattern.size() && pattern[j + 1] == '-' && pattern[j + 2] != ']')
+						{
+							to = static_cast<unsigned char>(pattern[j + 2]);
+							j += 2;
+						}
+						for (unsigned k = from; k <= to; k++)
+						{
+							characterClass.set(k);
+						}
+					}
+
+					if (j == pattern.size())  // unterminated, match the bracket literally
+					{
+						appendLiteral(c);
+						break;
+					}
+
+					if (negated)
+					{
+						characterClass.flip();
+					}
+					tokens.push_back({TokenType::CharacterClass, {}, characterClass});
+					i = j;
+				}
+				break;
+
+			case '\\':
+				if (i + 1 < pattern.size())
+				{
+					i++;
+				}
+				appendLiteral(pattern[i]);
+				break;
+
+			default:
+				appendLiteral(c);
+				break;
+		}
+	}
+}
+
+// Iterative, remembering only the last wildcard to retry from, so that matching stays close to linear
+// in the text even for patterns like `*a*a*a*b`. `*` can't cross `/`, so when it runs into one, only
+// the last wildcard that can (`**` or `**/`) is worth retrying: moving an earlier `*` along would only
+// give the later ones fewer positions within the same component.
+bool Indexer::Glob::matches(std::string_view text) const
+{
+	struct Retry
+	{
+		std::size_t tokenIndex;
+		std::size_t textIndex;  // where the wildcard's run ends this time
+	};
+	std::optional<Retry> lastWildcard;
+	std::optional<Retry> lastCrossingWildcard;
+
+	// moves a wildcard's end to its next possible position
+	auto extend = [&](Retry& retry)
+	{
+		switch (tokens[retry.tokenIndex].type)
+		{
+			case TokenType::AnyRun:
+				if (retry.textIndex == text.size() || text[retry.textIndex] == '/')
+				{
+					return false;
+				}
+				retry.textIndex++;
+				return true;
+
+			case TokenType::AnyPath:
+				if (retry.textIndex == text.size())
+				{
+					return false;
+				}
+				retry.textIndex++;
+				return true;
+
+			default:  // AnyDirectories, at the start of a component
+			{
+				auto slash = text.find('/', retry.textIndex);
+				if (slash == std::string_view::npos)
+				{
+					return false;
+				}
+				retry.textIndex = slash + 1;
+				return true;
+			}
+		}
+	};
+
+	std::size_t tokenIndex = 0;
+	std::size_t textIndex = 0;
+	while (true)
+	{
+		auto isMatching = false;
+		if (tokenIndex < tokens.size())
+		{
+			auto const& token = tokens[tokenIndex];
+			auto rest = text.substr(textIndex);
+			switch (token.type)
+			{
+				case TokenType::Literal:
+					isMatching = rest.starts_with(token.literal);
+					textIndex += isMatching ? token.literal.size() : 0;
+					break;
+
+				case TokenType::AnyCharacter:
+				case TokenType::CharacterClass:
+					isMatching = not rest.empty() && rest.front() != '/'
+						&& (token.type == TokenType::AnyCharacter || token.characterClass.test(static_cast<unsigned char>(rest.front())));
+					textIndex += isMatching ? 1 : 0;
+					break;
+
+				case TokenType::AnyRun:
+				case TokenType::AnyPath:
+				case TokenType::AnyDirectories:
+				{
+					Retry retry{tokenIndex, textIndex};
+					if (token.type == TokenType::AnyDirectories && textIndex > 0 && text[textIndex - 1] != '/' && not extend(retry))
+					{
+						break;  // no component starts after here
+					}
+					lastWildcard = retry;
+					if (token.type != TokenType::AnyRun)
+					{
+						lastCrossingWildcard = retry;
+					}
+					textIndex = retry.textIndex;
+					isMatching = true;
+					break;
+				}
+			}
+		}
+		else if (textIndex == text.size())
+		{
+			return true;
+		}
+
+		if (isMatching)
+		{
+			tokenIndex++;
+			continue;
+		}
+
+		// retry from the last wildcard, with it matching one more character
+		if (lastWildcard && extend(*lastWildcard))
+		{
+			if (tokens[lastWildcard->tokenIndex].type != TokenType::AnyRun)
+			{
+				lastCrossingWildcard = lastWildcard;
+			}
+		}
+		else if (lastCrossingWildcard && extend(*lastCrossingWildcard))
+		{
+			lastWildcard = lastCrossingWildcard;
+		}
+		else
+		{
+			return false;
+		}
+		tokenIndex = lastWildcard->tokenIndex + 1;
+		textIndex = lastWildcard->textIndex;
+	}
+}
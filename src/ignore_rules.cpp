@@ -0,0 +1,132 @@
+#include "indexer/ignore_rules.h"
+
+#include <array>
+#include <fstream>
+
+namespace
+{
+constexpr std::array<std::string_view, 2> ignoreFileNames = {".gitignore", ".ignore"};
+}
+
+std::shared_ptr<Indexer::IgnoreRules const> Indexer::IgnoreRules::load(
+	std::filesystem::path const& directory, std::shared_ptr<IgnoreRules const> parent)
+{
+	auto rules = std::make_shared<IgnoreRules>();
+	for (auto const& name: ignoreFileNames)
+	{
+		rules->parse(directory / name);
+	}
+
+	if (rules->rules.empty())
+	{
+		return parent;
+	}
+
+	rules->directoryPrefix = directory.generic_string();
+	if (not rules->directoryPrefix.ends_with('/'))
+	{
+		rules->directoryPrefix.push_back('/');
+	}
+	rules->parent = std::move(parent);
+	return rules;
+}
+
+bool Indexer::IgnoreRules::isIgnored(std::filesystem::path const& path, bool isDirectory) const
+{
+	auto fullPath = path.generic_string();
+	auto name = std::string_view{fullPath}.substr(fullPath.find_last_of('/') + 1);
+
+	for (auto const* level = this; level != nullptr; level = level->parent.get())
+	{
+		switch (level->judge(fullPath, name, isDirectory))
+		{
+			case Verdict::Ignored:
+				return true;
+			case Verdict::Included:
+				return false;
+			case Verdict::Unknown:
+				break;  // defer to the parent directory
+		}
+	}
+	return false;
+}
+
+bool Indexer::IgnoreRules::isIgnoreFile(std::filesystem::path const& path)
+{
+	auto name = path.filename();
+	for (auto const& ignoreFileName: ignoreFileNames)
+	{
+		if (name == ignoreFileName)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+Indexer::IgnoreRules::Verdict Indexer::IgnoreRules::judge(std::string_view fullPath, std::string_view name, bool isDirectory) const
+{
+	if (not fullPath.starts_with(directoryPrefix))
+	{
+		return Verdict::Unknown;
+	}
+	auto relativePath = fullPath.substr(directoryPrefix.size());
+
+	// the last matching rule wins
+	for (auto it = rules.rbegin(); it != rules.rend(); ++it)
+	{
+		if (it->isDirectoryOnly && not isDirectory)
+		{
+			continue;
+		}
+		if (it->glob.matches(it->isAnchored ? relativePath : name))
+		{
+			return it->isNegated ? Verdict::Included : Verdict::Ignored;
+		}
+	}
+	return Verdict::Unknown;
+}
+
+void Indexer::IgnoreRules::parse(std::filesystem::path const& ignoreFile)
+{
+	std::ifstream f{ignoreFile};
+	std::string line;
+	while (std::getline(f, line))
+	{
+		while (not line.empty() && (line.back() == ' ' || line.back() == '\t' || line.back() == '\r')
+			&& not line.ends_with("\\ "))
+		{
+			line.pop_back();
+		}
+		if (line.empty() || line.front() == '#')
+		{
+			continue;
+		}
+
+		auto pattern = std::string_view{line};
+		auto isNegated = pattern.front() == '!';
+		if (isNegated)
+		{
+			pattern.remove_prefix(1);
+		}
+
+		auto isDirectoryOnly = pattern.ends_with('/');
+		if (isDirectoryOnly)
+		{
+			pattern.remove_suffix(1);
+		}
+
+		// a slash anywhere but at the end ties the pattern to this directory
+		auto isAnchored = pattern.find('/') != std::string_view::npos;
+		if (pattern.starts_with('/'))
+		{
+			pattern.remove_prefix(1);
+		}
+
+		if (pattern.empty())
+		{
+			continue;
+		}
+		rules.push_back({Glob{pattern}, isNegated, isDirectoryOnly, isAnchored});
+	}
+}
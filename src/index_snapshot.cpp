@@ -0,0 +1,305 @@
+#include "indexer/index_snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "indexer/append_file.h"
+
+namespace
+{
+using namespace Indexer::Snapshot;
+
+static_assert(std::is_trivially_copyable_v<Header> && sizeof(Header) % 8 == 0);
+static_assert(std::is_trivially_copyable_v<Term> && sizeof(Term) % 8 == 0);
+static_assert(std::is_trivially_copyable_v<File> && sizeof(File) % 8 == 0);
+
+constexpr std::uint64_t alignedTo8(std::uint64_t size)
+{
+	return (size + 7) & ~std::uint64_t{7};
+}
+
+struct Layout
+{
+	std::uint64_t terms;
+	std::uint64_t postings;
+	std::uint64_t files;
+	std::uint64_t strings;
+	std::uint64_t size;
+};
+
+// where each section starts, the counts were checked against the file size already
+Layout layoutOf(Header const& header)
+{
+	Layout layout{};
+	layout.terms = sizeof(Header);
+	layout.postings = layout.terms + header.termCount * sizeof(Term);
+	layout.files = layout.postings + alignedTo8(header.postingCount * sizeof(Posting));
+	layout.strings = layout.files + header.fileCount * sizeof(File);
+	layout.size = layout.strings + header.stringBytes;
+	return layout;
+}
+
+template <class T>
+void writeAll(Indexer::AppendFile& out, std::vector<T> const& records)
+{
+	out.append({reinterpret_cast<char const*>(records.data()), records.size() * sizeof(T)});
+}
+}
+
+Indexer::Snapshot::Posting Indexer::SnapshotWriter::addFile(std::string_view path, Snapshot::File metadata)
+{
+	metadata.path = strings.size();
+	metadata.pathLength = path.size();
+	files.push_back(metadata);
+	strings.append(path);
+	return static_cast<Snapshot::Posting>(files.size() - 1);
+}
+
+void Indexer::SnapshotWriter::addTerm(std::string_view term, std::vector<Snapshot::Posting> postings)
+{
+	std::sort(postings.begin(), postings.end());
+	terms.push_back({strings.size(), static_cast<std::uint32_t>(term.size()), std::move(postings)});
+	strings.append(term);
+}
+
+void Indexer::SnapshotWriter::write(std::filesystem::path const& file, std::uint64_t logSequence)
+{
+	auto name = [this](PendingTerm const& term) { return std::string_view{strings}.substr(term.name, term.nameLength); };
+	std::sort(terms.begin(), terms.end(), [&](auto const& a, auto const& b) { return name(a) < name(b); });
+
+	Snapshot::Header header{};
+	std::copy(std::begin(Snapshot::magic), std::end(Snapshot::magic), header.magic);
+	header.generation = IndexSnapshot::generationOf(file).value_or(0) + 1;
+	header.termCount = terms.size();
+	header.fileCount = files.size();
+	header.logSequence = logSequence;
+	header.normalizations = strings.size();  // written after them
+	header.tokenizerCount = normalizations.size();
+	header.stringBytes = strings.size() + normalizations.size();
+
+	std::vector<Snapshot::Term> termRecords;
+	std::vector<Snapshot::Posting> postings;
+	termRecords.reserve(terms.size());
+	for (auto const& term: terms)
+	{
+		termRecords.push_back({term.name, postings.size(), term.nameLength, static_cast<std::uint32_t>(term.postings.size())});
+		postings.insert(postings.end(), term.postings.begin(), term.postings.end());
+	}
+	header.postingCount = postings.size();
+	postings.resize(alignedTo8(postings.size() * sizeof(Snapshot::Posting)) / sizeof(Snapshot::Posting));  // the files are 8-aligned
+
+	auto temporary = file;
+	temporary += ".tmp";
+	{
+		AppendFile out{temporary};
+		out.truncate(0);
+		out.append({reinterpret_cast<char const*>(&header), sizeof(header)});
+		writeAll(out, termRecords);
+		writeAll(out, postings);
+		writeAll(out, files);
+		out.append(strings);
+		out.append(normalizations);
+		out.sync();  // before the rename, or a crash could leave the new name on an empty file
+	}
+	std::filesystem::rename(temporary, file);
+	AppendFile::syncDirectoryOf(file);
+}
+
+Indexer::IndexSnapshot::IndexSnapshot(std::filesystem::path file_)
+	: snapshotFile{std::move(file_)}
+	, mapping{snapshotFile}
+{
+	validate(mapping.contents());
+}
+
+std::vector<std::string_view> Indexer::IndexSnapshot::search(std::string_view needle) const
+{
+	std::vector<Normalization> used;
+	for (auto byte: strings().substr(header().normalizations, header().tokenizerCount))
+	{
+		Normalization normalization{static_cast<std::uint8_t>(byte)};
+		if (std::find(used.begin(), used.end(), normalization) == used.end())
+		{
+			used.push_back(normalization);
+		}
+	}
+	if (used.empty())
+	{
+		used.push_back(Normalization::None);
+	}
+
+	auto allFiles = files();
+	std::vector<Snapshot::Posting> found;
+	for (auto normalization: used)
+	{
+		auto term = find(normalized(needle, normalization));
+		if (not term)
+		{
+			continue;
+		}
+		for (auto posting: postingsOf(*term))
+		{
+			// otherwise a corrupt file, not worth failing the search over
+			if (posting < allFiles.size() && (used.size() == 1 || normalizationOf(posting) == normalization))
+			{
+				found.push_back(posting);
+			}
+		}
+	}
+	std::sort(found.begin(), found.end());  // each file has one tokenizer, so no duplicates
+
+	std::vector<std::string_view> paths;
+	paths.reserve(found.size());
+	for (auto posting: found)
+	{
+		paths.push_back(path(posting));
+	}
+	return paths;
+}
+
+bool Indexer::IndexSnapshot::refresh()
+{
+	MappedFile latest{snapshotFile};
+	validate(latest.contents());
+	if (reinterpret_cast<Snapshot::Header const*>(latest.contents().data())->generation == generation())
+	{
+		return false;
+	}
+	mapping = std::move(latest);
+	return true;
+}
+
+std::optional<std::uint64_t> Indexer::IndexSnapshot::generationOf(std::filesystem::path const& file)
+{
+	try
+	{
+		MappedFile mapped{file};
+		validate(mapped.contents());
+		return reinterpret_cast<Snapshot::Header const*>(mapped.contents().data())->generation;
+	}
+	catch (std::exception const&)
+	{
+		return std::nullopt;
+	}
+}
+
+void Indexer::IndexSnapshot::validate(std::string_view contents)
+{
+	auto fail = [](char const* reason) { throw std::runtime_error{std::string{"Not a valid index snapshot: "} + reason}; };
+
+	if (contents.size() < sizeof(Snapshot::Header))
+	{
+		fail("too short");
+	}
+	// mappings are page aligned
+	auto const& header = *reinterpret_cast<Snapshot::Header const*>(contents.data());
+	if (std::memcmp(header.magic, Snapshot::magic, sizeof(header.magic)) != 0)
+	{
+		fail("wrong magic");
+	}
+	auto size = contents.size();
+	if (header.termCount > size / sizeof(Snapshot::Term) || header.postingCount > size / sizeof(Snapshot::Posting)
+		|| header.fileCount > size / sizeof(Snapshot::File) || header.stringBytes > size)
+	{
+		fail("counts exceed the file size");
+	}
+	auto layout = layoutOf(header);
+	if (layout.size != size)
+	{
+		fail("size doesn't match the header");
+	}
+
+	auto const* terms = reinterpret_cast<Snapshot::Term const*>(contents.data() + layout.terms);
+	for (std::uint64_t i = 0; i < header.termCount; i++)
+	{
+		if (terms[i].name > header.stringBytes || terms[i].nameLength > header.stringBytes - terms[i].name
+			|| terms[i].firstPosting > header.postingCount || terms[i].postingCount > header.postingCount - terms[i].firstPosting)
+		{
+			fail("term out of bounds");
+		}
+	}
+	if (header.normalizations > header.stringBytes || header.tokenizerCount > header.stringBytes - header.normalizations)
+	{
+		fail("tokenizers out of bounds");
+	}
+	auto const* files = reinterpret_cast<Snapshot::File const*>(contents.data() + layout.files);
+	for (std::uint64_t i = 0; i < header.fileCount; i++)
+	{
+		if (files[i].path > header.stringBytes || files[i].pathLength > header.stringBytes - files[i].path)
+		{
+			fail("file out of bounds");
+		}
+	}
+}
+
+std::string_view Indexer::IndexSnapshot::term(std::size_t index) const
+{
+	auto const& record = terms()[index];
+	return strings().substr(record.name, record.nameLength);
+}
+
+std::span<Indexer::Snapshot::Posting const> Indexer::IndexSnapshot::postingsOf(std::size_t term) const
+{
+	auto const& record = terms()[term];
+	return postings().subspan(record.firstPosting, record.postingCount);
+}
+
+std::string_view Indexer::IndexSnapshot::path(Snapshot::Posting posting) const
+{
+	auto const& record = files()[posting];
+	return strings().substr(record.path, record.pathLength);
+}
+
+// files of tokenizers the index didn't know, if corrupt, have their needles taken as they are
+Indexer::Normalization Indexer::IndexSnapshot::normalizationOf(Snapshot::Posting posting) const
+{
+	auto tokenizer = files()[posting].tokenizer;
+	if (tokenizer >= header().tokenizerCount)
+	{
+		return Normalization::None;
+	}
+	return Normalization{static_cast<std::uint8_t>(strings()[header().normalizations + tokenizer])};
+}
+
+std::optional<std::size_t> Indexer::IndexSnapshot::find(std::string_view term) const
+{
+	auto allTerms = terms();
+	auto allStrings = strings();
+	auto name = [&](Snapshot::Term const& t) { return allStrings.substr(t.name, t.nameLength); };
+	auto it = std::lower_bound(allTerms.begin(), allTerms.end(), term, [&](auto const& t, auto n) { return name(t) < n; });
+	if (it == allTerms.end() || name(*it) != term)
+	{
+		return std::nullopt;
+	}
+	return static_cast<std::size_t>(it - allTerms.begin());
+}
+
+Indexer::Snapshot::Header const& Indexer::IndexSnapshot::header() const
+{
+	return *reinterpret_cast<Snapshot::Header const*>(mapping.contents().data());
+}
+
+std::span<Indexer::Snapshot::Term const> Indexer::IndexSnapshot::terms() const
+{
+	auto layout = layoutOf(header());
+	return {reinterpret_cast<Snapshot::Term const*>(mapping.contents().data() + layout.terms), header().termCount};
+}
+
+std::span<Indexer::Snapshot::Posting const> Indexer::IndexSnapshot::postings() const
+{
+	auto layout = layoutOf(header());
+	return {reinterpret_cast<Snapshot::Posting const*>(mapping.contents().data() + layout.postings), header().postingCount};
+}
+
+std::span<Indexer::Snapshot::File const> Indexer::IndexSnapshot::files() const
+{
+	auto layout = layoutOf(header());
+	return {reinterpret_cast<Snapshot::File const*>(mapping.contents().data() + layout.files), header().fileCount};
+}
+
+std::string_view Indexer::IndexSnapshot::strings() const
+{
+	return mapping.contents().substr(layoutOf(header()).strings);
+}
@@ -1,7 +1,16 @@
 #include "indexer/indexer.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include "indexer/content_hash.h"
+#include "indexer/index_snapshot.h"
+#include "indexer/levenshtein_automaton.h"
 
 void Indexer::Indexer::addPath(std::filesystem::path const& path, Recursive recursively)
 {
@@ -10,13 +19,18 @@ void Indexer::Indexer::addPath(std::filesystem::path const& path, Recursive recu
 	{
 		canonicalPath = std::filesystem::weakly_canonical(".") / path;
 	}
-	addedPaths.insert(canonicalPath);
+	{
+		auto pin = lockIndex();
+		addedPaths.insert(canonicalPath);
+	}
+	runtime->addRoot(*this, canonicalPath);
 
 	if (not std::filesystem::exists(canonicalPath))
 	{
 		awaitCreation(canonicalPath);
 		if (recursively == Recursive::Yes)  // assume directory
 		{
+			auto pin = lockIndex();
 			indexedDirectories.insert({canonicalPath, recursively});
 		}
 	}
@@ -36,295 +50,2008 @@ void Indexer::Indexer::addPath(std::filesystem::path const& path, Recursive recu
 		return;  // no jobs created
 	}
 	workerSync.wait(pin, [this](){ return threadWorkers[std::this_thread::get_id()] == 0; });  // wait for jobs to finish
+	pin.unlock();
+
+	auto indexPin = lockIndex();
+	compactFileIdsIfSparseUnsafe();  // also bounds the new files' directories for scoped searches
 }
 
-[[nodiscard]] Indexer::PathSet Indexer::Indexer::search(std::string const& needle) const
+void Indexer::Indexer::addPath(std::filesystem::path const& path, Recursive recursively, BulkLoad bulkLoad)
 {
-	std::unique_lock pin{indexMutex};
-	if (not invertedIndex.contains(needle))
-		return PathSet{};
-
-	PathSet haystacks;
-	for (auto&& i: invertedIndex.at(needle))
 	{
-		assert(idToFile.contains(i));
-		haystacks.insert(idToFile.at(i));
+		auto pin = lockIndex();
+		if (bulkBuild)  // someone else's, ours go through it only from their thread
+		{
+			pin.unlock();
+			addPath(path, recursively);
+			return;
+		}
+		bulkBuild = std::make_unique<BulkBuild>(std::this_thread::get_id(), bulkLoad.runBytes, runtime->workerCount(), spillFileUnsafe("run-"));
 	}
-	return haystacks;
+	addPath(path, recursively);
+	finishBulkBuild();
 }
 
-void Indexer::Indexer::addDirectory(std::filesystem::path const& path, Recursive recursively)
+Indexer::IndexingTask Indexer::Indexer::addPathAsync(std::filesystem::path const& path, Recursive recursively, std::stop_token stopToken,
+	Priority priority)
 {
-	assert(std::filesystem::is_directory(path));
-
-	// only locking for these two operations
+	auto state = std::make_shared<IndexingTask::State>();
+	if (stopToken.stop_possible())
 	{
-		std::unique_lock pin{indexMutex};
-		watcher.addDirectory(path);
-		indexedDirectories.insert({path, recursively});
+		state->callerStop.emplace(std::move(stopToken), [stopSource = state->stopSource]() mutable { stopSource.request_stop(); });
 	}
 
-	for (auto&& p: std::filesystem::directory_iterator(path))
+	std::unique_lock<std::mutex> pin{workerMutex};
+	std::erase_if(taskThreads, [](auto& task)
 	{
-		auto entry = p.path();
-		if (not std::filesystem::is_directory(entry))
+		std::unique_lock taskPin{task.second->mutex};
+		if (task.second->isDone)  // the thread only has to return
 		{
-			addFile(entry);
+			task.first.join();
 		}
-		else if (recursively == Recursive::Yes)
+		return not task.first.joinable();
+	});
+	taskThreads.emplace_back(std::thread{[this, state, path, recursively, priority]()
+	{
+		auto threadId = std::this_thread::get_id();
 		{
-			addDirectory(entry, recursively);
+			std::unique_lock<std::mutex> workerPin{workerMutex};
+			threadTasks[threadId] = state;
+			threadPriorities[threadId] = priority;
+		}
+		addPath(path, recursively);
+		{
+			std::unique_lock<std::mutex> workerPin{workerMutex};
+			threadTasks.erase(threadId);
+			threadPriorities.erase(threadId);
+			threadWorkers.erase(threadId);
 		}
+		std::unique_lock taskPin{state->mutex};
+		state->isDone = true;
+		state->doneSync.notify_all();
+	}}, state);
+	return IndexingTask{state};
+}
+
+std::shared_ptr<Indexer::IndexingTask::State> Indexer::Indexer::currentTask() const
+{
+	std::unique_lock<std::mutex> pin{workerMutex};
+	auto task = threadTasks.find(std::this_thread::get_id());
+	return task != threadTasks.end() ? task->second : nullptr;
+}
+
+void Indexer::Indexer::stopTasks()
+{
+	std::unique_lock<std::mutex> pin{workerMutex};
+	auto tasks = std::move(taskThreads);
+	pin.unlock();  // they need it to finish
+	for (auto& [thread, state]: tasks)
+	{
+		state->stopSource.request_stop();
+		thread.join();
 	}
 }
 
-std::unordered_set<std::string> getFileTokens(std::filesystem::path const& path, std::unique_ptr<Indexer::Tokenizer> tokenizer)
+[[nodiscard]] Indexer::PathSet Indexer::Indexer::search(std::string const& needle) const
 {
-	std::unordered_set<std::string> fileTokens;
-	std::ifstream f{path};
-	std::string buf;
-	while (not f.eof())
+	TraceSpan span{metrics, "search", Metrics::Timer::Search};
+	metrics.add(Metrics::Counter::Searches);
+	auto needles = tokenizers.normalize(needle);
+	auto pin = lockIndex();
+	std::vector<FileId> haystacks;
+	for (auto const& normalized: needles)
 	{
-		std::getline(f, buf);
-		tokenizer->sendLine(buf);
+		auto first = haystacks.size();
+		findFilesUnsafe(normalized.term, haystacks);
+		keepFilesOfUnsafe(normalized, haystacks, first);
+	}
+	return pathsOfUnsafe(haystacks, needles.size() > 1);
+}
 
-		if (f.eof())
-		{
-			tokenizer->sendEof();
-		}
+Indexer::PathSet Indexer::Indexer::search(std::string const& needle, std::filesystem::path const& directory) const
+{
+	TraceSpan span{metrics, "scoped search", Metrics::Timer::Search};
+	metrics.add(Metrics::Counter::Searches);
+	auto needles = tokenizers.normalize(needle);
+	auto canonicalDirectory = std::filesystem::weakly_canonical(std::filesystem::absolute(directory));
+	if (not canonicalDirectory.has_filename())  // a trailing separator
+	{
+		canonicalDirectory = canonicalDirectory.parent_path();
+	}
+	auto pin = lockIndex();
+	auto scope = filePaths.scope(canonicalDirectory);
+	if (not scope)
+	{
+		return {};
+	}
+	std::vector<FileId> haystacks;
+	for (auto const& normalized: needles)
+	{
+		auto first = haystacks.size();
+		findFilesUnsafe(normalized.term, *scope, haystacks);
+		keepFilesOfUnsafe(normalized, haystacks, first);
+	}
+	return pathsOfUnsafe(haystacks, needles.size() > 1);
+}
 
-		while (not tokenizer->done())
+Indexer::PathSet Indexer::Indexer::searchFuzzy(std::string const& needle, unsigned maxDistance) const
+{
+	TraceSpan span{metrics, "fuzzy search", Metrics::Timer::Search};
+	metrics.add(Metrics::Counter::Searches);
+	auto needles = tokenizers.normalize(needle);
+	auto pin = lockIndex();
+	std::vector<FileId> haystacks;
+	std::size_t termCount = 0;
+	for (auto const& normalized: needles)
+	{
+		std::vector<std::string> terms;
+		similarTermsUnsafe(normalized.term, maxDistance, terms);
+		auto first = haystacks.size();
+		for (auto const& term: terms)
 		{
-			auto token = std::string{tokenizer->next()};
-			fileTokens.insert(token);
+			findFilesUnsafe(term, haystacks);
 		}
+		keepFilesOfUnsafe(normalized, haystacks, first);
+		termCount += terms.size();
 	}
+	return pathsOfUnsafe(haystacks, termCount > 1);
+}
 
-	return fileTokens;
+std::vector<std::string> Indexer::Indexer::similarTerms(std::string const& needle, unsigned maxDistance) const
+{
+	auto needles = tokenizers.normalize(needle);
+	auto pin = lockIndex();
+	std::vector<std::string> terms;
+	for (auto const& normalized: needles)
+	{
+		similarTermsUnsafe(normalized.term, maxDistance, terms);
+	}
+	std::sort(terms.begin(), terms.end());
+	terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+	return terms;
 }
 
-void Indexer::Indexer::addFile(std::filesystem::path const& path)
+void Indexer::Indexer::findFilesUnsafe(std::string_view term, std::vector<FileId>& files) const
 {
-	if (not std::filesystem::exists(path))  // deleted while we weren't looking
+	if (auto it = invertedIndex.find(term); it != invertedIndex.end())
 	{
-		return;
+		it->second.lastUsed = ++useCounter;
+		files.insert(files.end(), it->second.files.begin(), it->second.files.end());
+	}
+	else if (auto spilled = spilledPostings.find(term); spilled != spilledPostings.end())
+	{
+		auto postings = postingSegments[spilled->second.segment]->postings(spilled->second.extent);
+		files.insert(files.end(), postings.begin(), postings.end());
 	}
+}
 
-	assert(std::filesystem::is_regular_file(path) || std::filesystem::is_symlink(path));
+// Only looks at the ids in the scope's range and at the files placed since, probing the posting list
+// for each of them when that is cheaper than scanning it; spilled lists are sorted, so the range
+// is found by binary search.
+void Indexer::Indexer::findFilesUnsafe(std::string_view term, PathTable::Scope const& scope, std::vector<FileId>& files) const
+{
+	auto isInRange = [&scope](FileId fileId) { return fileId >= scope.begin && fileId < scope.end; };
+	if (auto it = invertedIndex.find(term); it != invertedIndex.end())
+	{
+		it->second.lastUsed = ++useCounter;
+		auto const& list = it->second.files;
+		if (scope.end - scope.begin < list.size())
+		{
+			for (auto i = scope.begin; i < scope.end; i++)
+			{
+				if (list.contains(i) && filePaths.isUnder(i, scope))
+				{
+					files.push_back(i);
+				}
+			}
+		}
+		else
+		{
+			for (auto i: list)
+			{
+				if (isInRange(i) && filePaths.isUnder(i, scope))
+				{
+					files.push_back(i);
+				}
+			}
+		}
+		for (auto i: *scope.others)
+		{
+			if (not isInRange(i) && list.contains(i) && filePaths.isUnder(i, scope))
+			{
+				files.push_back(i);
+			}
+		}
+	}
+	else if (auto spilled = spilledPostings.find(term); spilled != spilledPostings.end())
+	{
+		auto postings = postingSegments[spilled->second.segment]->postings(spilled->second.extent);
+		for (auto i = std::lower_bound(postings.begin(), postings.end(), scope.begin); i != postings.end() && *i < scope.end; ++i)
+		{
+			if (filePaths.isUnder(*i, scope))
+			{
+				files.push_back(*i);
+			}
+		}
+		for (auto i: *scope.others)
+		{
+			if (not isInRange(i) && std::binary_search(postings.begin(), postings.end(), i) && filePaths.isUnder(i, scope))
+			{
+				files.push_back(i);
+			}
+		}
+	}
+}
 
-	watcher.addFile(path);
+// A needle normalized differently for other tokenizers only matches the files of those it was
+// normalized for: a case folded needle mustn't find lower case words where case is kept.
+void Indexer::Indexer::keepFilesOfUnsafe(TokenizerRegistry::Needle const& needle, std::vector<FileId>& files, std::size_t first) const
+{
+	if (needle.tokenizers.size() == tokenizers.size())
+	{
+		return;  // the same for all of them
+	}
+	auto isOther = [&](FileId fileId)
+	{
+		return isIndexed(fileId)
+			&& std::find(needle.tokenizers.begin(), needle.tokenizers.end(), fileInfo[fileId]->tokenizer) == needle.tokenizers.end();
+	};
+	files.erase(std::remove_if(files.begin() + static_cast<std::ptrdiff_t>(first), files.end(), isOther), files.end());
+}
 
-	auto threadId = std::this_thread::get_id();
-	std::unique_lock<std::mutex> pin{workerMutex};
-	if (not threadWorkers.contains(threadId))
+// several terms' files are merged as ids, so that each path is copied once
+Indexer::PathSet Indexer::Indexer::pathsOfUnsafe(std::vector<FileId>& files, bool mayRepeat) const
+{
+	if (mayRepeat)
+	{
+		std::sort(files.begin(), files.end());
+		files.erase(std::unique(files.begin(), files.end()), files.end());
+	}
+	PathSet paths;
+	paths.reserve(files.size());
+	for (auto i: files)
 	{
-		threadWorkers.insert({threadId, 0});
+		assert(filePaths.contains(i));
+		paths.insert(filePaths.path(i));
 	}
-	workerSync.wait(pin, [this](){ return numWorkers < maxWorkers; });  // all our operators are busy, please hold
-	threadWorkers[threadId]++;
-	numWorkers++;
-	std::thread addFileThread{&Indexer::addFileAsync, this, path, threadId};
-	addFileThread.detach();
+	return paths;
 }
 
-void Indexer::Indexer::addFileAsync(std::filesystem::path const& path, std::thread::id parent)
+// Walks the dictionary in order, stepping the automaton through each term from where it and the
+// previous term part ways. Once a prefix can't lead to a match, seeks past every term sharing it.
+void Indexer::Indexer::similarTermsUnsafe(std::string_view needle, unsigned maxDistance, std::vector<std::string>& terms) const
 {
-	std::unique_lock<std::mutex> indexLock{indexMutex};
-	auto fileId = getFileId(path);
+	LevenshteinAutomaton automaton{needle, maxDistance};
+	std::vector<LevenshteinAutomaton::State> states{automaton.start()};  // after each byte of `previous`
+	std::string_view previous;
+	auto it = termDictionary.begin();
+	while (it != termDictionary.end())
+	{
+		std::string_view term = *it;
+		auto shared = static_cast<std::size_t>(std::mismatch(previous.begin(), previous.end(), term.begin(), term.end()).first - previous.begin());
+		states.resize(std::min(states.size(), shared + 1));
+		previous = term;
 
-	indexLock.unlock();
-	auto fileTokens = getFileTokens(path, tokenizer->clone());
-	indexLock.lock();
+		while (states.size() <= term.size() && automaton.canMatch(states.back()))
+		{
+			states.push_back(automaton.step(states.back(), term[states.size() - 1]));
+		}
+		if (automaton.canMatch(states.back()))
+		{
+			if (automaton.isMatch(states.back()))
+			{
+				terms.emplace_back(term);
+			}
+			++it;
+			continue;
+		}
 
-	for (auto const& token: fileTokens)
-	{
-		if (not invertedIndex.contains(token))
+		// no term starting with these bytes matches, skip to the first one that doesn't start with them
+		auto successor = std::string{term.substr(0, states.size() - 1)};
+		while (not successor.empty() && static_cast<unsigned char>(successor.back()) == 0xFF)
 		{
-			invertedIndex.insert({token, {}});
+			successor.pop_back();
 		}
-		invertedIndex.at(token).insert(fileId);
+		if (successor.empty())
+		{
+			break;
+		}
+		successor.back() = static_cast<char>(successor.back() + 1);
+		it = termDictionary.lower_bound(successor);
 	}
-	forwardIndex.insert({fileId, std::move(fileTokens)});
-
-	std::unique_lock<std::mutex> workerPin{workerMutex};
-	threadWorkers[parent]--;
-	numWorkers--;
-	workerSync.notify_one();
 }
 
-void Indexer::Indexer::removeFile(std::filesystem::path const& path)
+void Indexer::Indexer::publishSnapshot(std::filesystem::path const& file) const
 {
-	std::unique_lock pin{indexMutex};
-	assert(fileToId.contains(path));
-	auto fileId = fileToId.at(path);
-	if (forwardIndex.contains(fileId))
+	SnapshotWriter writer;
+	WriteAheadLog* log = nullptr;
+	std::uint64_t logSequence = 0;
 	{
-		auto& fileTokens = forwardIndex.at(fileId);
-		for (auto const& token: fileTokens)
+		auto pin = lockIndex();
+		if (changeLog && std::filesystem::weakly_canonical(file) == persistedSnapshot)
+		{
+			log = changeLog.get();
+			logSequence = log->lastSequence();  // the changes up to here are all in what we collect
+		}
+		for (TokenizerRegistry::Index tokenizer = 0; tokenizer < tokenizers.size(); tokenizer++)
+		{
+			writer.addTokenizer(tokenizers.normalizationOf(tokenizer));
+		}
+		constexpr auto unpublished = std::numeric_limits<Snapshot::Posting>::max();
+		std::vector<Snapshot::Posting> postingOf(fileInfo.size(), unpublished);  // by file id
+		for (FileId fileId = 0; fileId < fileInfo.size(); fileId++)
+		{
+			if (isIndexed(fileId))
+			{
+				auto const& info = *fileInfo[fileId];
+				Snapshot::File metadata{};
+				metadata.size = info.size;
+				metadata.lastWriteTime = info.lastWriteTime.time_since_epoch().count();
+				metadata.indexedAt = info.indexedAt.time_since_epoch().count();
+				metadata.contentHash = info.contentHash;
+				metadata.tokenizer = info.tokenizer;
+				postingOf[fileId] = writer.addFile(filePaths.path(fileId).string(), metadata);
+			}
+		}
+
+		auto addTerm = [&](std::string const& term, auto const& files)
+		{
+			std::vector<Snapshot::Posting> postings;
+			postings.reserve(files.size());
+			for (auto fileId: files)
+			{
+				if (postingOf[fileId] != unpublished)  // still waiting for a bulk merge
+				{
+					postings.push_back(postingOf[fileId]);
+				}
+			}
+			if (not postings.empty())
+			{
+				writer.addTerm(term, std::move(postings));
+			}
+		};
+		for (auto const& [term, list]: invertedIndex)
+		{
+			addTerm(term, list.files);
+		}
+		for (auto const& [term, spilled]: spilledPostings)
 		{
-			invertedIndex.at(token).erase(fileId);
+			addTerm(term, postingSegments[spilled.segment]->postings(spilled.extent));
 		}
-		forwardIndex.erase(fileId);
+	}
+	writer.write(file, logSequence);  // unlocked, the writer has its own copy
+	if (log)  // only now that the snapshot is on disk, a failed write threw past this
+	{
+		log->truncateThrough(logSequence);
 	}
 }
 
-void Indexer::Indexer::reindexFile(std::filesystem::path const& path)
+void Indexer::Indexer::persist(std::filesystem::path const& snapshotFile, WriteAheadLog::Options options)
 {
-	if (not std::filesystem::exists(path))  // deleted while we weren't looking
+	auto pin = lockIndex();
+	if (changeLog || fileIds.size() > 0)
 	{
-		return;
+		throw std::logic_error{"persist() must come before any paths are added"};
 	}
 
-	std::unique_lock pin{indexMutex};
-	assert(fileToId.contains(path));
-	auto fileId = getFileId(path);
+	std::uint64_t snapshotSequence = 0;
+	if (std::filesystem::exists(snapshotFile))
+	{
+		IndexSnapshot snapshot{snapshotFile};
+		restoreSnapshotUnsafe(snapshot);
+		snapshotSequence = snapshot.logSequence();
+	}
 
-	auto newTokens = getFileTokens(path, tokenizer->clone());
-	assert(forwardIndex.contains(fileId));
-	auto& fileTokens = forwardIndex.at(fileId);
+	auto logFile = snapshotFile;
+	logFile += ".wal";
+	auto log = std::make_unique<WriteAheadLog>(logFile, options);
+	log->replay(snapshotSequence, [this](WriteAheadLog::Change change) { applyChangeUnsafe(std::move(change)); });
+	if (log->lastSequence() < snapshotSequence)
+	{
+		log->truncateThrough(snapshotSequence);  // lost or older than the snapshot, its sequences must go on from there
+	}
+	changeLog = std::move(log);
+	persistedSnapshot = std::filesystem::weakly_canonical(snapshotFile);
 
-	for (auto it = fileTokens.begin(); it != fileTokens.end(); )
+	for (FileId fileId = 0; fileId < fileInfo.size(); fileId++)  // deleted while nobody was watching
 	{
-		auto& token = *it;
+		if (isIndexed(fileId) && not std::filesystem::exists(filePaths.path(fileId)))
+		{
+			removeFileUnsafe(fileId);
+		}
+	}
+	compactFileIdsIfSparseUnsafe();
+	enforceMemoryBudgetUnsafe();
+}
 
-		if (not newTokens.contains(token))
+void Indexer::Indexer::restoreSnapshotUnsafe(IndexSnapshot const& snapshot)
+{
+	// the postings inverted into each file's terms, packed by file: those of file i are at [firstTerm[i], firstTerm[i + 1])
+	auto fileCount = snapshot.fileCount();
+	std::vector<std::size_t> firstTerm(fileCount + 1, 0);
+	for (std::size_t term = 0; term < snapshot.termCount(); term++)
+	{
+		for (auto posting: snapshot.postingsOf(term))
 		{
-			invertedIndex.at(token).erase(fileId);
-			it = fileTokens.erase(it);  // advances the iterator
+			if (posting < fileCount)
+			{
+				firstTerm[posting + 1]++;
+			}
 		}
-		else  // advance normally
+	}
+	for (std::size_t i = 0; i < fileCount; i++)
+	{
+		firstTerm[i + 1] += firstTerm[i];
+	}
+	std::vector<std::uint32_t> fileTerms(firstTerm.back());
+	auto nextTerm = firstTerm;
+	for (std::size_t term = 0; term < snapshot.termCount(); term++)  // in order, so each file's terms come out sorted
+	{
+		for (auto posting: snapshot.postingsOf(term))
 		{
-			++it;
+			if (posting < fileCount)
+			{
+				fileTerms[nextTerm[posting]++] = static_cast<std::uint32_t>(term);
+			}
 		}
 	}
 
-	for (auto const& token: newTokens)
+	std::vector<FileId> fileIdOf(fileCount);  // by posting
+	std::vector<std::string_view> terms;
+	for (Snapshot::Posting posting = 0; posting < fileCount; posting++)
 	{
-		if (fileTokens.contains(token))
+		auto const& file = snapshot.file(posting);
+		auto fileId = getFileId(std::filesystem::path{snapshot.path(posting)});
+		fileInfo[fileId] = restoredFileInfo(file.size, file.lastWriteTime, file.indexedAt, file.contentHash, file.tokenizer);
+		auto tokens = findTokens(file.contentHash);
+		if (not tokens)
 		{
-			continue;  // nothing to be chenged here
+			terms.clear();
+			for (auto i = firstTerm[posting]; i < firstTerm[posting + 1]; i++)
+			{
+				terms.push_back(snapshot.term(fileTerms[i]));
+			}
+			tokens = shareTokens(TokenList::fromSorted(terms));
+			contentTokens.insert_or_assign(file.contentHash, tokens);
 		}
-		if (not invertedIndex.contains(token))
+		forwardIndex[fileId] = std::move(tokens);
+		fileIdOf[posting] = fileId;
+	}
+	fileTerms = {};
+	metrics.add(Metrics::Counter::FilesIndexed, snapshot.fileCount());
+
+	for (std::size_t term = 0; term < snapshot.termCount(); term++)
+	{
+		auto& list = postingsFor(snapshot.term(term));
+		for (auto posting: snapshot.postingsOf(term))
 		{
-			invertedIndex.insert({token, {}});
+			if (posting < fileIdOf.size() && list.files.insert(fileIdOf[posting]).second)
+			{
+				postingsBytes += hashNodeBytes<FileId>;
+			}
 		}
-		invertedIndex.at(token).insert(fileId);
+		list.lastUsed = ++useCounter;
 	}
-	fileTokens = std::move(newTokens);
 }
 
-void Indexer::Indexer::awaitCreation(std::filesystem::path const& path)
+void Indexer::Indexer::applyChangeUnsafe(WriteAheadLog::Change change)
 {
-	try
+	using Type = WriteAheadLog::Change::Type;
+	switch (change.type)
 	{
-		if (std::filesystem::exists(path))
+	case Type::Indexed:
+	{
+		auto fileId = getFileId(std::filesystem::path{change.path});
+		auto tokens = findTokens(change.contentHash);
+		if (not tokens)
+		{
+			tokens = shareTokens(std::move(*change.tokens));
+			contentTokens.insert_or_assign(change.contentHash, tokens);
+		}
+		if (isIndexed(fileId))
+		{
+			replaceTokensUnsafe(fileId, std::move(tokens));
+		}
+		else
+		{
+			for (auto token: *tokens)
+			{
+				addPosting(token, fileId);
+			}
+			forwardIndex[fileId] = std::move(tokens);
+			metrics.add(Metrics::Counter::FilesIndexed);
+		}
+		fileInfo[fileId] = restoredFileInfo(change.size, change.lastWriteTime, change.indexedAt, change.contentHash, change.tokenizer);
+		break;
+	}
+	case Type::Removed:
+		if (auto fileId = filePaths.find(std::filesystem::path{change.path}); fileId && isIndexed(*fileId))
+		{
+			removeFileUnsafe(*fileId);
+		}
+		break;
+	case Type::Moved:
+	{
+		std::filesystem::path from{change.path};
+		std::filesystem::path to{change.target};
+		std::vector<FileId> displacedIds;
+		if (change.isDirectory)
+		{
+			displacedIds = filePaths.moveDirectory(from, to);
+		}
+		else if (auto displacedId = filePaths.moveFile(from, to))
+		{
+			displacedIds.push_back(*displacedId);
+		}
+		for (auto fileId: displacedIds)
+		{
+			removeFileUnsafe(fileId);
+		}
+		break;
+	}
+	}
+	enforceMemoryBudgetUnsafe();
+}
+
+void Indexer::Indexer::logIndexedUnsafe(FileId fileId)
+{
+	if (not changeLog)
+	{
+		return;
+	}
+	auto const& info = *fileInfo[fileId];
+	changeLog->append({
+		.type = WriteAheadLog::Change::Type::Indexed,
+		.path = filePaths.path(fileId).string(),
+		.size = info.size,
+		.lastWriteTime = info.lastWriteTime.time_since_epoch().count(),
+		.indexedAt = info.indexedAt.time_since_epoch().count(),
+		.contentHash = info.contentHash,
+		.tokenizer = info.tokenizer,
+		.tokens = forwardIndex[fileId],
+	});
+}
+
+Indexer::IndexerStats Indexer::Indexer::stats() const
+{
+	IndexerStats stats;
+	metrics.collect(stats);
+	{
+		std::unique_lock pin{workerMutex};
+		stats.activeWorkers = numWorkers;
+		stats.pendingFiles = pendingFiles;
+	}
+	auto queued = [this](Priority priority)
+	{
+		return readQueue.size(static_cast<std::size_t>(priority)) + tokenizeQueue.size(static_cast<std::size_t>(priority));
+	};
+	stats.queuedInteractive = queued(Priority::Interactive);
+	stats.queuedNormal = queued(Priority::Normal);
+	stats.queuedBackground = queued(Priority::Background);
+	auto pin = lockIndex();
+	stats.indexedFiles = filePaths.size();
+	stats.distinctTokens = invertedIndex.size() + spilledPostings.size();
+	stats.dictionaryBytes = dictionaryBytes;
+	stats.postingsBytes = postingsBytes;
+	stats.forwardIndexBytes = *forwardIndexBytes + fileInfo.capacity() * sizeof(fileInfo[0]) + forwardIndex.capacity() * sizeof(forwardIndex[0]);
+	stats.pathBytes = filePaths.memoryUsage();
+	stats.spilledTokens = spilledPostings.size();
+	stats.spilledBytes = spilledBytes;
+	stats.memoryBudget = memoryBudget;
+	return stats;
+}
+
+void Indexer::Indexer::setMemoryBudget(std::size_t bytes, std::filesystem::path directory)
+{
+	auto pin = lockIndex();
+	memoryBudget = bytes;
+	spillDirectory = std::move(directory);
+	enforceMemoryBudgetUnsafe();
+}
+
+std::unique_lock<std::mutex> Indexer::Indexer::lockIndex() const
+{
+	std::unique_lock pin{indexMutex, std::defer_lock};
+	relockIndex(pin);
+	return pin;
+}
+
+void Indexer::Indexer::relockIndex(std::unique_lock<std::mutex>& pin) const
+{
+	if (pin.try_lock())
+	{
+		metrics.record(Metrics::Timer::IndexLockWait, {});
+		return;
+	}
+	auto start = std::chrono::steady_clock::now();
+	pin.lock();
+	metrics.record(Metrics::Timer::IndexLockWait, std::chrono::steady_clock::now() - start);
+}
+
+void Indexer::Indexer::addDirectory(std::filesystem::path const& path, Recursive recursively)
+{
+	assert(std::filesystem::is_directory(path));
+
+	// only locking for these two operations
+	{
+		auto pin = lockIndex();
+		runtime->watchDirectory(*this, path);
+		indexedDirectories.insert({path, recursively});
+	}
+
+	auto task = currentTask();
+	for (auto&& p: std::filesystem::directory_iterator(path))
+	{
+		if (task && task->isCancelled())
 		{
-			addPath(path);
 			return;
 		}
+		auto entry = p.path();
+		auto isDirectory = p.is_directory();
+		if (isIgnored(entry, isDirectory))
+		{
+			continue;  // whole subtrees are pruned here
+		}
 
-		auto existingParent = path.parent_path();
-		while (not std::filesystem::exists(existingParent))
+		if (not isDirectory)
 		{
-			existingParent = existingParent.parent_path();
+			addFile(entry);
 		}
-		if (not creationWatches.contains(existingParent))
+		else if (recursively == Recursive::Yes)
 		{
-			watcher.addDirectory(existingParent);
-			creationWatches.insert({existingParent, {}});
+			addDirectory(entry, recursively);
 		}
-		creationWatches.at(existingParent).insert(path.lexically_relative(existingParent));
 	}
-	catch(const std::filesystem::filesystem_error& e)
+}
+
+bool Indexer::Indexer::isIgnored(std::filesystem::path const& path, bool isDirectory)
+{
+	if (fileFilter.isExcluded(path))
 	{
-		std::cerr << e.what() << '\n';
-		std::cerr << e.code() << '\n';
+		return true;
+	}
+	if (not fileFilter.respectIgnoreFiles)
+	{
+		return false;
+	}
+	if (isDirectory && path.filename() == ".git")
+	{
+		return true;
 	}
+
+	auto rules = ignoreRulesFor(path.parent_path());
+	return rules && rules->isIgnored(path, isDirectory);
 }
 
-void Indexer::Indexer::watchFilesystem()
+std::shared_ptr<Indexer::IgnoreRules const> Indexer::Indexer::ignoreRulesFor(std::filesystem::path const& directory)
 {
-	while (not doStop)
 	{
-		for (auto const& event: watcher.pollEvents())
+		std::unique_lock pin{ignoreRulesMutex};
+		if (ignoreRules.contains(directory))
 		{
-			switch (event.type)
-			{
-				case FilesystemWatcher::EventType::Modified:
-					reindexFile(event.path);
-					break;
+			return ignoreRules.at(directory);
+		}
+	}
 
-				case FilesystemWatcher::EventType::Created:
-					{
-						auto parent = event.path.parent_path();
-						if (not event.isDirectory)
-						{
-							if (indexedDirectories.contains(parent) || addedPaths.contains(event.path))
-							{
-								addFile(event.path);
-							}
-						}
-						else if (indexedDirectories.contains(parent) && indexedDirectories.at(parent) == Recursive::Yes)
-						{
-							addDirectory(event.path, Recursive::Yes);
-						}
-
-						if (creationWatches.contains(parent))
-						{
-							auto& watches = creationWatches.at(parent);
-							auto name = event.path.filename();
-
-							if (watches.contains(name))
-							{
-								addPath(event.path);
-								watches.erase(name);
-							}
-
-							for (auto it = watches.begin(); it != watches.end(); )
-							{
-								auto& path = *it;
-
-								if (path.has_parent_path() && head(path) == name)
-								{
-									auto fullPath = parent / path;
-									it = watches.erase(it);  // advances the iterator
-									awaitCreation(fullPath);
-								}
-								else  // advance normally
-								{
-									++it;
-								}
-							}
-
-							if (watches.empty())
-							{
-								watcher.removePath(parent);
-								creationWatches.erase(parent);
-							}
-						}
-					}
-					break;
+	// rules are inherited from the repository root down, or outside a repository, from the added path down
+	std::shared_ptr<IgnoreRules const> parentRules;
+	auto parent = directory.parent_path();
+	if (directory.has_relative_path() && not std::filesystem::exists(directory / ".git")
+		&& (isUnderAddedPath(parent) || isInRepository(parent)))
+	{
+		parentRules = ignoreRulesFor(parent);
+	}
+	auto rules = IgnoreRules::load(directory, std::move(parentRules));
 
-				case FilesystemWatcher::EventType::Deleted:
-					if (fileToId.contains(event.path))
-					{
-						removeFile(event.path);
-					}
-					if (addedPaths.contains(event.path))
-					{
-						awaitCreation(event.path);
-					}
-					if (creationWatches.contains(event.path))
-					{
-						for (auto& path: creationWatches.at(event.path))
-						{
-							awaitCreation(event.path / path);
-						}
-						watcher.removePath(event.path);
-						creationWatches.erase(event.path);
-					}
-					break;
-			}
-		}
+	std::unique_lock pin{ignoreRulesMutex};
+	ignoreRules.insert({directory, rules});
+	return rules;
+}
+
+bool Indexer::Indexer::isUnderAddedPath(std::filesystem::path const& path) const
+{
+	auto pin = lockIndex();
+	return std::any_of(addedPaths.begin(), addedPaths.end(), [&](auto const& added) { return isWithin(path, added); });
+}
+
+bool Indexer::Indexer::isInRepository(std::filesystem::path const& directory)
+{
+	for (auto ancestor = directory; ; ancestor = ancestor.parent_path())
+	{
+		if (std::filesystem::exists(ancestor / ".git"))
+		{
+			return true;
+		}
+		if (not ancestor.has_relative_path())
+		{
+			return false;
+		}
+	}
+}
+
+void Indexer::Indexer::forgetIgnoreRules(std::filesystem::path const& directory)
+{
+	std::unique_lock pin{ignoreRulesMutex};
+	std::erase_if(ignoreRules, [&](auto const& entry) { return isWithin(entry.first, directory); });
+}
+
+namespace
+{
+// a stat-clean file is only trusted if it was written well before we last read it,
+// otherwise a write landing in the same timestamp tick would go unnoticed
+constexpr auto racyWriteWindow = std::chrono::seconds{1};
+
+// how much of the previously indexed contents is compared to detect a pure append
+constexpr std::uintmax_t appendWindow = 4096;
+
+// smaller spills would leave a trail of tiny segment files when little is left to spill
+constexpr std::size_t minSpillBytes = 64 * 1024;
+
+constexpr std::size_t bulkMergeBatch = 64 * 1024;  // postings handed over per index lock
+
+}
+
+std::string readFile(std::filesystem::path const& path, std::uintmax_t offset = 0)
+{
+	std::ifstream f{path, std::ios::binary};
+	std::error_code errorCode;
+	auto fileSize = std::filesystem::file_size(path, errorCode);
+	if (errorCode || fileSize < offset)
+	{
+		return {};
+	}
+	auto size = fileSize - offset;
+
+	f.seekg(static_cast<std::streamoff>(offset));
+	std::string contents(size, '\0');
+	f.read(contents.data(), static_cast<std::streamsize>(size));
+	contents.resize(static_cast<std::size_t>(f.gcount()));  // in case the file shrunk in the meantime
+	return contents;
+}
+
+Indexer::TokenList getFileTokens(std::string_view contents, Indexer::Tokenizer& tokenizer)
+{
+	thread_local Indexer::TokenCollector fileTokens;  // keeps its memory from one file to the next
+	std::size_t lineStart = 0;
+	while (true)
+	{
+		auto lineEnd = contents.find('\n', lineStart);
+		auto isLastLine = lineEnd == std::string_view::npos;
+		tokenizer.sendLine(contents.substr(lineStart, isLastLine ? std::string_view::npos : lineEnd - lineStart));
+
+		if (isLastLine)
+		{
+			tokenizer.sendEof();
+		}
+
+		while (not tokenizer.done())
+		{
+			fileTokens.insert(tokenizer.next());
+		}
+
+		if (isLastLine)
+		{
+			break;
+		}
+		lineStart = lineEnd + 1;
+	}
+
+	return fileTokens.take();
+}
+
+Indexer::TokenList Indexer::Indexer::tokenize(TokenizerRegistry::Index tokenizer, std::string_view contents) const
+{
+	TraceSpan span{metrics, "getFileTokens", Metrics::Timer::Tokenize};
+	metrics.add(Metrics::Counter::BytesTokenized, contents.size());
+	return getFileTokens(contents, tokenizers.get(tokenizer));
+}
+
+void Indexer::Indexer::addFile(std::filesystem::path const& path)
+{
+	if (not std::filesystem::exists(path))  // deleted while we weren't looking
+	{
+		return;
+	}
+
+	assert(std::filesystem::is_regular_file(path) || std::filesystem::is_symlink(path));
+
+	if (fileFilter.isExcluded(path))
+	{
+		return;  // size and contents are checked by the tokenizing worker, once the file is read
+	}
+
+	std::call_once(pipelineStarted, [this](){ startPipeline(); });
+	auto threadId = std::this_thread::get_id();
+	std::shared_ptr<IndexingTask::State> task;
+	auto priority = runtime->isEventThread() ? Priority::Interactive : Priority::Normal;
+	{
+		std::unique_lock<std::mutex> pin{workerMutex};
+		if (auto it = threadPriorities.find(threadId); it != threadPriorities.end())
+		{
+			priority = it->second;
+		}
+		if (auto it = threadTasks.find(threadId); it != threadTasks.end())
+		{
+			task = it->second;
+			if (task->isCancelled())
+			{
+				return;
+			}
+			task->filesDiscovered++;
+		}
+		threadWorkers[threadId]++;
+		pendingFiles++;
+	}
+	readQueue.push(static_cast<std::size_t>(priority),  // blocks while the pipeline is backed up with files of this priority
+		std::make_unique<IngestJob>(IngestJob{.path = path, .parent = threadId, .priority = priority, .task = std::move(task)}));
+}
+
+void Indexer::Indexer::startPipeline()
+{
+	mergeThread = std::thread{&Indexer::mergeFiles, this};
+	readThread = std::thread{&Indexer::readFiles, this};
+}
+
+void Indexer::Indexer::stopPipeline()
+{
+	if (not readThread.joinable())
+	{
+		return;  // never started
+	}
+	readQueue.close();  // passed down the stages once everything queued so far is through
+	readThread.join();
+	{
+		std::unique_lock<std::mutex> pin{workerMutex};
+		workerSync.wait(pin, [this](){ return pendingFiles == 0 && numWorkers == 0; });  // the runtime's workers got to all of them
+	}
+	mergeQueue.push(nullptr);
+	mergeThread.join();
+}
+
+void Indexer::Indexer::readFiles()
+{
+	std::vector<std::unique_ptr<IngestJob>> batch;
+	std::vector<std::filesystem::path> paths;
+	std::vector<std::size_t> toRead;  // into the batch, by path
+	bool isStopping = false;
+	while (not isStopping)
+	{
+		batch.push_back(readQueue.pop());
+		while (batch.back() && batch.size() < readBatchSize)
+		{
+			auto job = readQueue.tryPop();
+			if (not job)
+			{
+				break;
+			}
+			batch.push_back(std::move(*job));
+		}
+		if (not batch.back())
+		{
+			isStopping = true;
+			batch.pop_back();
+		}
+
+		if (fileReader.isAvailable() && not batch.empty())
+		{
+			std::vector<std::optional<FileInfo>> indexed(batch.size());
+			{
+				auto pin = lockIndex();
+				for (std::size_t i = 0; i < batch.size(); i++)
+				{
+					if (auto fileId = filePaths.find(batch[i]->path); fileId && isIndexed(*fileId))
+					{
+						indexed[i] = fileInfo[*fileId];
+					}
+				}
+			}
+			paths.clear();
+			toRead.clear();
+			for (std::size_t i = 0; i < batch.size(); i++)
+			{
+				std::error_code errorCode;
+				if (indexed[i] && indexed[i]->isUnchanged(std::filesystem::file_size(batch[i]->path, errorCode),
+					std::filesystem::last_write_time(batch[i]->path, errorCode)) && not errorCode)
+				{
+					continue;  // the tokenizing worker skips it, e.g. restored by persist() and added again
+				}
+				paths.push_back(batch[i]->path);
+				toRead.push_back(i);
+			}
+			std::vector<std::optional<std::string>> contents;
+			auto readAt = std::filesystem::file_time_type::clock::now();
+			try
+			{
+				contents = fileReader.read(paths, std::min(fileFilter.maxFileSize, maxBatchedFileSize));
+			}
+			catch (std::exception const& e)
+			{
+				std::cerr << e.what() << '\n';
+				contents.assign(paths.size(), std::nullopt);  // the tokenizing workers read them instead
+			}
+			for (std::size_t i = 0; i < toRead.size(); i++)
+			{
+				if (contents[i])
+				{
+					metrics.add(Metrics::Counter::FilesReadInBatches);
+				}
+				batch[toRead[i]]->contents = std::move(contents[i]);
+				batch[toRead[i]]->readAt = readAt;
+			}
+		}
+
+		for (auto& job: batch)
+		{
+			auto priority = static_cast<std::size_t>(job->priority);
+			tokenizeQueue.push(priority, std::move(job));
+			runtime->queueFile(*this);
+		}
+		batch.clear();
+	}
+}
+
+void Indexer::Indexer::tokenizeNext()
+{
+	auto job = tokenizeQueue.pop();  // there is one, see IndexerRuntime::queueFile()
+	{
+		std::unique_lock<std::mutex> pin{workerMutex};
+		pendingFiles--;
+		numWorkers++;
+	}
+
+	auto const& path = job->path;
+	auto indexedAt = std::filesystem::file_time_type::clock::now();
+	std::error_code errorCode;
+	auto lastWriteTime = std::filesystem::last_write_time(path, errorCode);
+	auto isCancelled = job->task && job->task->isCancelled();
+	auto isIndexable = not isCancelled
+		&& (job->contents ? fileFilter.acceptsContents(*job->contents, job->contents->size()) : fileFilter.isIndexable(path));
+	std::optional<FileInfo> indexed;
+	if (not errorCode && isIndexable)
+	{
+		auto pin = lockIndex();
+		runtime->watchFile(*this, path);
+		if (auto fileId = getFileId(path); isIndexed(fileId))  // from here on, deleting the file drops it from the merge
+		{
+			indexed = fileInfo[fileId];
+		}
+	}
+	if (indexed && indexed->isUnchanged(std::filesystem::file_size(path, errorCode), lastWriteTime) && not errorCode)
+	{
+		job->contents.reset();  // e.g. restored by persist() and added again, reading it would change nothing
+	}
+	else if (not errorCode && isIndexable)
+	{
+		if (job->contents && lastWriteTime + racyWriteWindow >= job->readAt)
+		{
+			job->contents.reset();  // may have been read mid-write, with its Modified event ignored before it had an id
+		}
+		auto contents = job->contents ? std::move(*job->contents) : readFile(path);
+		job->contents.reset();
+		if (job->task)
+		{
+			job->task->bytesRead += contents.size();
+		}
+		job->info = makeFileInfo(contents, tokenizers.select(path, contents), lastWriteTime, indexedAt);
+		std::optional<FileId> bulkFileId;
+		{
+			auto pin = lockIndex();
+			job->tokens = findTokens(job->info->contentHash);
+			if (bulkBuild && bulkBuild->owner == job->parent)  // only changes once all of its files are done
+			{
+				bulkFileId = filePaths.find(path);
+			}
+		}
+		if (not job->tokens)
+		{
+			job->tokens = shareTokens(tokenize(job->info->tokenizer, contents));
+		}
+		if (bulkFileId)
+		{
+			bulkBuild->inverter.add(*bulkFileId, *job->tokens);  // ignored at the merge unless the file is still pending by then
+		}
+	}
+
+	if (job->tokens)
+	{
+		mergeQueue.push(std::move(job));  // before it stops counting as busy, stopPipeline() ends the merge after that
+	}
+	std::unique_lock<std::mutex> pin{workerMutex};
+	numWorkers--;
+	if (job)  // gone, too large, binary, cancelled or indexed as it is already
+	{
+		if (job->task)
+		{
+			job->task->filesSkipped++;
+		}
+		threadWorkers[job->parent]--;
+		workerSync.notify_all();
+	}
+	else if (numWorkers == 0)
+	{
+		workerSync.notify_all();
+	}
+}
+
+void Indexer::Indexer::mergeFiles()
+{
+	std::vector<std::unique_ptr<IngestJob>> batch;
+	bool isStopping = false;
+	while (not isStopping)
+	{
+		batch.push_back(mergeQueue.pop());
+		while (batch.back() && batch.size() < mergeBatchSize)
+		{
+			auto job = mergeQueue.tryPop();
+			if (not job)
+			{
+				break;
+			}
+			batch.push_back(std::move(*job));
+		}
+		if (not batch.back())
+		{
+			isStopping = true;
+			batch.pop_back();
+		}
+
+		if (not batch.empty())
+		{
+			mergeBatch(batch);
+			batch.clear();
+		}
+	}
+}
+
+void Indexer::Indexer::mergeBatch(std::vector<std::unique_ptr<IngestJob>> const& jobs)
+{
+	std::vector<std::filesystem::path> stalePaths;  // changed while in the pipeline
+	{
+		auto pin = lockIndex();
+		TraceSpan span{metrics, "merge", Metrics::Timer::Merge};
+		std::vector<std::pair<std::string_view, FileId>> postings;
+		for (auto const& job: jobs)
+		{
+			contentTokens.insert_or_assign(job->info->contentHash, job->tokens);
+
+			// the id may have been recycled or compacted away while the file was in the pipeline
+			auto fileId = filePaths.find(job->path);
+			if (not fileId || isIndexed(*fileId) || isPendingBulk(*fileId))
+			{
+				if (fileId && isIndexed(*fileId) && fileInfo[*fileId]->contentHash != job->info->contentHash)
+				{
+					stalePaths.push_back(job->path);  // queued twice and read before and after a write
+				}
+				if (job->task)
+				{
+					job->task->filesSkipped++;
+				}
+				continue;
+			}
+			if (job->task)
+			{
+				job->task->filesIndexed++;
+			}
+			if (bulkBuild && bulkBuild->owner == job->parent)  // its postings are in the inverter already
+			{
+				bulkBuild->pendingFiles.insert({*fileId, {std::move(*job->info), job->tokens}});
+				continue;
+			}
+
+			metrics.add(Metrics::Counter::FilesIndexed);
+			for (auto token: *job->tokens)
+			{
+				postings.emplace_back(token, *fileId);
+			}
+			forwardIndex[*fileId] = job->tokens;
+			fileInfo[*fileId] = std::move(*job->info);
+			logIndexedUnsafe(*fileId);
+			if (modifiedInPipeline.erase(job->path) > 0)
+			{
+				stalePaths.push_back(job->path);
+			}
+		}
+
+		// sorted by term, each posting list is looked up once for the whole batch
+		std::sort(postings.begin(), postings.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+		for (auto it = postings.begin(); it != postings.end(); )
+		{
+			auto token = it->first;
+			auto& list = postingsFor(token);
+			for (; it != postings.end() && it->first == token; ++it)
+			{
+				if (list.files.insert(it->second).second)
+				{
+					postingsBytes += hashNodeBytes<FileId>;
+				}
+			}
+			list.lastUsed = ++useCounter;
+		}
+		enforceMemoryBudgetUnsafe();
+	}
+
+	for (auto const& path: stalePaths)  // before addPath returns for them
+	{
+		reindexFile(path);
+	}
+
+	std::unique_lock<std::mutex> pin{workerMutex};
+	for (auto const& job: jobs)
+	{
+		threadWorkers[job->parent]--;
+	}
+	workerSync.notify_all();
+}
+
+void Indexer::Indexer::finishBulkBuild()
+{
+	// all of the workers feeding the inverter are done, the merge itself runs unlocked
+	// and hands its posting lists over in batches
+	std::unique_lock pin{indexMutex, std::defer_lock};
+	std::vector<std::pair<std::string, std::vector<FileId>>> batch;
+	std::size_t batchPostings = 0;
+	auto mergeBatch = [&]()
+	{
+		relockIndex(pin);
+		TraceSpan span{metrics, "bulk merge", Metrics::Timer::Merge};
+		for (auto const& [token, files]: batch)
+		{
+			PostingList* list = nullptr;
+			for (auto fileId: files)
+			{
+				if (not isPendingBulk(fileId))  // removed while we weren't looking
+				{
+					continue;
+				}
+				if (not list)
+				{
+					list = &postingsFor(token);
+					list->files.reserve(list->files.size() + files.size());
+				}
+				if (list->files.insert(fileId).second)
+				{
+					postingsBytes += hashNodeBytes<FileId>;
+				}
+			}
+			if (list)
+			{
+				list->lastUsed = ++useCounter;
+			}
+		}
+		enforceMemoryBudgetUnsafe();
+		pin.unlock();
+		batch.clear();
+		batchPostings = 0;
+	};
+
+	bulkBuild->inverter.merge([&](std::string const& token, std::span<FileId const> files)
+	{
+		batch.emplace_back(token, std::vector<FileId>(files.begin(), files.end()));
+		batchPostings += files.size();
+		if (batchPostings >= bulkMergeBatch)
+		{
+			mergeBatch();
+		}
+	});
+	mergeBatch();
+
+	relockIndex(pin);
+	for (auto& [fileId, pending]: bulkBuild->pendingFiles)
+	{
+		forwardIndex[fileId] = std::move(pending.tokens);
+		fileInfo[fileId] = std::move(pending.info);
+		logIndexedUnsafe(fileId);
+	}
+	metrics.add(Metrics::Counter::FilesIndexed, bulkBuild->pendingFiles.size());
+	for (auto fileId: bulkBuild->releasedIds)
+	{
+		fileIds.release(fileId);
+	}
+	auto modifiedPaths = std::move(bulkBuild->modifiedPaths);
+	bulkBuild.reset();
+	compactFileIdsIfSparseUnsafe();
+	enforceMemoryBudgetUnsafe();
+	pin.unlock();
+
+	for (auto const& path: modifiedPaths)
+	{
+		reindexFile(path);
+	}
+}
+
+void Indexer::Indexer::removeFile(std::filesystem::path const& path)
+{
+	auto pin = lockIndex();
+	auto fileId = filePaths.find(path);
+	if (not fileId)  // e.g. gone with a reindex that lost the race
+	{
+		return;
+	}
+	removeFileUnsafe(*fileId);
+	compactFileIdsIfSparseUnsafe();
+}
+
+void Indexer::Indexer::removeFilesUnder(std::filesystem::path const& directory)
+{
+	auto pin = lockIndex();
+	for (auto fileId: filePaths.filesUnder(directory))
+	{
+		runtime->unwatch(*this, filePaths.path(fileId));
+		removeFileUnsafe(fileId);
+	}
+	compactFileIdsIfSparseUnsafe();
+}
+
+void Indexer::Indexer::removeFileUnsafe(FileId fileId)
+{
+	if (changeLog && isIndexed(fileId) && filePaths.contains(fileId))  // without a path, it was moved over and logged with the move
+	{
+		changeLog->append({.type = WriteAheadLog::Change::Type::Removed, .path = filePaths.path(fileId).string()});
+	}
+	if (bulkBuild)
+	{
+		if (auto pending = bulkBuild->pendingFiles.extract(fileId))
+		{
+			forwardIndex[fileId] = std::move(pending.mapped().tokens);  // some of its postings may be merged already
+		}
+	}
+	if (forwardIndex[fileId])
+	{
+		for (auto const& token: *forwardIndex[fileId])
+		{
+			removePosting(token, fileId);
+		}
+		forwardIndex[fileId].reset();
+	}
+	fileInfo[fileId].reset();
+	metrics.add(Metrics::Counter::FilesRemoved);
+
+	filePaths.erase(fileId);
+	if (bulkBuild)
+	{
+		bulkBuild->releasedIds.push_back(fileId);
+	}
+	else
+	{
+		fileIds.release(fileId);
+	}
+}
+
+void Indexer::Indexer::reindexFile(std::filesystem::path const& path)
+{
+	if (not std::filesystem::exists(path))  // deleted while we weren't looking
+	{
+		return;
+	}
+
+	auto pin = lockIndex();
+	auto knownId = filePaths.find(path);
+	if (knownId && isPendingBulk(*knownId))
+	{
+		bulkBuild->modifiedPaths.insert(path);
+		return;
+	}
+	if (not knownId)
+	{
+		return;
+	}
+	if (not isIndexed(*knownId))  // still being indexed for the first time, maybe from before the change
+	{
+		modifiedInPipeline.insert(path);
+		return;
+	}
+	auto fileId = *knownId;
+
+	std::error_code errorCode;
+	auto lastWriteTime = std::filesystem::last_write_time(path, errorCode);
+	auto size = std::filesystem::file_size(path, errorCode);
+	if (auto const& info = *fileInfo[fileId]; not errorCode && info.isUnchanged(size, lastWriteTime))
+	{
+		return;  // untouched since we last read it
+	}
+	else if (not errorCode && size > info.size && info.endsWithNewline && size <= fileFilter.maxFileSize)
+	{
+		pin.unlock();
+		if (reindexAppended(fileId, path, lastWriteTime))
+		{
+			return;
+		}
+	}
+	else
+	{
+		pin.unlock();
+	}
+
+	auto indexedAt = std::filesystem::file_time_type::clock::now();
+	auto contents = size <= fileFilter.maxFileSize ? readFile(path) : std::string{};
+	if (not fileFilter.acceptsContents(contents, size))
+	{
+		contents.clear();  // became binary or too large since it was added, keep it out of the index
+	}
+	auto newInfo = makeFileInfo(contents, tokenizers.select(path, contents), lastWriteTime, indexedAt);
+	relockIndex(pin);
+
+	auto currentId = filePaths.find(path);
+	if (not currentId || not isIndexed(*currentId))  // removed in the meantime, or queued again from scratch
+	{
+		return;
+	}
+	fileId = *currentId;  // ids may have been compacted in the meantime
+
+	auto& info = *fileInfo[fileId];
+	if (newInfo.contentHash == info.contentHash && newInfo.size == info.size)
+	{
+		info.lastWriteTime = lastWriteTime;
+		info.indexedAt = indexedAt;
+		metrics.add(Metrics::Counter::UnchangedReindexes);
+		return;  // e.g. `touch` or an editor saving without changes
+	}
+	info = std::move(newInfo);
+	metrics.add(Metrics::Counter::FullReindexes);
+
+	auto newTokens = findTokens(info.contentHash);
+	if (not newTokens)
+	{
+		auto tokenizer = info.tokenizer;
+		pin.unlock();
+		newTokens = shareTokens(tokenize(tokenizer, contents));
+		relockIndex(pin);
+		currentId = filePaths.find(path);
+		if (not currentId || not isIndexed(*currentId))
+		{
+			return;
+		}
+		fileId = *currentId;
+		contentTokens.insert_or_assign(fileInfo[fileId]->contentHash, newTokens);
+	}
+
+	TraceSpan span{metrics, "merge", Metrics::Timer::Merge};
+	replaceTokensUnsafe(fileId, std::move(newTokens));
+	logIndexedUnsafe(fileId);
+	enforceMemoryBudgetUnsafe();
+}
+
+void Indexer::Indexer::replaceTokensUnsafe(FileId fileId, std::shared_ptr<TokenList> newTokens)
+{
+	assert(forwardIndex[fileId]);
+	auto& fileTokens = forwardIndex[fileId];
+
+	// both sorted, one pass over them finds the tokens gone and the tokens new
+	auto oldToken = fileTokens->begin();
+	auto newToken = newTokens->begin();
+	while (oldToken != fileTokens->end() || newToken != newTokens->end())
+	{
+		if (newToken == newTokens->end() || (oldToken != fileTokens->end() && *oldToken < *newToken))
+		{
+			removePosting(*oldToken++, fileId);
+		}
+		else if (oldToken == fileTokens->end() || *newToken < *oldToken)
+		{
+			addPosting(*newToken++, fileId);
+		}
+		else
+		{
+			++oldToken;  // nothing to be changed here
+			++newToken;
+		}
+	}
+	fileTokens = std::move(newTokens);  // the old set may still be shared with other files
+}
+
+bool Indexer::Indexer::reindexAppended(FileId fileId, std::filesystem::path const& path, std::filesystem::file_time_type lastWriteTime)
+{
+	auto pin = lockIndex();
+	auto info = *fileInfo[fileId];
+	pin.unlock();
+
+	auto indexedAt = std::filesystem::file_time_type::clock::now();
+	auto windowStart = info.size - std::min(info.size, appendWindow);
+	auto windowSize = info.size - windowStart;
+	auto contents = readFile(path, windowStart);
+	if (contents.size() <= windowSize
+		|| ContentHasher::hash(std::string_view{contents}.substr(0, windowSize)) != info.tailHash)
+	{
+		return false;  // truncated or rewritten, not appended to
+	}
+
+	auto tail = std::string_view{contents}.substr(windowSize);
+	auto tailTokens = tokenize(info.tokenizer, tail);
+
+	relockIndex(pin);
+	auto currentId = filePaths.find(path);
+	if (not currentId || not isIndexed(*currentId))
+	{
+		return true;  // removed in the meantime, nothing left to update
+	}
+	fileId = *currentId;  // in case ids were compacted in the meantime
+	if (auto const& current = *fileInfo[fileId];
+		current.size != info.size || current.lastWriteTime != info.lastWriteTime || current.contentHash != info.contentHash)
+	{
+		return false;  // reindexed in the meantime, our tail may overlap what it read
+	}
+
+	TraceSpan span{metrics, "merge", Metrics::Timer::Merge};
+	metrics.add(Metrics::Counter::AppendReindexes);
+
+	auto const& fileTokens = forwardIndex[fileId];
+	auto hasNewTokens = false;
+	for (auto token: tailTokens)
+	{
+		if (not fileTokens->contains(token))
+		{
+			addPosting(token, fileId);
+			hasNewTokens = true;
+		}
+	}
+	if (hasNewTokens)
+	{
+		forwardIndex[fileId] = shareTokens(TokenList::merged(*fileTokens, tailTokens));  // the old list may be shared with byte-identical files
+	}
+
+	auto& newInfo = *fileInfo[fileId];
+	newInfo.size = info.size + tail.size();
+	newInfo.lastWriteTime = lastWriteTime;
+	newInfo.indexedAt = indexedAt;
+	newInfo.hasher.update(tail);
+	newInfo.contentHash = newInfo.hasher.digest();
+	newInfo.tailHash = ContentHasher::hash(std::string_view{contents}.substr(contents.size() - std::min(contents.size(), std::size_t{appendWindow})));
+	newInfo.endsWithNewline = tail.back() == '\n';
+	contentTokens.insert_or_assign(newInfo.contentHash, forwardIndex[fileId]);
+	logIndexedUnsafe(fileId);
+	enforceMemoryBudgetUnsafe();
+	return true;
+}
+
+Indexer::Indexer::FileInfo Indexer::Indexer::makeFileInfo(std::string_view contents, TokenizerRegistry::Index tokenizer, std::filesystem::file_time_type lastWriteTime, std::filesystem::file_time_type indexedAt)
+{
+	ContentHasher hasher{tokenizer};
+	hasher.update(contents);
+	auto tail = contents.substr(contents.size() - std::min(contents.size(), std::size_t{appendWindow}));
+	return FileInfo{
+		contents.size(), lastWriteTime, indexedAt,
+		hasher, hasher.digest(), ContentHasher::hash(tail),
+		not contents.empty() && contents.back() == '\n', tokenizer
+	};
+}
+
+Indexer::Indexer::FileInfo Indexer::Indexer::restoredFileInfo(std::uintmax_t size, std::int64_t lastWriteTime, std::int64_t indexedAt, std::uint64_t contentHash, std::uint64_t tokenizer)
+{
+	using Time = std::filesystem::file_time_type;
+	auto index = static_cast<TokenizerRegistry::Index>(tokenizer);
+	return FileInfo{
+		size, Time{Time::duration{lastWriteTime}}, Time{Time::duration{indexedAt}},
+		ContentHasher{index}, contentHash, 0,
+		false, index
+	};
+}
+
+bool Indexer::Indexer::FileInfo::isUnchanged(std::uintmax_t size_, std::filesystem::file_time_type lastWriteTime_) const
+{
+	return size_ == size && lastWriteTime_ == lastWriteTime && lastWriteTime_ + racyWriteWindow < indexedAt;
+}
+
+std::shared_ptr<Indexer::TokenList> Indexer::Indexer::findTokens(std::uint64_t contentHash)
+{
+	if (not contentTokens.contains(contentHash))
+	{
+		return nullptr;
+	}
+
+	auto tokens = contentTokens.at(contentHash).lock();
+	if (not tokens)  // every file with these contents is gone
+	{
+		contentTokens.erase(contentHash);
+	}
+	return tokens;
+}
+
+std::shared_ptr<Indexer::TokenList> Indexer::Indexer::shareTokens(TokenList tokens) const
+{
+	*forwardIndexBytes += tokens.memoryUsage();
+	return std::shared_ptr<TokenList>{new TokenList{std::move(tokens)}, [counter = forwardIndexBytes](TokenList* list) {
+		*counter -= list->memoryUsage();
+		delete list;
+	}};
+}
+
+Indexer::Indexer::PostingList& Indexer::Indexer::postingsFor(std::string_view token)
+{
+	if (auto existing = invertedIndex.find(token); existing != invertedIndex.end())
+	{
+		return existing->second;
+	}
+	auto it = invertedIndex.try_emplace(std::string{token}).first;
+	auto& list = it->second;
+	dictionaryBytes += hashNodeBytes<decltype(invertedIndex)::value_type> + heapBytes(it->first);
+
+	auto spilled = spilledPostings.find(token);
+	if (spilled == spilledPostings.end())
+	{
+		auto term = termDictionary.emplace(token).first;
+		dictionaryBytes += treeNodeBytes<std::string> + heapBytes(*term);
+	}
+	else
+	{
+		auto& segment = postingSegments[spilled->second.segment];
+		auto fileIdsInSegment = segment->postings(spilled->second.extent);
+		list.files.insert(fileIdsInSegment.begin(), fileIdsInSegment.end());
+		postingsBytes += fileIdsInSegment.size() * hashNodeBytes<FileId>;
+
+		segment->releaseList();
+		if (segment->liveLists() == 0)
+		{
+			spilledBytes -= segment->sizeBytes();
+			segment.reset();  // deletes the file
+		}
+		dictionaryBytes -= hashNodeBytes<decltype(spilledPostings)::value_type> + heapBytes(spilled->first);
+		spilledPostings.erase(spilled);
+	}
+	return list;
+}
+
+void Indexer::Indexer::addPosting(std::string_view token, FileId fileId)
+{
+	auto& list = postingsFor(token);
+	if (list.files.insert(fileId).second)
+	{
+		postingsBytes += hashNodeBytes<FileId>;
+	}
+	list.lastUsed = ++useCounter;
+}
+
+void Indexer::Indexer::removePosting(std::string_view token, FileId fileId)
+{
+	auto it = invertedIndex.find(token);
+	if (it == invertedIndex.end() && spilledPostings.contains(token))
+	{
+		postingsFor(token);  // loads it back
+		it = invertedIndex.find(token);
+	}
+	if (it == invertedIndex.end())
+	{
+		return;
+	}
+
+	auto& list = it->second;
+	if (list.files.erase(fileId) > 0)
+	{
+		postingsBytes -= hashNodeBytes<FileId>;
+	}
+	if (list.files.empty())
+	{
+		dictionaryBytes -= hashNodeBytes<decltype(invertedIndex)::value_type> + heapBytes(it->first);
+		if (auto term = termDictionary.find(token); term != termDictionary.end())
+		{
+			dictionaryBytes -= treeNodeBytes<std::string> + heapBytes(*term);
+			termDictionary.erase(term);
+		}
+		invertedIndex.erase(it);
+	}
+}
+
+std::size_t Indexer::Indexer::memoryUsageUnsafe() const
+{
+	return dictionaryBytes + postingsBytes + *forwardIndexBytes
+		+ fileInfo.capacity() * sizeof(fileInfo[0]) + forwardIndex.capacity() * sizeof(forwardIndex[0])
+		+ filePaths.memoryUsage();
+}
+
+void Indexer::Indexer::enforceMemoryBudgetUnsafe()
+{
+	auto usage = memoryUsageUnsafe();
+	if (usage <= memoryBudget)
+	{
+		return;
+	}
+	auto toFree = usage - memoryBudget / 4 * 3;  // headroom, so that the next few updates don't spill again
+
+	std::vector<std::pair<std::uint64_t, std::string const*>> leastRecentlyUsed;
+	leastRecentlyUsed.reserve(invertedIndex.size());
+	for (auto const& [token, list]: invertedIndex)
+	{
+		leastRecentlyUsed.emplace_back(list.lastUsed, &token);
+	}
+	std::sort(leastRecentlyUsed.begin(), leastRecentlyUsed.end());
+
+	constexpr auto keptNodeBytes = hashNodeBytes<decltype(invertedIndex)::value_type> - hashNodeBytes<decltype(spilledPostings)::value_type>;
+	std::vector<FileId> postings;
+	std::vector<std::pair<std::string const*, PostingSegment::Extent>> spilled;
+	std::size_t freed = 0;
+	for (auto [_, token]: leastRecentlyUsed)
+	{
+		if (freed >= toFree)
+		{
+			break;
+		}
+		auto const& files = invertedIndex.at(*token).files;
+		PostingSegment::Extent extent{postings.size(), files.size()};
+		postings.insert(postings.end(), files.begin(), files.end());
+		std::sort(postings.begin() + static_cast<std::ptrdiff_t>(extent.offset), postings.end());
+		spilled.emplace_back(token, extent);
+		freed += files.size() * hashNodeBytes<FileId> + keptNodeBytes;
+	}
+	if (freed < minSpillBytes)
+	{
+		return;
+	}
+
+	auto segmentIndex = postingSegments.size();
+	try
+	{
+		auto file = spillFileUnsafe(std::to_string(segmentIndex) + ".postings");
+		postingSegments.push_back(std::make_unique<PostingSegment>(file, postings, spilled.size()));
+	}
+	catch (std::exception const& e)
+	{
+		std::cerr << e.what() << '\n';
+		std::cerr << "Memory budget disabled\n";
+		memoryBudget = std::numeric_limits<std::size_t>::max();
+		return;
+	}
+	spilledBytes += postingSegments.back()->sizeBytes();
+
+	for (auto const& [token, extent]: spilled)
+	{
+		auto entry = invertedIndex.find(*token);
+		auto tokenBytes = heapBytes(entry->first);
+		postingsBytes -= entry->second.files.size() * hashNodeBytes<FileId>;
+		dictionaryBytes -= hashNodeBytes<decltype(invertedIndex)::value_type> + tokenBytes;
+		dictionaryBytes += hashNodeBytes<decltype(spilledPostings)::value_type> + tokenBytes;
+
+		auto node = invertedIndex.extract(entry);  // `token` points into this very node
+		spilledPostings.insert({std::move(node.key()), SpilledList{segmentIndex, extent}});
+	}
+}
+
+std::filesystem::path Indexer::Indexer::spillFileUnsafe(std::string const& name)
+{
+	if (spillFilePrefix.empty())  // several indexers may share the directory
+	{
+		std::random_device random;
+		std::ostringstream prefix;
+		prefix << "indexer-" << std::hex << random() << random() << "-";
+		spillFilePrefix = prefix.str();
+	}
+	if (spillDirectory.empty())
+	{
+		spillDirectory = std::filesystem::temp_directory_path();
+	}
+	return spillDirectory / (spillFilePrefix + name);
+}
+
+void Indexer::Indexer::loadSpilledPostingsUnsafe()
+{
+	std::vector<std::string> tokens;
+	tokens.reserve(spilledPostings.size());
+	for (auto const& [token, _]: spilledPostings)
+	{
+		tokens.push_back(token);
+	}
+	for (auto const& token: tokens)
+	{
+		postingsFor(token);
+	}
+}
+
+void Indexer::Indexer::compactFileIds()
+{
+	auto pin = lockIndex();
+	compactFileIdsUnsafe();
+}
+
+void Indexer::Indexer::compactFileIdsIfSparseUnsafe()
+{
+	if (fileIds.shouldCompact() && not bulkBuild)
+	{
+		compactFileIdsUnsafe();
+	}
+	else if (filePaths.shouldPlaceFiles())
+	{
+		filePaths.placeFiles();  // new files got their ids in the order they were found, close enough to directory order
+	}
+}
+
+void Indexer::Indexer::compactFileIdsUnsafe()
+{
+	if (bulkBuild)
+	{
+		return;  // the inverter holds the current ids, finishBulkBuild compacts if needed
+	}
+	loadSpilledPostingsUnsafe();  // they hold the old ids
+
+	auto newIds = fileIds.compact(filePaths.directoryOrder());
+	filePaths.remap(newIds);
+
+	std::vector<std::optional<FileInfo>> remappedInfo(fileIds.capacity());
+	std::vector<std::shared_ptr<TokenList>> remappedForwardIndex(fileIds.capacity());
+	for (std::size_t oldId = 0; oldId < newIds.size(); oldId++)
+	{
+		if (auto newId = newIds[oldId]; newId != FileIdAllocator::none)
+		{
+			remappedInfo[newId] = std::move(fileInfo[oldId]);
+			remappedForwardIndex[newId] = std::move(forwardIndex[oldId]);
+		}
+	}
+	fileInfo = std::move(remappedInfo);
+	forwardIndex = std::move(remappedForwardIndex);
+
+	for (auto& [_, postings]: invertedIndex)
+	{
+		std::unordered_set<FileId> remapped;
+		remapped.reserve(postings.files.size());
+		for (auto fileId: postings.files)
+		{
+			remapped.insert(newIds[fileId]);
+		}
+		postings.files = std::move(remapped);
+	}
+
+	enforceMemoryBudgetUnsafe();
+}
+
+void Indexer::Indexer::awaitCreation(std::filesystem::path const& path)
+{
+	try
+	{
+		if (std::filesystem::exists(path))
+		{
+			addPath(path);
+			return;
+		}
+
+		auto existingParent = path.parent_path();
+		while (not std::filesystem::exists(existingParent))
+		{
+			existingParent = existingParent.parent_path();
+		}
+		auto pin = lockIndex();
+		if (not creationWatches.contains(existingParent))
+		{
+			runtime->addRoot(*this, existingParent);
+			runtime->watchDirectory(*this, existingParent);
+			creationWatches.insert({existingParent, {}});
+		}
+		creationWatches.at(existingParent).insert(path.lexically_relative(existingParent));
+	}
+	catch(const std::filesystem::filesystem_error& e)
+	{
+		std::cerr << e.what() << '\n';
+		std::cerr << e.code() << '\n';
+	}
+}
+
+void Indexer::Indexer::handleEvent(FilesystemWatcher::Event const& event)
+{
+	switch (event.type)
+	{
+		case FilesystemWatcher::EventType::Modified:
+			metrics.add(Metrics::Counter::ModifiedEvents);
+			if (IgnoreRules::isIgnoreFile(event.path))
+			{
+				forgetIgnoreRules(event.path.parent_path());
+			}
+			reindexFile(event.path);
+			break;
+
+		case FilesystemWatcher::EventType::Created:
+			metrics.add(Metrics::Counter::CreatedEvents);
+			handleCreated(event.path, event.isDirectory);
+			break;
+
+		case FilesystemWatcher::EventType::Deleted:
+			metrics.add(Metrics::Counter::DeletedEvents);
+			handleDeleted(event.path, event.isDirectory);
+			break;
+
+		case FilesystemWatcher::EventType::Moved:
+			metrics.add(Metrics::Counter::MovedEvents);
+			handleMoved(event.oldPath, event.path, event.isDirectory);
+			break;
+	}
+}
+
+Indexer::Indexer::Scope Indexer::Indexer::scopeOf(std::filesystem::path const& path) const
+{
+	auto pin = lockIndex();
+	Scope scope{.isAdded = addedPaths.contains(path), .parentRecursion = std::nullopt};
+	if (auto parent = indexedDirectories.find(path.parent_path()); parent != indexedDirectories.end())
+	{
+		scope.parentRecursion = parent->second;
+	}
+	return scope;
+}
+
+void Indexer::Indexer::handleCreated(std::filesystem::path const& path, bool isDirectory)
+{
+	auto scope = scopeOf(path);
+	if (not isDirectory)
+	{
+		if (IgnoreRules::isIgnoreFile(path))
+		{
+			forgetIgnoreRules(path.parent_path());
+		}
+		if (scope.isAdded || (scope.parentRecursion && not isIgnored(path, false)))
+		{
+			addFile(path);
+		}
+	}
+	else if (scope.parentRecursion == Recursive::Yes && not isIgnored(path, true))
+	{
+		addDirectory(path, Recursive::Yes);
+	}
+
+	resolveCreationWatches(path);
+}
+
+void Indexer::Indexer::resolveCreationWatches(std::filesystem::path const& path)
+{
+	auto parent = path.parent_path();
+	auto name = path.filename();
+	auto isAwaited = false;
+	std::vector<std::filesystem::path> awaitedBelow;  // still missing parts of their paths
+
+	{
+		auto pin = lockIndex();
+		auto watches = creationWatches.find(parent);
+		if (watches == creationWatches.end())
+		{
+			return;
+		}
+
+		isAwaited = watches->second.erase(name) > 0;
+		std::erase_if(watches->second, [&](auto const& watchedPath)
+		{
+			if (watchedPath.has_parent_path() && head(watchedPath) == name)
+			{
+				awaitedBelow.push_back(parent / watchedPath);
+				return true;
+			}
+			return false;
+		});
+
+		if (watches->second.empty())
+		{
+			runtime->unwatch(*this, parent);
+			creationWatches.erase(watches);
+		}
+	}
+
+	// unlocked, these lock the index themselves
+	if (isAwaited)
+	{
+		addPath(path);
+	}
+	for (auto const& awaitedPath: awaitedBelow)
+	{
+		awaitCreation(awaitedPath);
+	}
+}
+
+void Indexer::Indexer::handleDeleted(std::filesystem::path const& path, bool isDirectory)
+{
+	if (IgnoreRules::isIgnoreFile(path))
+	{
+		forgetIgnoreRules(path.parent_path());
+	}
+
+	auto isFile = false;
+	auto isIndexedDirectory = false;
+	auto isAdded = false;
+	PathSet awaitedBelow;
+	{
+		auto pin = lockIndex();
+		isFile = filePaths.contains(path);
+		isIndexedDirectory = isDirectory && indexedDirectories.contains(path);
+		isAdded = addedPaths.contains(path);
+		if (auto watches = creationWatches.extract(path))
+		{
+			awaitedBelow = std::move(watches.mapped());
+			runtime->unwatch(*this, path);
+		}
+	}
+
+	if (isFile)
+	{
+		removeFile(path);
+	}
+	if (isIndexedDirectory)  // e.g. moved out of the tree, its contents don't get events of their own
+	{
+		removeFilesUnder(path);
+	}
+	if (isAdded)
+	{
+		awaitCreation(path);
+	}
+	for (auto const& watchedPath: awaitedBelow)
+	{
+		awaitCreation(path / watchedPath);
+	}
+}
+
+void Indexer::Indexer::handleMoved(std::filesystem::path const& from, std::filesystem::path const& to, bool isDirectory)
+{
+	auto parent = to.parent_path();
+	auto isKnown = false;
+	{
+		auto pin = lockIndex();
+		isKnown = isDirectory ? indexedDirectories.contains(from) : filePaths.contains(from);
+	}
+	auto scope = scopeOf(to);
+	auto isInScope = scope.isAdded
+		|| (scope.parentRecursion
+			&& (not isDirectory || scope.parentRecursion == Recursive::Yes)
+			&& not isIgnored(to, isDirectory));
+
+	if (not isKnown || not isInScope)
+	{
+		if (isKnown)  // the watches followed it out of the tree
+		{
+			auto pin = lockIndex();
+			auto movedIds = isDirectory ? filePaths.filesUnder(from) : std::vector<FileId>{filePaths.at(from)};
+			for (auto fileId: movedIds)
+			{
+				runtime->unwatch(*this, to / filePaths.path(fileId).lexically_relative(isDirectory ? from : from.parent_path()));
+			}
+			if (isDirectory)
+			{
+				for (auto const& [directory, _]: indexedDirectories)
+				{
+					if (isWithin(directory, from))
+					{
+						runtime->unwatch(*this, directory == from ? to : to / directory.lexically_relative(from));
+					}
+				}
+			}
+		}
+		handleDeleted(from, isDirectory);
+		handleCreated(to, isDirectory);
+		return;
+	}
+
+	if (IgnoreRules::isIgnoreFile(from) || IgnoreRules::isIgnoreFile(to))
+	{
+		forgetIgnoreRules(from.parent_path());
+		forgetIgnoreRules(parent);
+	}
+
+	auto pin = lockIndex();
+	if (changeLog)
+	{
+		changeLog->append({.type = WriteAheadLog::Change::Type::Moved, .path = from.string(), .target = to.string(), .isDirectory = isDirectory});
+	}
+	std::vector<FileId> displacedIds;
+	if (isDirectory)
+	{
+		displacedIds = filePaths.moveDirectory(from, to);
+
+		std::vector<std::pair<std::filesystem::path, Recursive>> movedDirectories;
+		for (auto const& [directory, recursive]: indexedDirectories)
+		{
+			if (isWithin(directory, from))
+			{
+				movedDirectories.emplace_back(directory == from ? to : to / directory.lexically_relative(from), recursive);
+			}
+		}
+		std::erase_if(indexedDirectories, [&](auto const& entry) { return isWithin(entry.first, from); });
+		indexedDirectories.insert(movedDirectories.begin(), movedDirectories.end());
+	}
+	else if (auto displacedId = filePaths.moveFile(from, to))
+	{
+		displacedIds.push_back(*displacedId);
+	}
+
+	for (auto fileId: displacedIds)  // overwritten by the move
+	{
+		removeFileUnsafe(fileId);
+	}
+	compactFileIdsIfSparseUnsafe();
+	metrics.add(Metrics::Counter::MovesInPlace);
+	pin.unlock();
+
+	if (isDirectory)  // cached rules are tied to the old location
+	{
+		forgetIgnoreRules(from);
+		forgetIgnoreRules(to);
 	}
+	resolveCreationWatches(to);
 }
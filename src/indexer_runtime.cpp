@@ -0,0 +1,225 @@
+#include "indexer/indexer_runtime.h"
+
+#include <cassert>
+
+#include "indexer/indexer.h"
+
+namespace
+{
+thread_local Indexer::IndexerRuntime const* eventRuntime = nullptr;  // whose events this thread handles
+}
+
+Indexer::IndexerRuntime::IndexerRuntime(unsigned workerCount)
+{
+	watcherThread = std::thread{&IndexerRuntime::watchFilesystem, this};
+	for (unsigned i = 0; i < std::max(workerCount, 1u); i++)
+	{
+		workers.emplace_back(&IndexerRuntime::work, this);
+	}
+}
+
+Indexer::IndexerRuntime::~IndexerRuntime()
+{
+	doStop = true;
+	watcher.requestStop();
+	watcherThread.join();
+	{
+		std::unique_lock pin{mutex};
+		assert(clients.empty());
+		isStopping = true;
+		workSync.notify_all();
+	}
+	for (auto& worker: workers)
+	{
+		worker.join();
+	}
+}
+
+void Indexer::IndexerRuntime::attach(Indexer& indexer)
+{
+	std::unique_lock pin{mutex};
+	clients.push_back(std::make_unique<Client>());
+	clients.back()->indexer = &indexer;
+}
+
+void Indexer::IndexerRuntime::stopEvents(Indexer& indexer)
+{
+	std::unique_lock pin{mutex};
+	auto& client = clientFor(indexer);
+	client.isReceivingEvents = false;
+	client.events.clear();
+	client.eventSync.notify_one();
+	if (client.eventThread.joinable())
+	{
+		auto eventThread = std::move(client.eventThread);
+		pin.unlock();  // it finishes the event it's handling, which may need the mutex
+		eventThread.join();
+		pin.lock();
+	}
+
+	for (auto it = watchOwners.begin(); it != watchOwners.end(); )
+	{
+		it->second.erase(&indexer);
+		if (it->second.empty())
+		{
+			watcher.removePath(it->first);
+			it = watchOwners.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void Indexer::IndexerRuntime::detach(Indexer& indexer)
+{
+	std::unique_lock pin{mutex};
+	auto& client = clientFor(indexer);
+	assert(client.queuedFiles == 0);  // its pipeline was stopped
+	idleSync.wait(pin, [&client]() { return client.activeThreads == 0; });
+	std::erase_if(clients, [&indexer](auto const& c) { return c->indexer == &indexer; });
+}
+
+void Indexer::IndexerRuntime::addRoot(Indexer& indexer, std::filesystem::path const& root)
+{
+	std::unique_lock pin{mutex};
+	auto& roots = clientFor(indexer).roots;
+	if (std::find(roots.begin(), roots.end(), root) == roots.end())
+	{
+		roots.push_back(root);
+	}
+}
+
+void Indexer::IndexerRuntime::watchFile(Indexer& indexer, std::filesystem::path const& path)
+{
+	std::unique_lock pin{mutex};
+	watchOwners[path].insert(&indexer);
+	watcher.addFile(path);
+}
+
+void Indexer::IndexerRuntime::watchDirectory(Indexer& indexer, std::filesystem::path const& path)
+{
+	std::unique_lock pin{mutex};
+	watchOwners[path].insert(&indexer);
+	watcher.addDirectory(path);
+}
+
+void Indexer::IndexerRuntime::unwatch(Indexer& indexer, std::filesystem::path const& path)
+{
+	std::unique_lock pin{mutex};
+	auto owners = watchOwners.find(path);
+	if (owners == watchOwners.end())  // e.g. the watch followed a move, we know it by its old path
+	{
+		watcher.removePath(path);
+		return;
+	}
+	owners->second.erase(&indexer);
+	if (owners->second.empty())
+	{
+		watcher.removePath(path);
+		watchOwners.erase(owners);
+	}
+}
+
+void Indexer::IndexerRuntime::queueFile(Indexer& indexer)
+{
+	std::unique_lock pin{mutex};
+	clientFor(indexer).queuedFiles++;
+	queuedFiles++;
+	workSync.notify_one();
+}
+
+Indexer::IndexerRuntime::Client& Indexer::IndexerRuntime::clientFor(Indexer const& indexer)
+{
+	auto client = std::find_if(clients.begin(), clients.end(), [&indexer](auto const& c) { return c->indexer == &indexer; });
+	assert(client != clients.end());
+	return **client;
+}
+
+bool Indexer::IndexerRuntime::isEventThread() const
+{
+	return eventRuntime == this;
+}
+
+// Only queues the events, handling them is up to each indexer's own thread, see handleEvents()
+void Indexer::IndexerRuntime::watchFilesystem()
+{
+	while (not doStop)
+	{
+		auto events = watcher.pollEvents();
+		std::unique_lock pin{mutex};
+		for (auto& event: events)
+		{
+			auto isUnder = [&event](std::filesystem::path const& root)
+			{
+				return isWithin(event.path, root)
+					|| (event.type == FilesystemWatcher::EventType::Moved && isWithin(event.oldPath, root));
+			};
+			for (auto const& client: clients)
+			{
+				if (client->isReceivingEvents && std::any_of(client->roots.begin(), client->roots.end(), isUnder))
+				{
+					client->events.push_back(event);
+					if (not client->eventThread.joinable())
+					{
+						client->eventThread = std::thread{&IndexerRuntime::handleEvents, this, std::ref(*client)};
+					}
+					client->eventSync.notify_one();
+				}
+			}
+		}
+	}
+}
+
+void Indexer::IndexerRuntime::handleEvents(Client& client)
+{
+	eventRuntime = this;
+	std::unique_lock pin{mutex};
+	while (true)
+	{
+		client.eventSync.wait(pin, [&client]() { return not client.isReceivingEvents || not client.events.empty(); });
+		if (not client.isReceivingEvents)
+		{
+			return;
+		}
+		auto event = std::move(client.events.front());
+		client.events.pop_front();
+
+		pin.unlock();  // handling an event may add or remove watches
+		client.indexer->handleEvent(event);
+		pin.lock();
+	}
+}
+
+void Indexer::IndexerRuntime::work()
+{
+	std::unique_lock pin{mutex};
+	while (true)
+	{
+		workSync.wait(pin, [this]() { return isStopping || queuedFiles > 0; });
+		if (queuedFiles == 0)
+		{
+			return;  // stopping
+		}
+
+		// one file from each indexer in turn
+		auto index = nextClient % clients.size();
+		while (clients[index]->queuedFiles == 0)  // some client has one
+		{
+			index = (index + 1) % clients.size();
+		}
+		nextClient = index + 1;
+		auto& client = *clients[index];
+		client.queuedFiles--;
+		queuedFiles--;
+		client.activeThreads++;
+
+		pin.unlock();
+		client.indexer->tokenizeNext();
+		pin.lock();
+
+		client.activeThreads--;
+		idleSync.notify_all();
+	}
+}
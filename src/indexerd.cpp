@@ -0,0 +1,59 @@
+#include <csignal>
+#include <exception>
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+#include "indexer/indexer.h"
+#include "indexer/server.h"
+
+// indexerd <socket> [[-r] <path>]...: serves one index to every client of the socket until SIGINT or SIGTERM
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: " << argv[0] << " <socket> [[-r] <path>]...\n";
+		return 1;
+	}
+
+	// before any thread starts, so that they all leave the signals to sigwait()
+	sigset_t stopSignals;
+	sigemptyset(&stopSignals);
+	sigaddset(&stopSignals, SIGINT);
+	sigaddset(&stopSignals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+
+	try
+	{
+		Indexer::Indexer indexer;
+		Indexer::Server server{indexer, argv[1]};
+		std::thread serving{[&server]() { server.run(); }};
+
+		// searchable as they are merged, stopping cancels what's left
+		std::vector<Indexer::IndexingTask> adds;
+		auto recursive = Indexer::Recursive::No;
+		for (int i = 2; i < argc; i++)
+		{
+			if (std::string_view{argv[i]} == "-r")
+			{
+				recursive = Indexer::Recursive::Yes;
+				continue;
+			}
+			adds.push_back(indexer.addPathAsync(argv[i], recursive, {}, Indexer::Priority::Normal));
+			recursive = Indexer::Recursive::No;
+		}
+
+		int signal;
+		sigwait(&stopSignals, &signal);
+		server.requestStop();
+		serving.join();
+	}
+	catch (std::exception const& e)
+	{
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+}
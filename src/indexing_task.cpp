@@ -0,0 +1,21 @@
+#include "indexer/indexing_task.h"
+
+Indexer::IndexingProgress Indexer::IndexingTask::progress() const
+{
+	IndexingProgress progress;
+	{
+		std::unique_lock pin{state->mutex};
+		progress.isDone = state->isDone;
+	}
+	progress.filesDiscovered = state->filesDiscovered;
+	progress.filesIndexed = state->filesIndexed;
+	progress.filesSkipped = state->filesSkipped;
+	progress.bytesRead = state->bytesRead;
+	return progress;
+}
+
+void Indexer::IndexingTask::wait() const
+{
+	std::unique_lock pin{state->mutex};
+	state->doneSync.wait(pin, [this](){ return state->isDone; });
+}
@@ -1,8 +1,10 @@
 #include "indexer/filesystem_watcher.h"
 
 #include <cassert>
+#include <mutex>
 #include <stdexcept>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <poll.h>
 #include <sys/inotify.h>
@@ -48,17 +50,20 @@ public:
 	void addFile(std::filesystem::path const& path)
 	{
 		auto watchDescriptor = inotify_add_watch(inotifyFileDescriptor, path.c_str(), IN_MODIFY | IN_MOVE_SELF);
+		std::scoped_lock lock{descriptorMutex};
 		registerWatchDescriptor(watchDescriptor, path);
 	}
 
 	void addDirectory(std::filesystem::path const& path)
 	{
-		auto watchDescriptor = inotify_add_watch(inotifyFileDescriptor, path.c_str(), IN_CREATE | IN_MOVED_TO | IN_MOVE_SELF);
+		auto watchDescriptor = inotify_add_watch(inotifyFileDescriptor, path.c_str(), IN_CREATE | IN_MOVED_FROM | IN_MOVED_TO | IN_MOVE_SELF);
+		std::scoped_lock lock{descriptorMutex};
 		registerWatchDescriptor(watchDescriptor, path);
 	}
 
 	void removePath(std::filesystem::path const& path)
 	{
+		std::scoped_lock lock{descriptorMutex};
 		if (pathToDescriptor.contains(path))
 		{
 			auto watchDescriptor = pathToDescriptor.at(path);
@@ -68,11 +73,15 @@ public:
 
 	std::vector<FilesystemWatcher::Event> pollEvents()
 	{
+		std::vector<FilesystemWatcher::Event> events;
+
 		pollfd pollDescriptor{inotifyFileDescriptor, POLLIN, 0};
 		poll(&pollDescriptor, 1, 5);
 		if (not (pollDescriptor.revents & POLLIN))  // no data available to read
 		{
-			return {};  // so no events generated
+			std::scoped_lock lock{descriptorMutex};
+			flushPendingMoves(events);
+			return events;  // so no new events generated
 		}
 
 		std::size_t buffSize = 0;
@@ -100,8 +109,7 @@ public:
 
 		auto* end = buffer.data() + bytesRead;
 
-		std::vector<FilesystemWatcher::Event> events;
-
+		std::scoped_lock lock{descriptorMutex};
 		for (auto p = buffer.data(); p < end; )
 		{
 			auto* event = reinterpret_cast<inotify_event const*>(p);
@@ -121,12 +129,33 @@ public:
 				events.emplace_back(FilesystemWatcher::EventType::Modified, path, false);
 			}
 
-			// created
-			if (event->mask & (IN_CREATE | IN_MOVED_TO))
+			// moved, the destination half is paired up below
+			if (event->mask & IN_MOVED_FROM)
+			{
+				pendingMoves.insert({event->cookie, PendingMove{path / event->name, (event->mask & IN_ISDIR) != 0, false}});
+			}
+
+			// moved within the watched tree, or created
+			if (event->mask & IN_MOVED_TO && pendingMoves.contains(event->cookie))
+			{
+				auto source = std::move(pendingMoves.at(event->cookie));
+				pendingMoves.erase(event->cookie);
+				auto destination = path / event->name;
+				relocate(source.path, destination, source.isDirectory);
+				events.emplace_back(FilesystemWatcher::EventType::Moved, destination, source.isDirectory, source.path);
+			}
+			else if (event->mask & (IN_CREATE | IN_MOVED_TO))
 			{
 				events.emplace_back(FilesystemWatcher::EventType::Created, path / event->name, event->mask & IN_ISDIR);
 			}
 
+			// the other side of an already reported move
+			if (event->mask & IN_MOVE_SELF && relocatedDescriptors.contains(event->wd))
+			{
+				relocatedDescriptors.erase(event->wd);
+				continue;
+			}
+
 			// deleted
 			if (event->mask & (IN_IGNORED | IN_MOVE_SELF))
 			{
@@ -135,15 +164,88 @@ public:
 			}
 		}
 
+		flushPendingMoves(events);
 		return events;
 	}
 
 private:
 	int inotifyFileDescriptor;
 
+	// watches are added from indexing threads while the watcher thread polls
+	std::mutex descriptorMutex;
+
 	std::unordered_map<int, std::filesystem::path> descriptorToPath;
 	std::unordered_map<std::filesystem::path, int, PathHasher> pathToDescriptor;
 
+	struct PendingMove
+	{
+		std::filesystem::path path;
+		bool isDirectory;
+		bool isStale;  // survived a whole poll without its IN_MOVED_TO
+	};
+	std::unordered_map<std::uint32_t, PendingMove> pendingMoves;  // by inotify cookie
+
+	// watches that follow their inode to the new location, their IN_MOVE_SELF is already accounted for
+	std::unordered_set<int> relocatedDescriptors;
+
+	// the IN_MOVED_TO half may come in the next read, give up on it after that
+	void flushPendingMoves(std::vector<FilesystemWatcher::Event>& events)
+	{
+		for (auto it = pendingMoves.begin(); it != pendingMoves.end(); )
+		{
+			if (it->second.isStale)  // moved out of the watched tree
+			{
+				events.emplace_back(FilesystemWatcher::EventType::Deleted, it->second.path, it->second.isDirectory);
+				it = pendingMoves.erase(it);
+			}
+			else
+			{
+				it->second.isStale = true;
+				++it;
+			}
+		}
+	}
+
+	void relocate(std::filesystem::path const& from, std::filesystem::path const& to, bool isDirectory)
+	{
+		// whatever was watched at the destination has just been replaced
+		if (pathToDescriptor.contains(to))
+		{
+			auto replacedDescriptor = pathToDescriptor.at(to);
+			unregisterWatchDescriptor(replacedDescriptor);
+			inotify_rm_watch(inotifyFileDescriptor, replacedDescriptor);
+		}
+
+		std::vector<std::pair<int, std::filesystem::path>> relocated;
+		if (not isDirectory)
+		{
+			if (pathToDescriptor.contains(from))
+			{
+				relocated.emplace_back(pathToDescriptor.at(from), to);
+			}
+		}
+		else
+		{
+			for (auto const& [watchDescriptor, path]: descriptorToPath)
+			{
+				if (isWithin(path, from))
+				{
+					relocated.emplace_back(watchDescriptor, path == from ? to : to / path.lexically_relative(from));
+				}
+			}
+		}
+
+		for (auto const& [watchDescriptor, path]: relocated)
+		{
+			unregisterWatchDescriptor(watchDescriptor);
+			registerWatchDescriptor(watchDescriptor, path);
+		}
+		if (pathToDescriptor.contains(to))
+		{
+			relocatedDescriptors.insert(pathToDescriptor.at(to));
+		}
+	}
+
 	void registerWatchDescriptor(int watchDescriptor, std::filesystem::path const& path)
 	{
 		descriptorToPath.insert({watchDescriptor, path});
@@ -152,7 +254,7 @@ private:
 
 	void unregisterWatchDescriptor(int watchDescriptor)
 	{
-		auto& path = descriptorToPath.at(watchDescriptor);
+		auto path = descriptorToPath.at(watchDescriptor);
 		descriptorToPath.erase(watchDescriptor);
 		pathToDescriptor.erase(path);
 	}
@@ -0,0 +1,376 @@
+#include "indexer/file_reader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Indexer
+{
+// io_uring through the raw system calls, so that liburing isn't needed to build
+class FileReaderImpl
+{
+public:
+	FileReaderImpl(unsigned queueDepth)
+	{
+		io_uring_params params{};
+		ringDescriptor = static_cast<int>(syscall(__NR_io_uring_setup, queueDepth, &params));
+		if (ringDescriptor < 0)
+		{
+			return;  // an old kernel, or io_uring disabled by seccomp or sysctl
+		}
+
+		sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		bool isSingleMapping = params.features & IORING_FEAT_SINGLE_MMAP;
+		if (isSingleMapping)
+		{
+			sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+		}
+		sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringDescriptor, IORING_OFF_SQ_RING);
+		cqRing = isSingleMapping ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringDescriptor, IORING_OFF_CQ_RING);
+		sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+		auto sqesMapping = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringDescriptor, IORING_OFF_SQES);
+		if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqesMapping == MAP_FAILED)
+		{
+			if (sqesMapping != MAP_FAILED)
+			{
+				munmap(sqesMapping, sqesSize);
+			}
+			tearDown();
+			return;
+		}
+
+		auto sq = static_cast<char*>(sqRing);
+		sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+		sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+		sqes = static_cast<io_uring_sqe*>(sqesMapping);
+
+		auto cq = static_cast<char*>(cqRing);
+		cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+		entries = params.sq_entries;
+	}
+
+	FileReaderImpl(FileReaderImpl const&) = delete;
+	FileReaderImpl& operator=(FileReaderImpl const&) = delete;
+
+	~FileReaderImpl()
+	{
+		if (sqes)
+		{
+			munmap(sqes, sqesSize);
+		}
+		tearDown();
+	}
+
+	bool isAvailable() const { return ringDescriptor >= 0 && not isFailed; }
+
+	std::vector<std::optional<std::string>> read(std::span<std::filesystem::path const> paths, std::uintmax_t maxSize)
+	{
+		std::vector<std::optional<std::string>> contents(paths.size());
+		if (not isAvailable())
+		{
+			return contents;
+		}
+
+		std::unique_lock pin{mutex};
+		if (isFailed)
+		{
+			return contents;
+		}
+		std::vector<Job> jobs(paths.size());
+		std::deque<io_uring_sqe> queued;  // waiting for room in the ring
+		for (std::size_t i = 0; i < paths.size(); i++)
+		{
+			// the size is needed to size the buffer, the stat doesn't have to wait for the open
+			auto& open = queued.emplace_back(makeEntry(IORING_OP_OPENAT, i, Operation::Open));
+			open.fd = AT_FDCWD;
+			open.addr = reinterpret_cast<std::uintptr_t>(paths[i].c_str());
+			open.open_flags = O_RDONLY | O_CLOEXEC;
+
+			auto& stat = queued.emplace_back(makeEntry(IORING_OP_STATX, i, Operation::Stat));
+			stat.fd = AT_FDCWD;
+			stat.addr = reinterpret_cast<std::uintptr_t>(paths[i].c_str());
+			stat.len = STATX_SIZE;
+			stat.off = reinterpret_cast<std::uintptr_t>(&jobs[i].status);
+		}
+
+		auto queueRead = [&](std::size_t i)
+		{
+			auto& job = jobs[i];
+			auto& read = queued.emplace_back(makeEntry(IORING_OP_READ, i, Operation::Read));
+			read.fd = job.descriptor;
+			read.addr = reinterpret_cast<std::uintptr_t>(job.contents.data() + job.done);
+			read.len = static_cast<unsigned>(std::min<std::size_t>(job.contents.size() - job.done, maxReadLength));
+			read.off = job.done;
+		};
+		auto queueClose = [&](std::size_t i)
+		{
+			auto& close = queued.emplace_back(makeEntry(IORING_OP_CLOSE, i, Operation::Close));
+			close.fd = jobs[i].descriptor;
+		};
+		auto finish = [&](std::size_t i)
+		{
+			auto& job = jobs[i];
+			if (not job.failed)
+			{
+				contents[i] = std::move(job.contents);
+			}
+		};
+
+		unsigned inFlight = 0;  // including those in the ring the kernel hasn't picked up yet
+		unsigned unsubmitted = 0;
+		while (not queued.empty() || inFlight > 0)
+		{
+			while (not queued.empty() && inFlight < entries)
+			{
+				push(queued.front());
+				queued.pop_front();
+				inFlight++;
+				unsubmitted++;
+			}
+
+			auto submitted = syscall(__NR_io_uring_enter, ringDescriptor, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+			if (submitted < 0)
+			{
+				if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+				{
+					continue;
+				}
+				auto error = errno;
+				abandon(jobs, inFlight);
+				throw std::system_error{error, std::system_category(), "io_uring_enter()"};
+			}
+			unsubmitted -= static_cast<unsigned>(submitted);
+
+			auto head = std::atomic_ref{*cqHead}.load(std::memory_order_relaxed);
+			auto tail = std::atomic_ref{*cqTail}.load(std::memory_order_acquire);
+			for (; head != tail; head++)
+			{
+				auto const& completion = cqes[head & cqMask];
+				auto i = completion.user_data / operationCount;
+				auto operation = static_cast<Operation>(completion.user_data % operationCount);
+				auto result = completion.res;
+				auto& job = jobs[i];
+				inFlight--;
+
+				switch (operation)
+				{
+				case Operation::Open:
+				case Operation::Stat:
+					if (result < 0 || (operation == Operation::Stat && job.status.stx_size > maxSize))
+					{
+						job.failed = true;
+					}
+					else if (operation == Operation::Open)
+					{
+						job.descriptor = result;
+					}
+					if (++job.setupsDone < 2)
+					{
+						break;
+					}
+					if (job.failed)
+					{
+						if (job.descriptor >= 0)
+						{
+							queueClose(i);
+						}
+						break;
+					}
+					job.contents.resize(job.status.stx_size);
+					if (job.contents.empty())
+					{
+						queueClose(i);
+					}
+					else
+					{
+						queueRead(i);
+					}
+					break;
+
+				case Operation::Read:
+					if (result < 0)
+					{
+						job.failed = true;
+						queueClose(i);
+						break;
+					}
+					job.done += static_cast<std::size_t>(result);
+					if (result == 0)  // the file shrunk in the meantime
+					{
+						job.contents.resize(job.done);
+					}
+					if (job.done < job.contents.size())
+					{
+						queueRead(i);
+					}
+					else
+					{
+						queueClose(i);
+					}
+					break;
+
+				case Operation::Close:
+					job.descriptor = -1;
+					finish(i);
+					break;
+				}
+			}
+			std::atomic_ref{*cqHead}.store(head, std::memory_order_release);
+		}
+		return contents;
+	}
+
+private:
+	enum class Operation: std::uint64_t
+	{
+		Open, Stat, Read, Close
+	};
+	static constexpr std::uint64_t operationCount = 4;
+	static constexpr std::size_t maxReadLength = 1 << 30;
+
+	struct Job
+	{
+		int descriptor{-1};
+		int setupsDone{0};  // the open and the stat
+		bool failed{false};
+		struct statx status{};
+		std::string contents;
+		std::size_t done{0};
+	};
+
+	static io_uring_sqe makeEntry(std::uint8_t opcode, std::size_t job, Operation operation)
+	{
+		io_uring_sqe entry{};
+		entry.opcode = opcode;
+		entry.user_data = job * operationCount + static_cast<std::uint64_t>(operation);
+		return entry;
+	}
+
+	void push(io_uring_sqe const& entry)
+	{
+		auto tail = std::atomic_ref{*sqTail}.load(std::memory_order_relaxed);  // only we write it
+		auto index = tail & sqMask;
+		sqes[index] = entry;
+		sqArray[index] = index;
+		std::atomic_ref{*sqTail}.store(tail + 1, std::memory_order_release);
+	}
+
+	// After a failed io_uring_enter(), the kernel may still write into the jobs of what it took from the ring.
+	// Take back what it didn't take, wait for the rest, and leave reading to the callers from now on
+	void abandon(std::vector<Job>& jobs, unsigned inFlight)
+	{
+		auto head = std::atomic_ref{*sqHead}.load(std::memory_order_acquire);
+		auto tail = std::atomic_ref{*sqTail}.load(std::memory_order_relaxed);
+		std::atomic_ref{*sqTail}.store(head, std::memory_order_release);  // only read by the kernel when we enter it
+		inFlight -= tail - head;
+
+		while (inFlight > 0)
+		{
+			if (syscall(__NR_io_uring_enter, ringDescriptor, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds{1});  // completions are also posted on the way out of other system calls
+			}
+
+			auto cqHeadValue = std::atomic_ref{*cqHead}.load(std::memory_order_relaxed);
+			auto cqTailValue = std::atomic_ref{*cqTail}.load(std::memory_order_acquire);
+			for (; cqHeadValue != cqTailValue; cqHeadValue++, inFlight--)
+			{
+				auto const& completion = cqes[cqHeadValue & cqMask];
+				auto& job = jobs[completion.user_data / operationCount];
+				auto operation = static_cast<Operation>(completion.user_data % operationCount);
+				if (operation == Operation::Open && completion.res >= 0)
+				{
+					job.descriptor = completion.res;
+				}
+				else if (operation == Operation::Close)
+				{
+					job.descriptor = -1;
+				}
+			}
+			std::atomic_ref{*cqHead}.store(cqHeadValue, std::memory_order_release);
+		}
+
+		for (auto const& job: jobs)
+		{
+			if (job.descriptor >= 0)
+			{
+				close(job.descriptor);
+			}
+		}
+		isFailed = true;
+	}
+
+	void tearDown()
+	{
+		if (cqRing != MAP_FAILED && cqRing != sqRing)
+		{
+			munmap(cqRing, cqRingSize);
+		}
+		if (sqRing != MAP_FAILED)
+		{
+			munmap(sqRing, sqRingSize);
+		}
+		sqRing = cqRing = MAP_FAILED;
+		if (ringDescriptor >= 0)
+		{
+			close(ringDescriptor);
+		}
+		ringDescriptor = -1;
+	}
+
+	std::mutex mutex;
+	int ringDescriptor{-1};
+	unsigned entries{0};
+	std::atomic<bool> isFailed{false};  // the ring is kept until destruction, but not used again
+
+	void* sqRing{MAP_FAILED};
+	std::size_t sqRingSize{0};
+	unsigned* sqHead{nullptr};
+	unsigned* sqTail{nullptr};
+	unsigned sqMask{0};
+	unsigned* sqArray{nullptr};
+	io_uring_sqe* sqes{nullptr};
+	std::size_t sqesSize{0};
+
+	void* cqRing{MAP_FAILED};
+	std::size_t cqRingSize{0};
+	unsigned* cqHead{nullptr};
+	unsigned* cqTail{nullptr};
+	unsigned cqMask{0};
+	io_uring_cqe* cqes{nullptr};
+};
+
+FileReader::FileReader(unsigned queueDepth): pImpl{std::make_unique<FileReaderImpl>(queueDepth)} {}
+FileReader::FileReader(FileReader&&) = default;
+FileReader& FileReader::operator=(FileReader&&) = default;
+FileReader::~FileReader() = default;
+
+bool FileReader::isAvailable() const
+{
+	return pImpl->isAvailable();
+}
+
+std::vector<std::optional<std::string>> FileReader::read(std::span<std::filesystem::path const> paths, std::uintmax_t maxSize)
+{
+	return pImpl->read(paths, maxSize);
+}
+}
@@ -0,0 +1,70 @@
+#include "indexer/levenshtein_automaton.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+Indexer::LevenshteinAutomaton::LevenshteinAutomaton(std::string_view word_, unsigned maxDistance_)
+	: word{word_}
+	, maxDistance{maxDistance_}
+{
+	if (maxDistance > maxSupportedDistance)
+	{
+		throw std::invalid_argument{"Edit distance " + std::to_string(maxDistance) + " is beyond the supported "
+			+ std::to_string(maxSupportedDistance)};
+	}
+}
+
+Indexer::LevenshteinAutomaton::State Indexer::LevenshteinAutomaton::start() const
+{
+	State state;
+	for (std::uint32_t i = 0; i <= std::min<std::size_t>(maxDistance, word.size()); i++)
+	{
+		state.entries[state.size++] = {i, i};  // deleting the first i bytes of the word
+	}
+	return state;
+}
+
+Indexer::LevenshteinAutomaton::State Indexer::LevenshteinAutomaton::step(State const& state, char c) const
+{
+	State next;
+	if (state.size > 0 && state.entries[0].position == 0 && state.entries[0].distance < maxDistance)
+	{
+		next.entries[next.size++] = {0, state.entries[0].distance + 1};  // inserting c
+	}
+	for (std::uint32_t i = 0; i < state.size; i++)
+	{
+		auto [position, distance] = state.entries[i];
+		if (position == word.size())
+		{
+			break;
+		}
+		auto value = distance + (word[position] == c ? 0 : 1);  // matching or substituting
+		if (next.size > 0 && next.entries[next.size - 1].position == position)
+		{
+			value = std::min(value, next.entries[next.size - 1].distance + 1);  // deleting word[position]
+		}
+		if (i + 1 < state.size && state.entries[i + 1].position == position + 1)
+		{
+			value = std::min(value, state.entries[i + 1].distance + 1);  // inserting c
+		}
+		if (value <= maxDistance)
+		{
+			next.entries[next.size++] = {position + 1, value};
+		}
+	}
+	return next;
+}
+
+bool Indexer::LevenshteinAutomaton::matches(std::string_view text) const
+{
+	auto state = start();
+	for (auto c: text)
+	{
+		state = step(state, c);
+		if (not canMatch(state))
+		{
+			return false;
+		}
+	}
+	return isMatch(state);
+}
@@ -0,0 +1,333 @@
+#include "indexer/metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+
+namespace
+{
+constexpr auto counterCount = static_cast<std::size_t>(Indexer::Metrics::Counter::Count);
+constexpr auto timerCount = static_cast<std::size_t>(Indexer::Metrics::Timer::Count);
+
+// past this, spans are dropped rather than growing without bound
+constexpr std::size_t maxTraceEvents = 1 << 20;
+
+// relaxed everywhere: each shard has a single writer, readers only need eventually consistent totals
+struct AtomicHistogram
+{
+	void record(std::uint64_t ns)
+	{
+		auto bucket = std::min<std::uint64_t>(std::bit_width(ns), Indexer::Histogram::bucketCount - 1);
+		buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+		count.fetch_add(1, std::memory_order_relaxed);
+		total.fetch_add(ns, std::memory_order_relaxed);
+		if (ns > max.load(std::memory_order_relaxed))
+		{
+			max.store(ns, std::memory_order_relaxed);
+		}
+	}
+
+	void addTo(Indexer::Histogram& histogram) const
+	{
+		for (std::size_t i = 0; i < buckets.size(); i++)
+		{
+			histogram.buckets[i] += buckets[i].load(std::memory_order_relaxed);
+		}
+		histogram.count += count.load(std::memory_order_relaxed);
+		histogram.total += total.load(std::memory_order_relaxed);
+		histogram.max = std::max(histogram.max, max.load(std::memory_order_relaxed));
+	}
+
+	std::array<std::atomic<std::uint64_t>, Indexer::Histogram::bucketCount> buckets{};
+	std::atomic<std::uint64_t> count{0};
+	std::atomic<std::uint64_t> total{0};
+	std::atomic<std::uint64_t> max{0};
+};
+
+struct TraceEvent
+{
+	char const* name;
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::duration duration;
+};
+
+double seconds(std::chrono::steady_clock::duration duration)
+{
+	return std::chrono::duration<double>(duration).count();
+}
+
+double mebibytes(std::size_t bytes)
+{
+	return static_cast<double>(bytes) / (1 << 20);
+}
+
+double microseconds(std::chrono::steady_clock::duration duration)
+{
+	return std::chrono::duration<double, std::micro>(duration).count();
+}
+}
+
+struct Indexer::Metrics::Shard
+{
+	std::size_t index;
+	std::array<std::atomic<std::uint64_t>, counterCount> counters{};
+	std::array<AtomicHistogram, timerCount> timers{};
+
+	std::mutex traceMutex;  // only contended while a trace is being written out
+	std::vector<TraceEvent> traceEvents;
+};
+
+// Pool workers and addPathAsync threads come and go, so shards are handed back when they exit
+// and reused rather than piling up; their totals carry over to the next owner.
+struct Indexer::Metrics::Pool
+{
+	Shard* acquire()
+	{
+		std::unique_lock pin{mutex};
+		if (not freeShards.empty())
+		{
+			auto shard = freeShards.back();
+			freeShards.pop_back();
+			return shard;
+		}
+		shards.push_back(std::make_unique<Shard>());
+		shards.back()->index = shards.size() - 1;
+		return shards.back().get();
+	}
+
+	void release(Shard* shard)
+	{
+		std::unique_lock pin{mutex};
+		freeShards.push_back(shard);
+	}
+
+	std::mutex mutex;
+	std::vector<std::unique_ptr<Shard>> shards;
+	std::vector<Shard*> freeShards;
+	std::atomic<std::size_t> traceEventCount{0};
+};
+
+struct Indexer::Metrics::Leases
+{
+	~Leases()
+	{
+		for (auto& [pool, shard]: held)
+		{
+			pool->release(shard);
+		}
+	}
+
+	std::vector<std::pair<std::shared_ptr<Pool>, Shard*>> held;
+};
+
+thread_local Indexer::Metrics::Leases Indexer::Metrics::leases;
+
+Indexer::Metrics::Metrics()
+	: pool{std::make_shared<Pool>()}
+	, createdAt{std::chrono::steady_clock::now()}
+{
+}
+
+Indexer::Metrics::Shard& Indexer::Metrics::localShard() const
+{
+	for (auto& [leasedPool, shard]: leases.held)
+	{
+		if (leasedPool == pool)
+		{
+			return *shard;
+		}
+	}
+
+	// long-lived threads would otherwise keep the pools of destroyed Metrics alive
+	std::erase_if(leases.held, [](auto const& lease) { return lease.first.use_count() == 1; });
+
+	auto shard = pool->acquire();
+	leases.held.emplace_back(pool, shard);
+	return *shard;
+}
+
+void Indexer::Metrics::add(Counter counter, std::uint64_t value) const
+{
+	localShard().counters[static_cast<std::size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+}
+
+void Indexer::Metrics::record(Timer timer, std::chrono::steady_clock::duration duration) const
+{
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+	localShard().timers[static_cast<std::size_t>(timer)].record(static_cast<std::uint64_t>(std::max<std::int64_t>(ns, 0)));
+}
+
+void Indexer::Metrics::setTracing(bool enabled)
+{
+	if (enabled && not isTracing())
+	{
+		std::unique_lock pin{pool->mutex};
+		for (auto& shard: pool->shards)
+		{
+			std::unique_lock shardPin{shard->traceMutex};
+			shard->traceEvents.clear();
+		}
+		pool->traceEventCount = 0;
+	}
+	tracing.store(enabled, std::memory_order_relaxed);
+}
+
+void Indexer::Metrics::addSpan(char const* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) const
+{
+	if (pool->traceEventCount.fetch_add(1, std::memory_order_relaxed) >= maxTraceEvents)
+	{
+		return;
+	}
+	auto& shard = localShard();
+	std::unique_lock pin{shard.traceMutex};
+	shard.traceEvents.push_back({name, start, end - start});
+}
+
+void Indexer::Metrics::writeTrace(std::ostream& out) const
+{
+	auto precision = out.precision(3);
+	auto flags = out.setf(std::ios::fixed, std::ios::floatfield);
+
+	out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	auto first = true;
+	std::unique_lock pin{pool->mutex};
+	for (auto const& shard: pool->shards)
+	{
+		std::unique_lock shardPin{shard->traceMutex};
+		for (auto const& event: shard->traceEvents)
+		{
+			out << (first ? "\n" : ",\n")
+				<< "{\"name\":\"" << event.name << "\",\"cat\":\"indexer\",\"ph\":\"X\",\"pid\":1,\"tid\":" << shard->index
+				<< ",\"ts\":" << microseconds(event.start - createdAt) << ",\"dur\":" << microseconds(event.duration) << "}";
+			first = false;
+		}
+	}
+	out << "\n]}\n";
+
+	out.precision(precision);
+	out.flags(flags);
+}
+
+void Indexer::Metrics::collect(IndexerStats& stats) const
+{
+	std::array<std::uint64_t, counterCount> counters{};
+	std::array<Histogram, timerCount> timers{};
+	{
+		std::unique_lock pin{pool->mutex};
+		for (auto const& shard: pool->shards)
+		{
+			for (std::size_t i = 0; i < counterCount; i++)
+			{
+				counters[i] += shard->counters[i].load(std::memory_order_relaxed);
+			}
+			for (std::size_t i = 0; i < timerCount; i++)
+			{
+				shard->timers[i].addTo(timers[i]);
+			}
+		}
+	}
+
+	auto counter = [&](Counter c) { return counters[static_cast<std::size_t>(c)]; };
+	auto timer = [&](Timer t) { return timers[static_cast<std::size_t>(t)]; };
+
+	stats.uptime = std::chrono::steady_clock::now() - createdAt;
+	stats.filesIndexed = counter(Counter::FilesIndexed);
+	stats.filesRemoved = counter(Counter::FilesRemoved);
+	stats.fullReindexes = counter(Counter::FullReindexes);
+	stats.appendReindexes = counter(Counter::AppendReindexes);
+	stats.unchangedReindexes = counter(Counter::UnchangedReindexes);
+	stats.movesInPlace = counter(Counter::MovesInPlace);
+	stats.filesReadInBatches = counter(Counter::FilesReadInBatches);
+	stats.bytesTokenized = counter(Counter::BytesTokenized);
+	stats.searches = counter(Counter::Searches);
+	stats.createdEvents = counter(Counter::CreatedEvents);
+	stats.modifiedEvents = counter(Counter::ModifiedEvents);
+	stats.deletedEvents = counter(Counter::DeletedEvents);
+	stats.movedEvents = counter(Counter::MovedEvents);
+	stats.tokenizeTime = timer(Timer::Tokenize);
+	stats.mergeTime = timer(Timer::Merge);
+	stats.indexLockWait = timer(Timer::IndexLockWait);
+	stats.searchTime = timer(Timer::Search);
+}
+
+std::chrono::nanoseconds Indexer::Histogram::mean() const
+{
+	return std::chrono::nanoseconds{count == 0 ? 0 : static_cast<std::int64_t>(total / count)};
+}
+
+std::chrono::nanoseconds Indexer::Histogram::percentile(double p) const
+{
+	if (count == 0)
+	{
+		return std::chrono::nanoseconds{0};
+	}
+
+	auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(p / 100 * static_cast<double>(count))));
+	std::uint64_t seen = 0;
+	for (std::size_t i = 0; i < buckets.size(); i++)
+	{
+		seen += buckets[i];
+		if (seen >= rank)
+		{
+			auto upperBound = i == 0 ? 0 : (std::uint64_t{1} << i) - 1;
+			return std::chrono::nanoseconds{static_cast<std::int64_t>(std::min(upperBound, max))};
+		}
+	}
+	return std::chrono::nanoseconds{static_cast<std::int64_t>(max)};
+}
+
+double Indexer::IndexerStats::tokenizeBytesPerSecond() const
+{
+	auto elapsed = seconds(std::chrono::nanoseconds{tokenizeTime.total});
+	return elapsed > 0 ? static_cast<double>(bytesTokenized) / elapsed : 0;
+}
+
+double Indexer::IndexerStats::watcherEventsPerSecond() const
+{
+	auto elapsed = seconds(uptime);
+	auto events = createdEvents + modifiedEvents + deletedEvents + movedEvents;
+	return elapsed > 0 ? static_cast<double>(events) / elapsed : 0;
+}
+
+std::ostream& Indexer::operator<<(std::ostream& out, IndexerStats const& stats)
+{
+	auto histogram = [&](char const* name, Histogram const& h) {
+		out << name << ": " << h.count << " samples, mean " << h.mean().count() << " ns, p50 " << h.percentile(50).count()
+			<< " ns, p99 " << h.percentile(99).count() << " ns, max " << h.max << " ns\n";
+	};
+
+	auto precision = out.precision(1);
+	auto flags = out.setf(std::ios::fixed, std::ios::floatfield);
+
+	out << "uptime: " << seconds(stats.uptime) << " s\n"
+		<< "workers: " << stats.activeWorkers << " active, " << stats.pendingFiles << " files pending ("
+			<< stats.queuedInteractive << " interactive, " << stats.queuedNormal << " normal, " << stats.queuedBackground << " background)\n"
+		<< "index: " << stats.indexedFiles << " files, " << stats.distinctTokens << " tokens\n"
+		<< "memory: " << mebibytes(stats.memoryBytes()) << " MiB (dictionary " << mebibytes(stats.dictionaryBytes)
+			<< ", postings " << mebibytes(stats.postingsBytes) << ", forward index " << mebibytes(stats.forwardIndexBytes)
+			<< ", paths " << mebibytes(stats.pathBytes) << ")";
+	if (stats.memoryBudget != std::numeric_limits<std::size_t>::max())
+	{
+		out << ", budget " << mebibytes(stats.memoryBudget) << " MiB";
+	}
+	out << "\n"
+		<< "spilled: " << stats.spilledTokens << " tokens, " << mebibytes(stats.spilledBytes) << " MiB on disk\n"
+		<< "files: " << stats.filesIndexed << " indexed, " << stats.filesRemoved << " removed, " << stats.movesInPlace << " moves, "
+			<< stats.filesReadInBatches << " read in batches\n"
+		<< "reindexes: " << stats.fullReindexes << " full, " << stats.appendReindexes << " append, " << stats.unchangedReindexes << " unchanged\n"
+		<< "tokenized: " << stats.bytesTokenized << " bytes, " << stats.tokenizeBytesPerSecond() / (1 << 20) << " MiB/s\n"
+		<< "watcher events: " << stats.createdEvents << " created, " << stats.modifiedEvents << " modified, "
+			<< stats.deletedEvents << " deleted, " << stats.movedEvents << " moved, " << stats.watcherEventsPerSecond() << "/s\n"
+		<< "searches: " << stats.searches << "\n";
+	histogram("tokenize", stats.tokenizeTime);
+	histogram("merge", stats.mergeTime);
+	histogram("index lock wait", stats.indexLockWait);
+	histogram("search", stats.searchTime);
+
+	out.precision(precision);
+	out.flags(flags);
+	return out;
+}
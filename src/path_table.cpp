@@ -0,0 +1,378 @@
+#include "indexer/path_table.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+template <>
+Indexer::PathTable::NameView Indexer::PathTable::ByName<Indexer::PathTable::Directory>::nameOf(std::uint32_t directory) const
+{
+	return table->directories[directory].name;
+}
+
+template <>
+Indexer::PathTable::NameView Indexer::PathTable::ByName<Indexer::PathTable::File>::nameOf(std::uint32_t fileId) const
+{
+	return table->files[fileId]->name;
+}
+
+Indexer::PathTable::PathTable()
+{
+	directories.push_back(newDirectory(rootId, {}));
+}
+
+Indexer::PathTable::Directory Indexer::PathTable::newDirectory(DirectoryId parent, Name name) const
+{
+	return Directory{
+		parent, std::move(name),
+		Entries<Directory>{0, ByName<Directory>{this}, ByName<Directory>{this}},
+		Entries<File>{0, ByName<File>{this}, ByName<File>{this}},
+	};
+}
+
+void Indexer::PathTable::insert(FileId fileId, std::filesystem::path const& path)
+{
+	erase(fileId);  // its name must not change under its entry
+
+	auto directory = makeDirectory(path.parent_path());
+	auto& directoryFiles = directories[directory].files;
+	if (auto existing = directoryFiles.find(NameView{path.filename().native()}); existing != directoryFiles.end())
+	{
+		erase(*existing);  // replaced
+	}
+
+	if (fileId >= files.size())
+	{
+		files.resize(fileId + 1);
+	}
+	files[fileId] = File{directory, path.filename().native()};
+	fileCount++;
+	directoryFiles.insert(fileId);
+	entryBytes += hashNodeBytes<FileId> + heapBytes(files[fileId]->name);
+	if (unplaced.insert(fileId).second)
+	{
+		entryBytes += hashNodeBytes<FileId>;
+	}
+}
+
+void Indexer::PathTable::erase(FileId fileId)
+{
+	if (not contains(fileId))
+	{
+		return;
+	}
+
+	auto& file = *files[fileId];
+	auto& directoryFiles = directories[file.directory].files;
+	if (auto entry = directoryFiles.find(fileId); entry != directoryFiles.end())
+	{
+		directoryFiles.erase(entry);
+	}
+	entryBytes -= hashNodeBytes<FileId> + heapBytes(file.name);
+	files[fileId].reset();
+	fileCount--;
+	if (unplaced.erase(fileId) > 0)
+	{
+		entryBytes -= hashNodeBytes<FileId>;
+	}
+}
+
+std::optional<Indexer::FileId> Indexer::PathTable::find(std::filesystem::path const& path) const
+{
+	auto directory = findDirectory(path.parent_path());
+	if (not directory)
+	{
+		return std::nullopt;
+	}
+
+	auto const& directoryFiles = directories[*directory].files;
+	auto it = directoryFiles.find(NameView{path.filename().native()});
+	if (it == directoryFiles.end())
+	{
+		return std::nullopt;
+	}
+	return *it;
+}
+
+Indexer::FileId Indexer::PathTable::at(std::filesystem::path const& path) const
+{
+	auto fileId = find(path);
+	if (not fileId)
+	{
+		throw std::out_of_range{"PathTable::at: " + path.string()};
+	}
+	return *fileId;
+}
+
+std::filesystem::path Indexer::PathTable::path(FileId fileId) const
+{
+	auto const& file = files.at(fileId).value();
+	return directoryPath(file.directory) / file.name;
+}
+
+std::vector<Indexer::FileId> Indexer::PathTable::filesUnder(std::filesystem::path const& directory) const
+{
+	std::vector<FileId> fileIds;
+	auto root = findDirectory(directory);
+	if (not root)
+	{
+		return fileIds;
+	}
+
+	std::vector<DirectoryId> pending{*root};
+	while (not pending.empty())
+	{
+		auto const& current = directories[pending.back()];
+		pending.pop_back();
+		fileIds.insert(fileIds.end(), current.files.begin(), current.files.end());
+		pending.insert(pending.end(), current.subdirectories.begin(), current.subdirectories.end());
+	}
+	return fileIds;
+}
+
+std::optional<Indexer::FileId> Indexer::PathTable::moveFile(std::filesystem::path const& from, std::filesystem::path const& to)
+{
+	auto fileId = find(from);
+	if (not fileId)
+	{
+		return std::nullopt;
+	}
+
+	auto displacedId = find(to);
+	if (displacedId == fileId)
+	{
+		return std::nullopt;
+	}
+	else if (displacedId)
+	{
+		erase(*displacedId);
+	}
+	erase(*fileId);
+	insert(*fileId, to);
+	return displacedId;
+}
+
+std::vector<Indexer::FileId> Indexer::PathTable::moveDirectory(std::filesystem::path const& from, std::filesystem::path const& to)
+{
+	auto directoryId = findDirectory(from);
+	if (not directoryId || *directoryId == rootId)
+	{
+		return {};
+	}
+
+	auto newParent = makeDirectory(to.parent_path());
+	auto newName = to.filename().native();
+	auto const& siblings = directories[newParent].subdirectories;
+	if (auto existing = siblings.find(NameView{newName}); existing != siblings.end())  // merge into the existing one, entry by entry
+	{
+		if (*existing == *directoryId)
+		{
+			return {};
+		}
+
+		std::vector<Name> fileNames;
+		for (auto fileId: directories[*directoryId].files)
+		{
+			fileNames.push_back(files[fileId]->name);
+		}
+		std::vector<Name> subdirectoryNames;
+		for (auto subdirectory: directories[*directoryId].subdirectories)
+		{
+			subdirectoryNames.push_back(directories[subdirectory].name);
+		}
+
+		std::vector<FileId> displacedIds;
+		for (auto const& name: fileNames)
+		{
+			if (auto displacedId = moveFile(from / name, to / name))
+			{
+				displacedIds.push_back(*displacedId);
+			}
+		}
+		for (auto const& name: subdirectoryNames)
+		{
+			auto displacedBelow = moveDirectory(from / name, to / name);
+			displacedIds.insert(displacedIds.end(), displacedBelow.begin(), displacedBelow.end());
+		}
+		return displacedIds;
+	}
+
+	auto& directory = directories[*directoryId];
+	auto& oldSiblings = directories[directory.parent].subdirectories;
+	oldSiblings.erase(oldSiblings.find(*directoryId));  // before its name changes
+	entryBytes -= heapBytes(directory.name);
+	entryBytes += heapBytes(newName);
+	directory.parent = newParent;
+	directory.name = std::move(newName);
+	directories[newParent].subdirectories.insert(*directoryId);
+	hasMovedDirectories = true;
+	return {};
+}
+
+std::vector<Indexer::FileId> Indexer::PathTable::directoryOrder() const
+{
+	std::vector<FileId> order;
+	order.reserve(fileCount);
+	std::vector<DirectoryId> pending{rootId};
+	while (not pending.empty())
+	{
+		auto const& current = directories[pending.back()];
+		pending.pop_back();
+		order.insert(order.end(), current.files.begin(), current.files.end());
+		pending.insert(pending.end(), current.subdirectories.begin(), current.subdirectories.end());
+	}
+	return order;
+}
+
+void Indexer::PathTable::remap(std::vector<FileId> const& newIds)
+{
+	std::vector<std::optional<File>> remapped(files.size());
+	for (std::size_t oldId = 0; oldId < files.size(); oldId++)
+	{
+		if (files[oldId] && newIds[oldId] != FileIdAllocator::none)
+		{
+			remapped[newIds[oldId]] = std::move(files[oldId]);
+		}
+	}
+	while (not remapped.empty() && not remapped.back())
+	{
+		remapped.pop_back();
+	}
+
+	// the entries are hashed by the names they find through their ids, so they are filled in anew
+	for (auto& directory: directories)
+	{
+		directory.files.clear();
+	}
+	files = std::move(remapped);
+	for (FileId fileId = 0; fileId < files.size(); fileId++)
+	{
+		if (files[fileId])
+		{
+			directories[files[fileId]->directory].files.insert(fileId);
+		}
+	}
+	placeFiles();
+}
+
+void Indexer::PathTable::placeFiles()
+{
+	for (auto& directory: directories)
+	{
+		directory.firstId = FileIdAllocator::none;
+		directory.endId = 0;
+	}
+	for (FileId fileId = 0; fileId < files.size(); fileId++)
+	{
+		if (not files[fileId])
+		{
+			continue;
+		}
+		for (auto directory = files[fileId]->directory; ; directory = directories[directory].parent)
+		{
+			auto& bounds = directories[directory];
+			bounds.firstId = std::min(bounds.firstId, fileId);
+			bounds.endId = fileId + 1;  // visited in increasing order
+			if (directory == rootId)
+			{
+				break;
+			}
+		}
+	}
+	for (auto& directory: directories)
+	{
+		if (directory.firstId == FileIdAllocator::none)
+		{
+			directory.firstId = 0;
+		}
+	}
+
+	entryBytes -= unplaced.size() * hashNodeBytes<FileId>;
+	unplaced.clear();
+	hasMovedDirectories = false;
+}
+
+std::optional<Indexer::PathTable::Scope> Indexer::PathTable::scope(std::filesystem::path const& directory) const
+{
+	auto directoryId = findDirectory(directory);
+	if (not directoryId)
+	{
+		return std::nullopt;
+	}
+	if (hasMovedDirectories)
+	{
+		return Scope{*directoryId, 0, static_cast<FileId>(files.size()), &unplaced};
+	}
+	auto const& bounds = directories[*directoryId];
+	return Scope{*directoryId, bounds.firstId, bounds.endId, &unplaced};
+}
+
+bool Indexer::PathTable::isUnder(FileId fileId, Scope const& scope) const
+{
+	assert(contains(fileId));
+	for (auto directory = files[fileId]->directory; ; directory = directories[directory].parent)
+	{
+		if (directory == scope.directory)
+		{
+			return true;
+		}
+		if (directory == rootId)
+		{
+			return false;
+		}
+	}
+}
+
+std::optional<Indexer::PathTable::DirectoryId> Indexer::PathTable::findDirectory(std::filesystem::path const& path) const
+{
+	auto directory = rootId;
+	for (auto const& component: path)
+	{
+		auto const& subdirectories = directories[directory].subdirectories;
+		auto it = subdirectories.find(NameView{component.native()});
+		if (it == subdirectories.end())
+		{
+			return std::nullopt;
+		}
+		directory = *it;
+	}
+	return directory;
+}
+
+Indexer::PathTable::DirectoryId Indexer::PathTable::makeDirectory(std::filesystem::path const& path)
+{
+	auto directory = rootId;
+	for (auto const& component: path)
+	{
+		auto const& name = component.native();
+		if (auto const& subdirectories = directories[directory].subdirectories; subdirectories.contains(NameView{name}))
+		{
+			directory = *subdirectories.find(NameView{name});
+		}
+		else
+		{
+			auto subdirectory = static_cast<DirectoryId>(directories.size());
+			directories.push_back(newDirectory(directory, name));  // named before it's inserted, by name
+			directories[directory].subdirectories.insert(subdirectory);
+			entryBytes += hashNodeBytes<DirectoryId> + heapBytes(name);
+			directory = subdirectory;
+		}
+	}
+	return directory;
+}
+
+std::filesystem::path Indexer::PathTable::directoryPath(DirectoryId directory) const
+{
+	std::vector<Name const*> names;
+	for (; directory != rootId; directory = directories[directory].parent)
+	{
+		names.push_back(&directories[directory].name);
+	}
+
+	std::filesystem::path path;
+	for (auto it = names.rbegin(); it != names.rend(); ++it)
+	{
+		path /= **it;
+	}
+	return path;
+}
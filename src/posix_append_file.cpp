@@ -0,0 +1,112 @@
+#include "indexer/append_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace Indexer
+{
+class AppendFileImpl
+{
+public:
+	AppendFileImpl(std::filesystem::path const& path_)
+		: path{path_}
+	{
+		fileDescriptor = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if (fileDescriptor < 0)
+		{
+			fail("open()");
+		}
+	}
+
+	AppendFileImpl(AppendFileImpl const&) = delete;
+	AppendFileImpl& operator=(AppendFileImpl const&) = delete;
+
+	~AppendFileImpl()
+	{
+		close(fileDescriptor);
+	}
+
+	void append(std::string_view data)
+	{
+		while (not data.empty())
+		{
+			auto written = write(fileDescriptor, data.data(), data.size());
+			if (written < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				fail("write()");
+			}
+			data.remove_prefix(static_cast<std::size_t>(written));
+		}
+	}
+
+	void sync()
+	{
+		if (fdatasync(fileDescriptor) < 0)
+		{
+			fail("fdatasync()");
+		}
+	}
+
+	void truncate(std::uint64_t size)
+	{
+		if (ftruncate(fileDescriptor, static_cast<off_t>(size)) < 0)  // O_APPEND writes go to the new end
+		{
+			fail("ftruncate()");
+		}
+	}
+
+private:
+	[[noreturn]] void fail(char const* call) const
+	{
+		throw std::runtime_error{std::string{call} + ": " + path.string() + ": " + std::strerror(errno)};
+	}
+
+	std::filesystem::path path;
+	int fileDescriptor{-1};
+};
+
+AppendFile::AppendFile(std::filesystem::path const& path): pImpl{std::make_unique<AppendFileImpl>(path)} {}
+AppendFile::AppendFile(AppendFile&&) = default;
+AppendFile& AppendFile::operator=(AppendFile&&) = default;
+AppendFile::~AppendFile() = default;
+
+void AppendFile::append(std::string_view data)
+{
+	pImpl->append(data);
+}
+
+void AppendFile::sync()
+{
+	pImpl->sync();
+}
+
+void AppendFile::truncate(std::uint64_t size)
+{
+	pImpl->truncate(size);
+}
+
+void AppendFile::syncDirectoryOf(std::filesystem::path const& file)
+{
+	auto directory = file.has_parent_path() ? file.parent_path() : std::filesystem::path{"."};
+	auto fileDescriptor = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fileDescriptor < 0 || fsync(fileDescriptor) < 0)
+	{
+		auto error = errno;
+		if (fileDescriptor >= 0)
+		{
+			close(fileDescriptor);
+		}
+		throw std::runtime_error{"fsync(): " + directory.string() + ": " + std::strerror(error)};
+	}
+	close(fileDescriptor);
+}
+}
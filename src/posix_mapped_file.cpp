@@ -0,0 +1,76 @@
+#include "indexer/mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Indexer
+{
+class MappedFileImpl
+{
+public:
+	MappedFileImpl(std::filesystem::path const& path)
+	{
+		auto fileDescriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fileDescriptor < 0)
+		{
+			throw std::runtime_error{"open(): " + path.string() + ": " + std::strerror(errno)};
+		}
+
+		struct stat status;
+		if (fstat(fileDescriptor, &status) < 0)
+		{
+			auto error = errno;
+			close(fileDescriptor);
+			throw std::runtime_error{"fstat(): " + path.string() + ": " + std::strerror(error)};
+		}
+		size = static_cast<std::size_t>(status.st_size);
+
+		if (size > 0)  // mapping nothing is an error
+		{
+			data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		}
+		close(fileDescriptor);  // the mapping keeps the file alive
+		if (data == MAP_FAILED)
+		{
+			throw std::runtime_error{"mmap(): " + path.string() + ": " + std::strerror(errno)};
+		}
+	}
+
+	MappedFileImpl(MappedFileImpl const&) = delete;
+	MappedFileImpl& operator=(MappedFileImpl const&) = delete;
+
+	~MappedFileImpl()
+	{
+		if (size > 0)
+		{
+			munmap(data, size);
+		}
+	}
+
+	std::string_view contents() const
+	{
+		return size > 0 ? std::string_view{static_cast<char const*>(data), size} : std::string_view{};
+	}
+
+private:
+	void* data{nullptr};
+	std::size_t size{0};
+};
+
+MappedFile::MappedFile(std::filesystem::path const& path): pImpl{std::make_unique<MappedFileImpl>(path)} {}
+MappedFile::MappedFile(MappedFile&&) = default;
+MappedFile& MappedFile::operator=(MappedFile&&) = default;
+MappedFile::~MappedFile() = default;
+
+std::string_view MappedFile::contents() const
+{
+	return pImpl->contents();
+}
+}
@@ -0,0 +1,36 @@
+#include "indexer/posting_segment.h"
+
+#include <cassert>
+#include <fstream>
+#include <stdexcept>
+
+Indexer::PostingSegment::PostingSegment(std::filesystem::path file_, std::vector<FileId> const& postings, std::size_t listCount)
+	: file{std::move(file_)}
+	, liveListCount{listCount}
+{
+	{
+		std::ofstream fout{file, std::ios::binary | std::ios::trunc};
+		fout.write(reinterpret_cast<char const*>(postings.data()), static_cast<std::streamsize>(postings.size() * sizeof(FileId)));
+		if (not fout.flush())
+		{
+			throw std::runtime_error{"Could not write posting segment " + file.string()};
+		}
+	}
+	mapping.emplace(file);
+}
+
+Indexer::PostingSegment::~PostingSegment()
+{
+	mapping.reset();  // some platforms won't delete a mapped file
+	std::error_code errorCode;
+	std::filesystem::remove(file, errorCode);
+}
+
+std::span<Indexer::FileId const> Indexer::PostingSegment::postings(Extent extent) const
+{
+	auto contents = mapping->contents();
+	assert((extent.offset + extent.count) * sizeof(FileId) <= contents.size());
+	// mappings are page aligned and the file holds nothing but file ids
+	auto const* begin = reinterpret_cast<FileId const*>(contents.data()) + extent.offset;
+	return {begin, extent.count};
+}
@@ -0,0 +1,259 @@
+#include "indexer/protocol.h"
+
+#include <optional>
+#include <utility>
+
+namespace
+{
+using namespace Indexer::Protocol;
+
+void putU32(std::string& out, std::uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+	}
+}
+
+std::uint32_t getU32(char const* in)
+{
+	std::uint32_t value = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		value |= static_cast<std::uint32_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+	}
+	return value;
+}
+
+void putString(std::string& out, std::string_view string)
+{
+	putU32(out, static_cast<std::uint32_t>(string.size()));
+	out.append(string);
+}
+
+void putStrings(std::string& out, std::vector<std::string> const& strings)
+{
+	putU32(out, static_cast<std::uint32_t>(strings.size()));
+	for (auto const& string: strings)
+	{
+		putString(out, string);
+	}
+}
+
+// the length goes in front once the rest of the frame is written
+class FrameWriter
+{
+public:
+	FrameWriter(std::string& out_, std::uint32_t id, Opcode opcode)
+		: out{out_}
+		, start{out_.size()}
+	{
+		putU32(out, 0);
+		putU32(out, id);
+		out.push_back(static_cast<char>(opcode));
+	}
+
+	void finish()
+	{
+		auto length = out.size() - start - 4;
+		if (length > maxFrameSize)
+		{
+			out.resize(start);
+			throw ProtocolError{"Frame of " + std::to_string(length) + " bytes is too large"};
+		}
+		for (int i = 0; i < 4; i++)
+		{
+			out[start + static_cast<std::size_t>(i)] = static_cast<char>((length >> (8 * i)) & 0xff);
+		}
+	}
+
+private:
+	std::string& out;
+	std::size_t start;
+};
+
+class FrameReader
+{
+public:
+	explicit FrameReader(std::string_view body_): body{body_} {}
+
+	std::uint8_t u8() { return static_cast<std::uint8_t>(take(1)[0]); }
+	std::uint32_t u32() { return getU32(take(4).data()); }
+	std::string string() { return std::string{take(u32())}; }
+
+	std::vector<std::string> strings()
+	{
+		auto count = u32();
+		if (count > body.size() / 4)  // each one takes at least its length
+		{
+			throw ProtocolError{"List of " + std::to_string(count) + " strings in a frame of " + std::to_string(body.size()) + " bytes"};
+		}
+		std::vector<std::string> strings;
+		strings.reserve(count);
+		for (std::uint32_t i = 0; i < count; i++)
+		{
+			strings.push_back(string());
+		}
+		return strings;
+	}
+
+	Opcode opcode()
+	{
+		auto opcode = u8();
+		if (opcode > static_cast<std::uint8_t>(Opcode::Stats))
+		{
+			throw ProtocolError{"Unknown opcode " + std::to_string(opcode)};
+		}
+		return static_cast<Opcode>(opcode);
+	}
+
+	void finish() const
+	{
+		if (not body.empty())
+		{
+			throw ProtocolError{std::to_string(body.size()) + " bytes left over at the end of a frame"};
+		}
+	}
+
+private:
+	std::string_view take(std::size_t size)
+	{
+		if (size > body.size())
+		{
+			throw ProtocolError{"Frame ends in the middle of a field"};
+		}
+		auto field = body.substr(0, size);
+		body.remove_prefix(size);
+		return field;
+	}
+
+	std::string_view body;
+};
+
+// the frame at the start of `in` and its size, once it is all there
+std::optional<std::pair<FrameReader, std::size_t>> frameAt(std::string_view in)
+{
+	if (in.size() < 4)
+	{
+		return std::nullopt;
+	}
+	auto length = getU32(in.data());
+	if (length > maxFrameSize)
+	{
+		throw ProtocolError{"Frame of " + std::to_string(length) + " bytes is too large"};
+	}
+	if (in.size() - 4 < length)
+	{
+		return std::nullopt;
+	}
+	return std::pair{FrameReader{in.substr(4, length)}, std::size_t{4} + length};
+}
+}
+
+void Indexer::Protocol::encode(Request const& request, std::string& out)
+{
+	FrameWriter frame{out, request.id, request.opcode};
+	switch (request.opcode)
+	{
+		case Opcode::Add:
+			out.push_back(request.isRecursive ? 1 : 0);
+			putString(out, request.arguments.empty() ? std::string{} : request.arguments.front());
+			break;
+
+		case Opcode::Search:
+			putStrings(out, request.arguments);
+			break;
+
+		case Opcode::Stats:
+			break;
+	}
+	frame.finish();
+}
+
+void Indexer::Protocol::encode(Response const& response, std::string& out)
+{
+	FrameWriter frame{out, response.id, response.opcode};
+	out.push_back(static_cast<char>(response.status));
+	if (response.status == Status::Error)
+	{
+		putString(out, response.message);
+	}
+	else if (response.opcode == Opcode::Search)
+	{
+		putU32(out, static_cast<std::uint32_t>(response.results.size()));
+		for (auto const& paths: response.results)
+		{
+			putStrings(out, paths);
+		}
+	}
+	else if (response.opcode == Opcode::Stats)
+	{
+		putString(out, response.message);
+	}
+	frame.finish();
+}
+
+std::size_t Indexer::Protocol::decode(std::string_view in, Request& request)
+{
+	auto frame = frameAt(in);
+	if (not frame)
+	{
+		return 0;
+	}
+	auto& [reader, size] = *frame;
+
+	request = Request{.id = reader.u32(), .opcode = reader.opcode()};
+	switch (request.opcode)
+	{
+		case Opcode::Add:
+			request.isRecursive = reader.u8() != 0;
+			request.arguments.push_back(reader.string());
+			break;
+
+		case Opcode::Search:
+			request.arguments = reader.strings();
+			break;
+
+		case Opcode::Stats:
+			break;
+	}
+	reader.finish();
+	return size;
+}
+
+std::size_t Indexer::Protocol::decode(std::string_view in, Response& response)
+{
+	auto frame = frameAt(in);
+	if (not frame)
+	{
+		return 0;
+	}
+	auto& [reader, size] = *frame;
+
+	response = Response{.id = reader.u32(), .opcode = reader.opcode()};
+	auto status = reader.u8();
+	if (status > static_cast<std::uint8_t>(Status::Error))
+	{
+		throw ProtocolError{"Unknown status " + std::to_string(status)};
+	}
+	response.status = static_cast<Status>(status);
+
+	if (response.status == Status::Error)
+	{
+		response.message = reader.string();
+	}
+	else if (response.opcode == Opcode::Search)
+	{
+		auto count = reader.u32();
+		for (std::uint32_t i = 0; i < count; i++)
+		{
+			response.results.push_back(reader.strings());
+		}
+	}
+	else if (response.opcode == Opcode::Stats)
+	{
+		response.message = reader.string();
+	}
+	reader.finish();
+	return size;
+}
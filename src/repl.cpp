@@ -1,7 +1,14 @@
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <fstream>
 #include <functional>
+#include <iomanip>
 #include <iostream>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "indexer/indexer.h"
 
@@ -19,20 +26,24 @@ public:
 		aliases.insert({alias, command});
 	}
 
-	void call(std::string const& command, std::string_view args)
+	std::string resolve(std::string const& command) const
 	{
-		auto const& cmd = [&](){
-			if (aliases.contains(command))
-				return aliases.at(command);
-			return command;
-		}();
+		return aliases.contains(command) ? aliases.at(command) : command;
+	}
+
+	// false if there is no such command
+	bool call(std::string const& command, std::string_view args)
+	{
+		auto const& cmd = resolve(command);
 		if (commands.contains(cmd))
 		{
 			commands.at(cmd)(args);
+			return true;
 		}
 		else
 		{
 			std::cerr << "Unknown syntax: `" << command << "`\n";
+			return false;
 		}
 	}
 
@@ -81,8 +92,258 @@ std::string formatDuration(std::chrono::steady_clock::duration duration)
 	return std::to_string(units) + " " + names[i];
 }
 
-int main()
+// `add -r foo` -> {"add", "-r foo"}
+std::pair<std::string, std::string> splitCommand(std::string const& line)
+{
+	auto commandEnd = line.find_first_of(' ');
+	if (commandEnd == std::string::npos)
+	{
+		return {line, ""};
+	}
+	auto argsStart = line.find_first_not_of(' ', commandEnd);
+	return {line.substr(0, commandEnd), argsStart == std::string::npos ? "" : line.substr(argsStart)};
+}
+
+struct Options
+{
+	std::optional<std::string> script;  // "-" for stdin
+	bool isQuiet{false};
+	std::optional<std::string> timingsFile;
+};
+
+void printUsage()
+{
+	std::cerr << "usage: repl [options]\n"
+		"  --script=<file>                  run the commands in the file instead of prompting, - for stdin;\n"
+		"                                   lines between `repeat <n>` and `end` are run n times, # starts a comment\n"
+		"  --quiet                          with --script, print only the timing summary to stdout\n"
+		"  --timings=<file>                 with --script, write each command's latency there as tab-separated values\n";
+}
+
+std::optional<Options> parseOptions(int argc, char** argv)
+{
+	Options options;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view arg = argv[i];
+		auto equals = arg.find('=');
+		auto name = arg.substr(0, equals);
+		auto value = equals == std::string_view::npos ? std::string{} : std::string{arg.substr(equals + 1)};
+
+		if (name == "--script" && not value.empty())
+			options.script = value;
+		else if (name == "--quiet")
+			options.isQuiet = true;
+		else if (name == "--timings" && not value.empty())
+			options.timingsFile = value;
+		else
+			return std::nullopt;
+	}
+	if (not options.script && (options.isQuiet || options.timingsFile))
+	{
+		return std::nullopt;
+	}
+	return options;
+}
+
+// Runs a script of REPL commands and times each of them, for profiling with a fixed workload
+class ScriptRunner
 {
+public:
+	ScriptRunner(Repl& repl_, Options const& options)
+		: repl{repl_}
+		, isQuiet{options.isQuiet}
+	{
+		if (options.timingsFile)
+		{
+			timings.emplace(*options.timingsFile);
+			*timings << "line\tcommand\targuments\tnanoseconds\n";
+		}
+	}
+
+	// false if the script is malformed or has an unknown command, it stops there
+	bool run(std::istream& script)
+	{
+		for (std::string line; std::getline(script, line); )
+		{
+			auto first = line.find_first_not_of(" \t");
+			lines.push_back(first == std::string::npos || line[first] == '#' ? "" : line.substr(first));
+		}
+		if (blockEnd(0) != lines.size())
+		{
+			std::cerr << "`end` without `repeat`\n";
+			return false;
+		}
+		auto start = Clock::now();
+		if (not runLines(0, lines.size()))
+		{
+			return false;
+		}
+		elapsed = Clock::now() - start;
+		return true;
+	}
+
+	// per command: how many ran, in how long, and latency percentiles, as tab-separated values
+	void writeSummary(std::ostream& out)
+	{
+		out << "command\tcount\ttotal_ms\tmean_us\tp50_us\tp99_us\tper_second\n";
+		std::vector<Clock::duration> all;
+		for (auto const& command: commandOrder)
+		{
+			auto& latencies = commandLatencies.at(command);
+			all.insert(all.end(), latencies.begin(), latencies.end());
+			writeSummaryLine(out, command, latencies, std::chrono::duration<double>(sum(latencies)).count());
+		}
+		writeSummaryLine(out, "all", all, std::chrono::duration<double>(elapsed).count());  // wall time, with the script's own overhead
+	}
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// index of the `end` closing the block that starts at `begin`, or of the end of the script
+	std::size_t blockEnd(std::size_t begin) const
+	{
+		std::size_t depth = 0;
+		for (auto i = begin; i < lines.size(); i++)
+		{
+			auto command = splitCommand(lines[i]).first;
+			if (command == "repeat")
+			{
+				depth++;
+			}
+			else if (command == "end")
+			{
+				if (depth == 0)
+				{
+					return i;
+				}
+				depth--;
+			}
+		}
+		return lines.size();
+	}
+
+	bool runLines(std::size_t begin, std::size_t end)
+	{
+		for (auto i = begin; i < end; i++)
+		{
+			if (lines[i].empty())
+			{
+				continue;
+			}
+			auto [command, args] = splitCommand(lines[i]);
+			if (command == "repeat")
+			{
+				auto blockBegin = i + 1;
+				i = blockEnd(blockBegin);
+				if (i == lines.size())
+				{
+					std::cerr << "line " << blockBegin << ": `repeat` without `end`\n";
+					return false;
+				}
+				std::size_t count;
+				try
+				{
+					count = std::stoull(args);
+				}
+				catch (std::exception const&)
+				{
+					std::cerr << "line " << blockBegin << ": repeat <n>\n";
+					return false;
+				}
+				for (std::size_t n = 0; n < count; n++)
+				{
+					if (not runLines(blockBegin, i))
+					{
+						return false;
+					}
+				}
+				continue;
+			}
+			if (not runCommand(i + 1, command, args))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool runCommand(std::size_t lineNumber, std::string const& command, std::string const& args)
+	{
+		if (isQuiet)
+		{
+			std::cout.setstate(std::ios::badbit);  // drops the command's output, not errors on std::cerr
+		}
+		auto start = Clock::now();
+		auto isKnown = repl.call(command, args);
+		auto latency = Clock::now() - start;
+		std::cout.clear();
+		if (not isKnown)
+		{
+			std::cerr << "line " << lineNumber << ": stopping\n";
+			return false;
+		}
+
+		auto name = repl.resolve(command);
+		auto [it, isNew] = commandLatencies.try_emplace(name);
+		if (isNew)
+		{
+			commandOrder.push_back(name);
+		}
+		it->second.push_back(latency);
+		if (timings)
+		{
+			*timings << lineNumber << '\t' << name << '\t' << args << '\t'
+				<< std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count() << '\n';
+		}
+		return true;
+	}
+
+	static Clock::duration sum(std::vector<Clock::duration> const& latencies)
+	{
+		Clock::duration total{0};
+		for (auto latency: latencies)
+		{
+			total += latency;
+		}
+		return total;
+	}
+
+	static void writeSummaryLine(std::ostream& out, std::string const& command, std::vector<Clock::duration>& latencies, double seconds)
+	{
+		std::sort(latencies.begin(), latencies.end());
+		auto microseconds = [](Clock::duration d) { return std::chrono::duration<double, std::micro>(d).count(); };
+		auto percentile = [&](double p)
+		{
+			auto rank = static_cast<std::size_t>(std::ceil(p / 100 * static_cast<double>(latencies.size())));
+			return microseconds(latencies[std::clamp(rank, std::size_t{1}, latencies.size()) - 1]);
+		};
+		auto count = static_cast<double>(latencies.size());
+		out << std::fixed << std::setprecision(3)
+			<< command << '\t' << latencies.size() << '\t' << seconds * 1000 << '\t'
+			<< (latencies.empty() ? 0 : microseconds(sum(latencies)) / count) << '\t'
+			<< (latencies.empty() ? 0 : percentile(50)) << '\t' << (latencies.empty() ? 0 : percentile(99)) << '\t'
+			<< (seconds > 0 ? count / seconds : 0) << '\n';
+	}
+
+	Repl& repl;
+	bool isQuiet;
+	std::optional<std::ofstream> timings;
+	std::vector<std::string> lines;  // comments blanked out, so that line numbers stay
+	std::vector<std::string> commandOrder;  // as first run
+	std::unordered_map<std::string, std::vector<Clock::duration>> commandLatencies;
+	Clock::duration elapsed{0};
+};
+
+int main(int argc, char** argv)
+{
+	auto options = parseOptions(argc, argv);
+	if (not options)
+	{
+		printUsage();
+		return 1;
+	}
+
 	Indexer::Indexer indexer;  // Indexer indexer? Indexer!
 
 	bool doQuit = false;
@@ -105,28 +366,197 @@ int main()
 		"add",
 		[&](auto path) {
 			auto recursive = Indexer::Recursive::No;
+			bool isBulk = false;
+			if (path.starts_with("-b "))
+			{
+				isBulk = true;
+				path = path.data() + 3;
+			}
 			if (path.starts_with("-r "))
 			{
 				recursive = Indexer::Recursive::Yes;
 				path = path.data() + 3;
 			}
 			auto start = std::chrono::steady_clock::now();
-			indexer.addPath(path, recursive);
+			if (isBulk)
+			{
+				indexer.addPath(path, recursive, Indexer::BulkLoad{});
+			}
+			else
+			{
+				indexer.addPath(path, recursive);
+			}
 			auto duration = std::chrono::steady_clock::now() - start;
 			std::cerr << "Took ~" << formatDuration(duration) << " to index\n";
 		},
-		"add [-r] <path>: add a path to the index"
+		"add [-b] [-r] <path>: add a path to the index, -b sorts postings in bulk for large initial builds"
+	);
+
+	std::vector<std::pair<std::string, Indexer::IndexingTask>> tasks;
+	repl.add_command(
+		"bg",
+		[&](auto path) {
+			auto recursive = Indexer::Recursive::No;
+			if (path.starts_with("-r "))
+			{
+				recursive = Indexer::Recursive::Yes;
+				path = path.data() + 3;
+			}
+			tasks.emplace_back(std::string{path}, indexer.addPathAsync(path, recursive));
+		},
+		"bg [-r] <path>: add a path to the index in the background, behind files from add and the watcher"
+	);
+
+	repl.add_command(
+		"jobs",
+		[&](auto args) {
+			for (auto& [path, task]: tasks)
+			{
+				if (args == "cancel")
+				{
+					task.cancel();
+				}
+				auto progress = task.progress();
+				std::cout << path << ": " << progress.filesIndexed << " indexed, " << progress.filesSkipped << " skipped of "
+					<< progress.filesDiscovered << " files found, " << progress.bytesRead << " bytes read"
+					<< (progress.isDone ? ", done" : "") << "\n";
+			}
+			std::erase_if(tasks, [](auto const& task) { return task.second.isDone(); });
+		},
+		"jobs [cancel]: show the progress of background adds, or cancel them"
+	);
+
+	repl.add_command(
+		"wait",
+		[&](auto) {
+			for (auto& [_, task]: tasks)
+			{
+				task.wait();
+			}
+			tasks.clear();
+		},
+		"wait: wait for the background adds to finish"
 	);
 
 	repl.add_command(
 		"search",
-		[&](auto token) {
-			for (auto&& f: indexer.search(std::string{token}))
+		[&](auto args) {
+			auto [token, directory] = splitCommand(std::string{args});
+			for (auto&& f: directory.empty() ? indexer.search(token) : indexer.search(token, directory))
 				std::cout << f << "\n";
 		},
-		"search <token>: list files containing the search term"
+		"search <token> [<directory>]: list files containing the search term, only under the directory if given"
+	);
+
+	repl.add_command(
+		"fuzzy",
+		[&](auto args) {
+			auto [distance, token] = splitCommand(std::string{args});
+			try
+			{
+				for (auto&& f: indexer.searchFuzzy(std::string{token}, static_cast<unsigned>(std::stoul(std::string{distance}))))
+					std::cout << f << "\n";
+			}
+			catch (std::exception const&)
+			{
+				repl.showHelp("fuzzy");
+			}
+		},
+		"fuzzy <distance> <token>: list files containing terms within 1 or 2 typos of the search term"
+	);
+
+	repl.add_command(
+		"stats", [&](auto){ std::cout << indexer.stats(); },
+		"stats: show indexer counters and latencies"
+	);
+
+	repl.add_command(
+		"budget",
+		[&](auto megabytes) {
+			try
+			{
+				indexer.setMemoryBudget(std::stoull(std::string{megabytes}) << 20);
+			}
+			catch (std::exception const&)
+			{
+				repl.showHelp("budget");
+			}
+		},
+		"budget <MiB>: spill posting lists to disk beyond this much memory"
+	);
+
+	repl.add_command(
+		"trace",
+		[&](auto args) {
+			if (args == "start")
+			{
+				indexer.setTracing(true);
+			}
+			else if (args.starts_with("stop "))
+			{
+				indexer.setTracing(false);
+				std::ofstream fout{std::string{args.substr(5)}};
+				indexer.writeTrace(fout);
+			}
+			else
+			{
+				repl.showHelp("trace");
+			}
+		},
+		"trace start | trace stop <file>: record trace spans, then write them as Chrome trace JSON"
+	);
+
+	repl.add_command(
+		"publish",
+		[&](auto file) {
+			try
+			{
+				indexer.publishSnapshot(std::string{file});
+			}
+			catch (std::exception const& e)
+			{
+				std::cerr << e.what() << '\n';
+			}
+		},
+		"publish <file>: write the index where other processes can map it, e.g. under /dev/shm"
 	);
 
+	repl.add_command(
+		"persist",
+		[&](auto file) {
+			try
+			{
+				indexer.persist(std::string{file});
+			}
+			catch (std::exception const& e)
+			{
+				std::cerr << e.what() << '\n';
+			}
+		},
+		"persist <file>: restore the index from <file> and its log, log changes from now on; publish <file> to checkpoint"
+	);
+
+	if (options->script)
+	{
+		std::ifstream file;
+		if (*options->script != "-")
+		{
+			file.open(*options->script);
+			if (not file)
+			{
+				std::cerr << "Could not open " << *options->script << '\n';
+				return 1;
+			}
+		}
+		ScriptRunner runner{repl, *options};
+		if (not runner.run(*options->script == "-" ? std::cin : file))
+		{
+			return 1;
+		}
+		runner.writeSummary(std::cout);
+		return 0;
+	}
+
 	std::string cmd;
 	std::cout << "Type \"help\" or \"?\" for help, \"quit\" to quit\n";
 	do {
@@ -135,15 +565,8 @@ int main()
 		if (cmd == "")
 			continue;
 
-		auto commandEnd = cmd.find_first_of(' ');
-		if (commandEnd == std::string::npos)
-		{
-			repl.call(cmd, "");
-		}
-		else
-		{
-			repl.call(cmd.substr(0, commandEnd), cmd.substr(cmd.find_first_not_of(' ', commandEnd)));
-		}
+		auto [command, args] = splitCommand(cmd);
+		repl.call(command, args);
 	} while (not doQuit && not std::cin.eof());
 
 	return 0;
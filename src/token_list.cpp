@@ -0,0 +1,142 @@
+#include "indexer/token_list.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace
+{
+constexpr std::size_t minSlots = 256;
+}
+
+bool Indexer::TokenList::contains(std::string_view token) const
+{
+	std::size_t low = 0;
+	std::size_t high = size();
+	while (low < high)
+	{
+		auto middle = low + (high - low) / 2;
+		if ((*this)[middle] < token)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	return low < size() && (*this)[low] == token;
+}
+
+Indexer::TokenList Indexer::TokenList::merged(TokenList const& a, TokenList const& b)
+{
+	TokenList list;
+	list.bytes.reserve(a.bytes.size() + b.bytes.size());
+	list.ends.reserve(a.size() + b.size());
+	std::size_t i = 0;
+	std::size_t j = 0;
+	while (i < a.size() || j < b.size())
+	{
+		std::string_view token;
+		if (j == b.size() || (i < a.size() && a[i] < b[j]))
+		{
+			token = a[i++];
+		}
+		else if (i == a.size() || b[j] < a[i])
+		{
+			token = b[j++];
+		}
+		else
+		{
+			token = a[i++];
+			j++;
+		}
+		list.bytes.append(token);
+		list.ends.push_back(static_cast<std::uint32_t>(list.bytes.size()));
+	}
+	return list;
+}
+
+Indexer::TokenList Indexer::TokenList::fromSorted(std::span<std::string_view const> tokens)
+{
+	assert(std::is_sorted(tokens.begin(), tokens.end()) && std::adjacent_find(tokens.begin(), tokens.end()) == tokens.end());
+	TokenList list;
+	std::size_t size = 0;
+	for (auto token: tokens)
+	{
+		size += token.size();
+	}
+	list.bytes.reserve(size);
+	list.ends.reserve(tokens.size());
+	for (auto token: tokens)
+	{
+		list.bytes.append(token);
+		list.ends.push_back(static_cast<std::uint32_t>(list.bytes.size()));
+	}
+	return list;
+}
+
+void Indexer::TokenCollector::insert(std::string_view newToken)
+{
+	if ((entries.size() + 1) * 2 > slots.size())  // at most half full, probe sequences stay short
+	{
+		grow();
+	}
+
+	auto hash = TokenHasher{}(newToken);
+	auto mask = slots.size() - 1;
+	auto slot = hash & mask;
+	while (slots[slot] != 0)
+	{
+		auto const& entry = entries[slots[slot] - 1];
+		if (entry.hash == hash && token(entry) == newToken)
+		{
+			return;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	if (arena.size() + newToken.size() > std::numeric_limits<std::uint32_t>::max())
+	{
+		return;  // 4 GiB of distinct tokens, it's not text anyway
+	}
+	entries.push_back({static_cast<std::uint32_t>(arena.size()), static_cast<std::uint32_t>(newToken.size()), hash, slot});
+	arena.append(newToken);
+	slots[slot] = static_cast<std::uint32_t>(entries.size());
+}
+
+Indexer::TokenList Indexer::TokenCollector::take()
+{
+	std::sort(entries.begin(), entries.end(), [this](auto const& a, auto const& b) { return token(a) < token(b); });
+
+	TokenList list;
+	list.bytes.reserve(arena.size());
+	list.ends.reserve(entries.size());
+	for (auto const& entry: entries)
+	{
+		list.bytes.append(token(entry));
+		list.ends.push_back(static_cast<std::uint32_t>(list.bytes.size()));
+		slots[entry.slot] = 0;  // cheaper than clearing every slot after a large file
+	}
+
+	arena.clear();
+	entries.clear();
+	return list;
+}
+
+void Indexer::TokenCollector::grow()
+{
+	std::vector<std::uint32_t> newSlots(std::max(minSlots, slots.size() * 2), 0);
+	auto mask = newSlots.size() - 1;
+	for (std::size_t i = 0; i < entries.size(); i++)
+	{
+		auto slot = entries[i].hash & mask;
+		while (newSlots[slot] != 0)
+		{
+			slot = (slot + 1) & mask;
+		}
+		newSlots[slot] = static_cast<std::uint32_t>(i + 1);
+		entries[i].slot = slot;
+	}
+	slots = std::move(newSlots);
+}
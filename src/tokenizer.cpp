@@ -0,0 +1,15 @@
+#include "indexer/tokenizer.h"
+
+#include "indexer/unicode.h"
+
+std::string Indexer::normalized(std::string_view needle, Normalization normalization)
+{
+	if (normalization != Normalization::FoldCase)
+	{
+		return std::string{needle};
+	}
+	std::string folded;
+	folded.reserve(needle.size());
+	Unicode::appendFolded(needle, folded);
+	return folded;
+}
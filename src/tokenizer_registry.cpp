@@ -0,0 +1,127 @@
+#include "indexer/tokenizer_registry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <limits>
+
+namespace
+{
+std::atomic<std::uint64_t> nextRegistryId{0};
+
+struct Pool
+{
+	std::uint64_t registry;
+	std::vector<std::unique_ptr<Indexer::Tokenizer>> tokenizers;  // by index, made on first use
+};
+
+// a thread mostly tokenizes for one or two indexers, the rest are those of registries gone by now
+constexpr std::size_t maxPoolsPerThread = 8;
+thread_local std::vector<Pool> pools;
+}
+
+Indexer::TokenizerRegistry::TokenizerRegistry()
+	: TokenizerRegistry{[]() { return std::make_unique<WordTokenizer>(); }}
+{
+}
+
+Indexer::TokenizerRegistry::TokenizerRegistry(Factory fallback)
+	: id{nextRegistryId++}
+{
+	add(Entry{std::nullopt, nullptr, std::move(fallback), nullptr});
+}
+
+Indexer::TokenizerRegistry& Indexer::TokenizerRegistry::add(std::string_view pattern, Factory factory)
+{
+	return add(Entry{Glob{pattern}, nullptr, std::move(factory), nullptr});
+}
+
+Indexer::TokenizerRegistry& Indexer::TokenizerRegistry::add(Sniffer sniffer, Factory factory)
+{
+	return add(Entry{std::nullopt, std::move(sniffer), std::move(factory), nullptr});
+}
+
+Indexer::TokenizerRegistry& Indexer::TokenizerRegistry::add(Entry entry)
+{
+	assert(entries.size() <= std::numeric_limits<Index>::max());
+	entry.normalizer = entry.factory();
+	entries.push_back(std::move(entry));
+	return *this;
+}
+
+Indexer::TokenizerRegistry Indexer::TokenizerRegistry::sourceCode()
+{
+	TokenizerRegistry registry;
+	auto identifiers = factoryOf(IdentifierTokenizer{});
+	for (auto pattern: {
+		"*.c", "*.cc", "*.cpp", "*.cxx", "*.h", "*.hh", "*.hpp", "*.hxx", "*.inl", "*.ipp",
+		"*.cs", "*.go", "*.java", "*.js", "*.jsx", "*.kt", "*.py", "*.rb", "*.rs", "*.swift", "*.ts", "*.tsx",
+		"*.sh", "*.bash", "*.zsh", "*.cmake", "CMakeLists.txt", "Makefile", "*.mk"})
+	{
+		registry.add(pattern, identifiers);
+	}
+	registry.add([](std::string_view contents) { return contents.starts_with("#!"); }, identifiers);
+	return registry;
+}
+
+Indexer::TokenizerRegistry::Index Indexer::TokenizerRegistry::select(std::filesystem::path const& path, std::string_view contents) const
+{
+	auto fullPath = path.generic_string();
+	auto fileName = path.filename().string();
+	for (std::size_t i = 1; i < entries.size(); i++)
+	{
+		if (auto const& pattern = entries[i].pattern)
+		{
+			auto matchesFullPath = pattern->pattern().find('/') != std::string::npos;
+			if (pattern->matches(matchesFullPath ? fullPath : fileName))
+			{
+				return static_cast<Index>(i);
+			}
+		}
+	}
+	for (std::size_t i = 1; i < entries.size(); i++)
+	{
+		if (entries[i].sniffer && entries[i].sniffer(contents))
+		{
+			return static_cast<Index>(i);
+		}
+	}
+	return 0;
+}
+
+Indexer::Tokenizer& Indexer::TokenizerRegistry::get(Index index) const
+{
+	auto pool = std::find_if(pools.begin(), pools.end(), [this](auto const& p) { return p.registry == id; });
+	if (pool == pools.end())
+	{
+		if (pools.size() == maxPoolsPerThread)
+		{
+			pools.erase(pools.begin());
+		}
+		pools.push_back(Pool{id, {}});
+		pool = std::prev(pools.end());
+	}
+	pool->tokenizers.resize(entries.size());
+	auto& tokenizer = pool->tokenizers[index];
+	if (not tokenizer)
+	{
+		tokenizer = entries[index].factory();
+	}
+	return *tokenizer;
+}
+
+std::vector<Indexer::TokenizerRegistry::Needle> Indexer::TokenizerRegistry::normalize(std::string_view needle) const
+{
+	std::vector<Needle> needles;
+	for (std::size_t i = 0; i < entries.size(); i++)
+	{
+		auto term = entries[i].normalizer->normalize(needle);
+		auto same = std::find_if(needles.begin(), needles.end(), [&](auto const& n) { return n.term == term; });
+		if (same == needles.end())
+		{
+			same = needles.insert(needles.end(), Needle{std::move(term), {}});
+		}
+		same->tokenizers.push_back(static_cast<Index>(i));
+	}
+	return needles;
+}
@@ -0,0 +1,92 @@
+#include "indexer/unicode_tokenizer.h"
+
+#include "indexer/unicode.h"
+
+namespace
+{
+struct Step
+{
+	bool isWord;
+	bool folds;
+};
+
+// classifies the character at `position` and moves past it, ASCII without decoding
+Step step(std::string_view text, std::size_t& position)
+{
+	auto byte = static_cast<unsigned char>(text[position]);
+	if (byte < 0x80)
+	{
+		position++;
+		return {Indexer::Unicode::Detail::asciiWordTable[byte], byte >= 'A' && byte <= 'Z'};
+	}
+	auto c = Indexer::Unicode::decode(text, position);
+	return {Indexer::Unicode::isWordCharacter(c), Indexer::Unicode::foldCase(c) != c};
+}
+}
+
+void Indexer::UnicodeTokenizer::sendLine(std::string_view newLine)
+{
+	source = newLine;
+	cursor = 0;
+	isDone = false;
+	findNext();
+}
+
+std::string_view Indexer::UnicodeTokenizer::next()
+{
+	auto token = nextToken;
+	if (needsFolding)
+	{
+		folded.clear();
+		Indexer::Unicode::appendFolded(token, folded);
+		token = folded;
+	}
+	findNext();
+	return token;
+}
+
+void Indexer::UnicodeTokenizer::findNext()
+{
+	if (isDone)
+	{
+		return;
+	}
+
+	std::size_t start = 0;
+	std::size_t end = 0;
+	bool isInWord = false;
+	bool folds = false;
+	while (true)
+	{
+		auto atEnd = cursor == source.size();
+		auto position = cursor;
+		auto current = atEnd ? Step{false, false} : step(source, cursor);
+		if (current.isWord)
+		{
+			if (not isInWord)
+			{
+				start = position;
+				isInWord = true;
+				folds = false;
+			}
+			folds = folds || current.folds;
+			end = cursor;
+		}
+		else if (isInWord)
+		{
+			isInWord = false;
+			if (end - start <= options.maxTokenBytes)
+			{
+				nextToken = source.substr(start, end - start);
+				needsFolding = options.foldCase && folds;
+				return;
+			}
+		}
+
+		if (atEnd)
+		{
+			isDone = true;
+			return;
+		}
+	}
+}
@@ -0,0 +1,168 @@
+#include "indexer/client.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Indexer
+{
+class ClientImpl
+{
+public:
+	explicit ClientImpl(std::filesystem::path const& socketPath)
+	{
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		auto const& name = socketPath.native();
+		if (name.size() >= sizeof(address.sun_path))
+		{
+			throw std::runtime_error{"Socket path is too long: " + socketPath.string()};
+		}
+		std::copy(name.begin(), name.end(), address.sun_path);
+
+		socketDescriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (socketDescriptor < 0)
+		{
+			throw std::system_error{errno, std::system_category(), "socket()"};
+		}
+		if (connect(socketDescriptor, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) < 0)
+		{
+			auto error = errno;
+			close(socketDescriptor);
+			throw std::system_error{error, std::system_category(), "connect(): " + socketPath.string()};
+		}
+	}
+
+	ClientImpl(ClientImpl const&) = delete;
+	ClientImpl& operator=(ClientImpl const&) = delete;
+
+	~ClientImpl()
+	{
+		close(socketDescriptor);
+	}
+
+	std::uint32_t send(Protocol::Request request)
+	{
+		request.id = nextId++;
+		Protocol::encode(request, output);
+		return request.id;
+	}
+
+	void flush()
+	{
+		std::size_t sent = 0;
+		while (sent < output.size())
+		{
+			auto size = ::send(socketDescriptor, output.data() + sent, output.size() - sent, MSG_NOSIGNAL);
+			if (size < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				throw std::system_error{errno, std::system_category(), "send()"};
+			}
+			sent += static_cast<std::size_t>(size);
+		}
+		output.clear();
+	}
+
+	Protocol::Response receive()
+	{
+		flush();
+		Protocol::Response response;
+		while (true)
+		{
+			if (auto size = Protocol::decode(std::string_view{input}.substr(inputRead), response))
+			{
+				inputRead += size;
+				if (inputRead == input.size())
+				{
+					input.clear();
+					inputRead = 0;
+				}
+				return response;
+			}
+
+			input.erase(0, inputRead);
+			inputRead = 0;
+			auto oldSize = input.size();
+			input.resize(oldSize + readSize);
+			auto size = recv(socketDescriptor, input.data() + oldSize, readSize, 0);
+			input.resize(oldSize + static_cast<std::size_t>(std::max<ssize_t>(size, 0)));
+			if (size == 0)
+			{
+				throw std::runtime_error{"The server closed the connection"};
+			}
+			if (size < 0 && errno != EINTR)
+			{
+				throw std::system_error{errno, std::system_category(), "recv()"};
+			}
+		}
+	}
+
+	Protocol::Response call(Protocol::Request request)
+	{
+		auto id = send(std::move(request));
+		auto response = receive();
+		if (response.id != id)
+		{
+			throw std::runtime_error{"Response to request " + std::to_string(response.id) + " while waiting for " + std::to_string(id)};
+		}
+		if (response.status == Protocol::Status::Error)
+		{
+			throw std::runtime_error{response.message};
+		}
+		return response;
+	}
+
+private:
+	static constexpr std::size_t readSize = 64 << 10;
+
+	int socketDescriptor{-1};
+	std::uint32_t nextId{1};
+	std::string output;
+	std::string input;
+	std::size_t inputRead{0};  // decoded already
+};
+
+Client::Client(std::filesystem::path const& socketPath): pImpl{std::make_unique<ClientImpl>(socketPath)} {}
+Client::Client(Client&&) = default;
+Client& Client::operator=(Client&&) = default;
+Client::~Client() = default;
+
+std::uint32_t Client::send(Protocol::Request request)
+{
+	return pImpl->send(std::move(request));
+}
+
+void Client::flush()
+{
+	pImpl->flush();
+}
+
+Protocol::Response Client::receive()
+{
+	return pImpl->receive();
+}
+
+void Client::add(std::filesystem::path const& path, bool isRecursive)
+{
+	pImpl->call({.opcode = Protocol::Opcode::Add, .arguments = {path.string()}, .isRecursive = isRecursive});
+}
+
+std::vector<std::vector<std::string>> Client::search(std::vector<std::string> terms)
+{
+	return pImpl->call({.opcode = Protocol::Opcode::Search, .arguments = std::move(terms)}).results;
+}
+
+std::string Client::stats()
+{
+	return pImpl->call({.opcode = Protocol::Opcode::Stats}).message;
+}
+}
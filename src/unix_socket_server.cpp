@@ -0,0 +1,425 @@
+#include "indexer/server.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "indexer/indexer.h"
+#include "indexer/protocol.h"
+
+namespace
+{
+class Descriptor
+{
+public:
+	explicit Descriptor(int descriptor_ = -1): descriptor{descriptor_} {}
+	Descriptor(Descriptor&& other): descriptor{std::exchange(other.descriptor, -1)} {}
+	Descriptor& operator=(Descriptor&& other)
+	{
+		std::swap(descriptor, other.descriptor);
+		return *this;
+	}
+	~Descriptor()
+	{
+		if (descriptor >= 0)
+		{
+			close(descriptor);
+		}
+	}
+
+	[[nodiscard]] int get() const { return descriptor; }
+
+private:
+	int descriptor;
+};
+
+int check(int result, char const* call)
+{
+	if (result < 0)
+	{
+		throw std::system_error{errno, std::system_category(), call};
+	}
+	return result;
+}
+}
+
+namespace Indexer
+{
+class ServerImpl
+{
+public:
+	ServerImpl(Indexer& indexer_, std::filesystem::path socketPath_)
+		: indexer{indexer_}
+		, socketPath{std::move(socketPath_)}
+	{
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		auto const& name = socketPath.native();
+		if (name.size() >= sizeof(address.sun_path))
+		{
+			throw std::runtime_error{"Socket path is too long: " + socketPath.string()};
+		}
+		std::copy(name.begin(), name.end(), address.sun_path);
+
+		if (std::filesystem::is_socket(socketPath))  // left behind by a server that didn't shut down
+		{
+			std::filesystem::remove(socketPath);
+		}
+
+		listener = Descriptor{check(socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0), "socket()")};
+		check(bind(listener.get(), reinterpret_cast<sockaddr const*>(&address), sizeof(address)), "bind()");
+		isBound = true;
+		check(listen(listener.get(), SOMAXCONN), "listen()");
+
+		epoll = Descriptor{check(epoll_create1(EPOLL_CLOEXEC), "epoll_create1()")};
+		stopEvent = Descriptor{check(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), "eventfd()")};
+		watch(listener.get(), EPOLLIN, EPOLL_CTL_ADD);
+		watch(stopEvent.get(), EPOLLIN, EPOLL_CTL_ADD);
+	}
+
+	ServerImpl(ServerImpl const&) = delete;
+	ServerImpl& operator=(ServerImpl const&) = delete;
+
+	~ServerImpl()
+	{
+		if (isBound)
+		{
+			std::error_code errorCode;
+			std::filesystem::remove(socketPath, errorCode);
+		}
+	}
+
+	void run()
+	{
+		std::array<epoll_event, 64> events;
+		bool isStopping = false;
+		while (not isStopping)
+		{
+			auto timeout = pendingAdds.empty() ? -1 : addPollInterval;
+			auto count = epoll_wait(epoll.get(), events.data(), static_cast<int>(events.size()), timeout);
+			if (count < 0 && errno != EINTR)
+			{
+				throw std::system_error{errno, std::system_category(), "epoll_wait()"};
+			}
+
+			for (int i = 0; i < count; i++)
+			{
+				auto descriptor = events[static_cast<std::size_t>(i)].data.fd;
+				if (descriptor == listener.get())
+				{
+					acceptConnections();
+				}
+				else if (descriptor == stopEvent.get())
+				{
+					isStopping = true;
+				}
+				else
+				{
+					serve(descriptor, events[static_cast<std::size_t>(i)].events);
+				}
+			}
+			finishAdds();
+		}
+		connections.clear();
+		pendingAdds.clear();
+	}
+
+	void requestStop()
+	{
+		std::uint64_t one = 1;
+		[[maybe_unused]] auto written = write(stopEvent.get(), &one, sizeof(one));
+	}
+
+private:
+	static constexpr int addPollInterval = 10;  // ms, while adds are running
+	static constexpr std::size_t readSize = 64 << 10;
+	static constexpr std::size_t maxBufferedOutput = 4 << 20;  // stop reading a client's requests past this
+
+	struct Connection
+	{
+		Descriptor socket;
+		std::uint64_t serial;  // descriptors are reused
+		std::string input{};
+		std::string output{};
+		std::size_t outputSent{0};
+		std::uint32_t interest{0};  // epoll events we're registered for
+		unsigned runningAdds{0};
+		bool isPeerDone{false};  // nothing more to read, close once answered
+	};
+
+	struct PendingAdd
+	{
+		int descriptor;
+		std::uint64_t serial;
+		std::uint32_t requestId;
+		IndexingTask task;
+	};
+
+	void watch(int descriptor, std::uint32_t events, int operation)
+	{
+		epoll_event event{};
+		event.events = events;
+		event.data.fd = descriptor;
+		check(epoll_ctl(epoll.get(), operation, descriptor, &event), "epoll_ctl()");
+	}
+
+	void acceptConnections()
+	{
+		while (true)
+		{
+			auto descriptor = accept4(listener.get(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if (descriptor < 0)
+			{
+				if (errno == EINTR || errno == ECONNABORTED)
+				{
+					continue;
+				}
+				if (errno != EAGAIN)
+				{
+					std::cerr << "accept4(): " << std::strerror(errno) << '\n';
+				}
+				return;
+			}
+			auto& connection = connections.insert_or_assign(descriptor, Connection{.socket = Descriptor{descriptor}, .serial = nextSerial++}).first->second;
+			connection.interest = EPOLLIN;
+			watch(descriptor, connection.interest, EPOLL_CTL_ADD);
+		}
+	}
+
+	void serve(int descriptor, std::uint32_t events)
+	{
+		auto it = connections.find(descriptor);
+		if (it == connections.end())
+		{
+			return;
+		}
+		auto& connection = it->second;
+
+		// hung up after we'd already read to the end, there is nobody left to answer
+		bool isBroken = (events & EPOLLERR) || ((events & EPOLLHUP) && connection.isPeerDone);
+		if (not isBroken && (events & (EPOLLIN | EPOLLHUP)) && not connection.isPeerDone)
+		{
+			isBroken = not receive(connection);
+		}
+		if (not isBroken && not connection.output.empty())
+		{
+			isBroken = not flush(connection);
+		}
+		update(connection, isBroken);
+	}
+
+	// reads whatever is there and answers every whole request in it, the answers go out together
+	bool receive(Connection& connection)
+	{
+		char buffer[readSize];
+		while (connection.output.size() - connection.outputSent < maxBufferedOutput)
+		{
+			auto size = recv(connection.socket.get(), buffer, sizeof(buffer), 0);
+			if (size == 0)
+			{
+				connection.isPeerDone = true;
+				break;
+			}
+			if (size < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				if (errno == EAGAIN)
+				{
+					break;
+				}
+				return false;
+			}
+			connection.input.append(buffer, static_cast<std::size_t>(size));
+
+			std::size_t offset = 0;
+			try
+			{
+				Protocol::Request request;
+				while (auto frameSize = Protocol::decode(std::string_view{connection.input}.substr(offset), request))
+				{
+					offset += frameSize;
+					handle(connection, std::move(request));
+				}
+			}
+			catch (Protocol::ProtocolError const& e)
+			{
+				std::cerr << "Dropping a client: " << e.what() << '\n';
+				return false;
+			}
+			connection.input.erase(0, offset);
+		}
+		return true;
+	}
+
+	void handle(Connection& connection, Protocol::Request request)
+	{
+		Protocol::Response response{.id = request.id, .opcode = request.opcode};
+		try
+		{
+			switch (request.opcode)
+			{
+				case Protocol::Opcode::Add:
+				{
+					std::filesystem::path path{request.arguments.front()};
+					if (path.empty() || path.is_relative())  // would resolve against our working directory, not the client's
+					{
+						throw std::invalid_argument{"Add needs an absolute path, got \"" + path.string() + "\""};
+					}
+					pendingAdds.push_back({
+						connection.socket.get(), connection.serial, request.id,
+						indexer.addPathAsync(path, request.isRecursive ? Recursive::Yes : Recursive::No, {}, Priority::Normal),
+					});
+					connection.runningAdds++;
+					return;  // answered by finishAdds()
+				}
+
+				case Protocol::Opcode::Search:
+					for (auto const& term: request.arguments)
+					{
+						auto& paths = response.results.emplace_back();
+						for (auto const& path: indexer.search(term))
+						{
+							paths.push_back(path.string());
+						}
+					}
+					break;
+
+				case Protocol::Opcode::Stats:
+				{
+					std::ostringstream stats;
+					stats << indexer.stats();
+					response.message = stats.str();
+					break;
+				}
+			}
+		}
+		catch (std::exception const& e)
+		{
+			response = Protocol::Response{.id = request.id, .opcode = request.opcode, .status = Protocol::Status::Error, .message = e.what()};
+		}
+		respond(connection, response);
+	}
+
+	static void respond(Connection& connection, Protocol::Response const& response)
+	{
+		try
+		{
+			Protocol::encode(response, connection.output);
+		}
+		catch (Protocol::ProtocolError const& e)  // too large to send
+		{
+			Protocol::encode(Protocol::Response{.id = response.id, .opcode = response.opcode, .status = Protocol::Status::Error, .message = e.what()}, connection.output);
+		}
+	}
+
+	bool flush(Connection& connection)
+	{
+		while (connection.outputSent < connection.output.size())
+		{
+			auto size = send(connection.socket.get(), connection.output.data() + connection.outputSent,
+				connection.output.size() - connection.outputSent, MSG_NOSIGNAL);
+			if (size < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				return errno == EAGAIN;  // the rest once EPOLLOUT says so
+			}
+			connection.outputSent += static_cast<std::size_t>(size);
+		}
+		connection.output.clear();
+		connection.outputSent = 0;
+		return true;
+	}
+
+	// closes the connection once there's nothing more to do on it, or else waits for what's next
+	void update(Connection& connection, bool isBroken)
+	{
+		auto hasOutput = connection.outputSent < connection.output.size();
+		if (isBroken || (connection.isPeerDone && not hasOutput && connection.runningAdds == 0))
+		{
+			connections.erase(connection.socket.get());  // closing it takes it out of epoll
+			return;
+		}
+
+		std::uint32_t interest = 0;
+		if (not connection.isPeerDone && connection.output.size() - connection.outputSent < maxBufferedOutput)
+		{
+			interest |= EPOLLIN;
+		}
+		if (hasOutput)
+		{
+			interest |= EPOLLOUT;
+		}
+		if (interest != connection.interest)
+		{
+			connection.interest = interest;
+			watch(connection.socket.get(), interest, EPOLL_CTL_MOD);
+		}
+	}
+
+	void finishAdds()
+	{
+		std::erase_if(pendingAdds, [this](PendingAdd const& add)
+		{
+			if (not add.task.isDone())
+			{
+				return false;
+			}
+			auto it = connections.find(add.descriptor);
+			if (it != connections.end() && it->second.serial == add.serial)  // still the same client
+			{
+				auto& connection = it->second;
+				connection.runningAdds--;
+				respond(connection, Protocol::Response{.id = add.requestId, .opcode = Protocol::Opcode::Add});
+				update(connection, not flush(connection));
+			}
+			return true;
+		});
+	}
+
+	Indexer& indexer;
+	std::filesystem::path socketPath;
+	bool isBound{false};
+
+	Descriptor listener;
+	Descriptor epoll;
+	Descriptor stopEvent;
+
+	std::unordered_map<int, Connection> connections;
+	std::uint64_t nextSerial{0};
+	std::vector<PendingAdd> pendingAdds;
+};
+
+Server::Server(Indexer& indexer, std::filesystem::path socketPath): pImpl{std::make_unique<ServerImpl>(indexer, std::move(socketPath))} {}
+Server::~Server() = default;
+
+void Server::run()
+{
+	pImpl->run();
+}
+
+void Server::requestStop()
+{
+	pImpl->requestStop();
+}
+}
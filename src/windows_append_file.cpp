@@ -0,0 +1,109 @@
+#include "indexer/append_file.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include <Windows.h>
+
+namespace Indexer
+{
+class AppendFileImpl
+{
+public:
+	AppendFileImpl(std::filesystem::path const& path_)
+		: path{path_}
+	{
+		file = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE,
+			nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			fail("CreateFileW()");
+		}
+	}
+
+	AppendFileImpl(AppendFileImpl const&) = delete;
+	AppendFileImpl& operator=(AppendFileImpl const&) = delete;
+
+	~AppendFileImpl()
+	{
+		CloseHandle(file);
+	}
+
+	void append(std::string_view data)
+	{
+		seekToEnd();
+		while (not data.empty())
+		{
+			DWORD written = 0;
+			auto chunk = static_cast<DWORD>(std::min<std::size_t>(data.size(), 1 << 30));
+			if (not WriteFile(file, data.data(), chunk, &written, nullptr))
+			{
+				fail("WriteFile()");
+			}
+			data.remove_prefix(written);
+		}
+	}
+
+	void sync()
+	{
+		if (not FlushFileBuffers(file))
+		{
+			fail("FlushFileBuffers()");
+		}
+	}
+
+	void truncate(std::uint64_t size)
+	{
+		LARGE_INTEGER position;
+		position.QuadPart = static_cast<LONGLONG>(size);
+		if (not SetFilePointerEx(file, position, nullptr, FILE_BEGIN) || not SetEndOfFile(file))
+		{
+			fail("SetEndOfFile()");
+		}
+	}
+
+private:
+	void seekToEnd()
+	{
+		LARGE_INTEGER zero{};
+		if (not SetFilePointerEx(file, zero, nullptr, FILE_END))
+		{
+			fail("SetFilePointerEx()");
+		}
+	}
+
+	[[noreturn]] void fail(char const* call) const
+	{
+		throw std::runtime_error{std::string{call} + ": " + path.string() + ": error " + std::to_string(GetLastError())};
+	}
+
+	std::filesystem::path path;
+	HANDLE file{INVALID_HANDLE_VALUE};
+};
+
+AppendFile::AppendFile(std::filesystem::path const& path): pImpl{std::make_unique<AppendFileImpl>(path)} {}
+AppendFile::AppendFile(AppendFile&&) = default;
+AppendFile& AppendFile::operator=(AppendFile&&) = default;
+AppendFile::~AppendFile() = default;
+
+void AppendFile::append(std::string_view data)
+{
+	pImpl->append(data);
+}
+
+void AppendFile::sync()
+{
+	pImpl->sync();
+}
+
+void AppendFile::truncate(std::uint64_t size)
+{
+	pImpl->truncate(size);
+}
+
+void AppendFile::syncDirectoryOf(std::filesystem::path const&)
+{
+	// NTFS journals renames along with the rest of its metadata, directories can't be flushed on their own
+}
+}
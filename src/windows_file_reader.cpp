@@ -0,0 +1,24 @@
+#include "indexer/file_reader.h"
+
+namespace Indexer
+{
+// no batched reads here yet, callers read each file themselves
+class FileReaderImpl
+{
+};
+
+FileReader::FileReader(unsigned): pImpl{std::make_unique<FileReaderImpl>()} {}
+FileReader::FileReader(FileReader&&) = default;
+FileReader& FileReader::operator=(FileReader&&) = default;
+FileReader::~FileReader() = default;
+
+bool FileReader::isAvailable() const
+{
+	return false;
+}
+
+std::vector<std::optional<std::string>> FileReader::read(std::span<std::filesystem::path const> paths, std::uintmax_t)
+{
+	return std::vector<std::optional<std::string>>(paths.size());
+}
+}
@@ -0,0 +1,78 @@
+#include "indexer/mapped_file.h"
+
+#include <stdexcept>
+#include <string>
+
+#include <Windows.h>
+
+namespace Indexer
+{
+class MappedFileImpl
+{
+public:
+	MappedFileImpl(std::filesystem::path const& path)
+	{
+		auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			throw std::runtime_error{"CreateFileW(): " + path.string() + ": error " + std::to_string(GetLastError())};
+		}
+
+		LARGE_INTEGER fileSize;
+		if (not GetFileSizeEx(file, &fileSize))
+		{
+			auto error = GetLastError();
+			CloseHandle(file);
+			throw std::runtime_error{"GetFileSizeEx(): " + path.string() + ": error " + std::to_string(error)};
+		}
+		size = static_cast<std::size_t>(fileSize.QuadPart);
+
+		if (size > 0)  // mapping nothing is an error
+		{
+			auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping != nullptr)
+			{
+				data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				CloseHandle(mapping);  // the view keeps the mapping alive
+			}
+		}
+		auto error = GetLastError();
+		CloseHandle(file);
+		if (size > 0 && data == nullptr)
+		{
+			throw std::runtime_error{"MapViewOfFile(): " + path.string() + ": error " + std::to_string(error)};
+		}
+	}
+
+	MappedFileImpl(MappedFileImpl const&) = delete;
+	MappedFileImpl& operator=(MappedFileImpl const&) = delete;
+
+	~MappedFileImpl()
+	{
+		if (data != nullptr)
+		{
+			UnmapViewOfFile(data);
+		}
+	}
+
+	std::string_view contents() const
+	{
+		return data != nullptr ? std::string_view{static_cast<char const*>(data), size} : std::string_view{};
+	}
+
+private:
+	void* data{nullptr};
+	std::size_t size{0};
+};
+
+MappedFile::MappedFile(std::filesystem::path const& path): pImpl{std::make_unique<MappedFileImpl>(path)} {}
+MappedFile::MappedFile(MappedFile&&) = default;
+MappedFile& MappedFile::operator=(MappedFile&&) = default;
+MappedFile::~MappedFile() = default;
+
+std::string_view MappedFile::contents() const
+{
+	return pImpl->contents();
+}
+}
@@ -0,0 +1,451 @@
+#include "indexer/write_ahead_log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "indexer/content_hash.h"
+#include "indexer/mapped_file.h"
+
+namespace
+{
+using Change = Indexer::WriteAheadLog::Change;
+
+constexpr char magic[8] = {'I', 'D', 'X', 'W', 'A', 'L', '0', '1'};
+constexpr std::size_t headerSize = sizeof(magic) + sizeof(std::uint64_t);
+constexpr std::size_t recordHeaderSize = sizeof(std::uint32_t) + sizeof(std::uint64_t);  // length, checksum
+
+template <class T>
+void putFixed(std::string& out, T value)
+{
+	char bytes[sizeof(T)];
+	std::memcpy(bytes, &value, sizeof(T));
+	out.append(bytes, sizeof(T));
+}
+
+void putVarint(std::string& out, std::uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		out += static_cast<char>(value | 0x80);
+		value >>= 7;
+	}
+	out += static_cast<char>(value);
+}
+
+void putString(std::string& out, std::string_view value)
+{
+	putVarint(out, value.size());
+	out.append(value);
+}
+
+// reads what was put, running dry marks it as failed rather than throwing mid-record
+struct Reader
+{
+	std::string_view data;
+	bool isValid{true};
+
+	template <class T>
+	T fixed()
+	{
+		T value{};
+		if (data.size() < sizeof(T))
+		{
+			isValid = false;
+			return value;
+		}
+		std::memcpy(&value, data.data(), sizeof(T));
+		data.remove_prefix(sizeof(T));
+		return value;
+	}
+
+	std::uint64_t varint()
+	{
+		std::uint64_t value = 0;
+		for (unsigned shift = 0; shift < 64; shift += 7)
+		{
+			if (data.empty())
+			{
+				break;
+			}
+			auto byte = static_cast<unsigned char>(data.front());
+			data.remove_prefix(1);
+			value |= std::uint64_t{byte & 0x7fu} << shift;
+			if (byte < 0x80)
+			{
+				return value;
+			}
+		}
+		isValid = false;
+		return 0;
+	}
+
+	std::string_view string()
+	{
+		auto size = varint();
+		if (size > data.size())
+		{
+			isValid = false;
+			return {};
+		}
+		auto value = data.substr(0, size);
+		data.remove_prefix(size);
+		return value;
+	}
+};
+
+std::string header(std::uint64_t baseSequence)
+{
+	std::string out{magic, sizeof(magic)};
+	putFixed(out, baseSequence);
+	return out;
+}
+
+std::uint64_t baseSequenceOf(std::string_view contents, std::filesystem::path const& file)
+{
+	if (contents.size() < headerSize || std::memcmp(contents.data(), magic, sizeof(magic)) != 0)
+	{
+		throw std::runtime_error{"Not a valid write-ahead log: " + file.string()};
+	}
+	return Reader{contents.substr(sizeof(magic))}.fixed<std::uint64_t>();
+}
+
+void encode(std::uint64_t sequence, Change const& change, std::string& out)
+{
+	auto start = out.size();
+	out.append(recordHeaderSize, '\0');
+	putFixed(out, sequence);
+	out += static_cast<char>(change.type);
+	putString(out, change.path);
+	switch (change.type)
+	{
+	case Change::Type::Indexed:
+	{
+		putVarint(out, change.size);
+		putVarint(out, static_cast<std::uint64_t>(change.lastWriteTime));
+		putVarint(out, static_cast<std::uint64_t>(change.indexedAt));
+		putFixed(out, change.contentHash);
+		putVarint(out, change.tokenizer);
+		static Indexer::TokenList const noTokens;
+		auto const& tokens = change.tokens ? *change.tokens : noTokens;
+		putVarint(out, tokens.size());
+		std::string_view previous;
+		for (auto token: tokens)  // sorted, so each shares a good part of the previous one
+		{
+			auto shared = static_cast<std::size_t>(std::mismatch(token.begin(), token.end(), previous.begin(), previous.end()).first - token.begin());
+			putVarint(out, shared);
+			putString(out, token.substr(shared));
+			previous = token;
+		}
+		break;
+	}
+	case Change::Type::Removed:
+		break;
+	case Change::Type::Moved:
+		putString(out, change.target);
+		out += static_cast<char>(change.isDirectory);
+		break;
+	}
+
+	auto body = std::string_view{out}.substr(start + recordHeaderSize);
+	auto length = static_cast<std::uint32_t>(body.size());
+	auto checksum = Indexer::ContentHasher::hash(body);
+	std::memcpy(out.data() + start, &length, sizeof(length));
+	std::memcpy(out.data() + start + sizeof(length), &checksum, sizeof(checksum));
+}
+
+Change decode(std::string_view body)
+{
+	Reader in{body};
+	in.fixed<std::uint64_t>();  // the sequence, see scan()
+	Change change{};
+	change.type = static_cast<Change::Type>(in.fixed<std::uint8_t>());
+	change.path = in.string();
+	switch (change.type)
+	{
+	case Change::Type::Indexed:
+	{
+		change.size = in.varint();
+		change.lastWriteTime = static_cast<std::int64_t>(in.varint());
+		change.indexedAt = static_cast<std::int64_t>(in.varint());
+		change.contentHash = in.fixed<std::uint64_t>();
+		change.tokenizer = in.varint();
+		auto count = in.varint();
+		std::vector<std::string> tokens;
+		tokens.reserve(std::min<std::uint64_t>(count, body.size()));
+		for (std::uint64_t i = 0; i < count && in.isValid; i++)
+		{
+			auto shared = in.varint();
+			auto suffix = in.string();
+			if (shared > (tokens.empty() ? 0 : tokens.back().size()))
+			{
+				in.isValid = false;
+				break;
+			}
+			auto token = tokens.empty() ? std::string{} : tokens.back().substr(0, shared);
+			token += suffix;
+			if (not tokens.empty() && token <= tokens.back())
+			{
+				in.isValid = false;
+				break;
+			}
+			tokens.push_back(std::move(token));
+		}
+		std::vector<std::string_view> views{tokens.begin(), tokens.end()};
+		change.tokens = std::make_shared<Indexer::TokenList>(Indexer::TokenList::fromSorted(views));
+		break;
+	}
+	case Change::Type::Removed:
+		break;
+	case Change::Type::Moved:
+		change.target = in.string();
+		change.isDirectory = in.fixed<std::uint8_t>() != 0;
+		break;
+	default:
+		in.isValid = false;
+	}
+	if (not in.isValid || not in.data.empty())
+	{
+		throw std::runtime_error{"Corrupt write-ahead log record"};  // its checksum matched, so written that way
+	}
+	return change;
+}
+
+// calls `onRecord(sequence, record, body)` for each intact record in order, returns where they end
+template <class F>
+std::size_t scan(std::string_view contents, std::uint64_t baseSequence, F&& onRecord)
+{
+	auto position = headerSize;
+	auto previous = baseSequence;
+	while (contents.size() - position >= recordHeaderSize)
+	{
+		Reader in{contents.substr(position)};
+		auto length = in.fixed<std::uint32_t>();
+		auto checksum = in.fixed<std::uint64_t>();
+		if (length > in.data.size() || length < sizeof(std::uint64_t) + 1)
+		{
+			break;  // torn
+		}
+		auto body = in.data.substr(0, length);
+		auto sequence = Reader{body}.fixed<std::uint64_t>();
+		if (Indexer::ContentHasher::hash(body) != checksum || sequence <= previous)
+		{
+			break;
+		}
+		onRecord(sequence, contents.substr(position, recordHeaderSize + length), body);
+		previous = sequence;
+		position += recordHeaderSize + length;
+	}
+	return position;
+}
+}
+
+Indexer::WriteAheadLog::WriteAheadLog(std::filesystem::path file_, Options options_)
+	: file{std::move(file_)}
+	, options{options_}
+{
+	std::error_code errorCode;
+	if (std::filesystem::file_size(file, errorCode) < headerSize || errorCode)  // missing, or torn before its header was written
+	{
+		output.emplace(file);
+		output->truncate(0);
+		output->append(header(0));
+		output->sync();
+	}
+	else
+	{
+		std::size_t validEnd = 0;
+		std::size_t size = 0;
+		{
+			MappedFile mapped{file};
+			auto contents = mapped.contents();
+			appendedSequence = baseSequenceOf(contents, file);
+			validEnd = scan(contents, appendedSequence, [this](std::uint64_t sequence, auto, auto) { appendedSequence = sequence; });
+			size = contents.size();
+		}
+		output.emplace(file);
+		if (validEnd < size)  // cut off by a crash mid-write, appends go after the last intact record
+		{
+			output->truncate(validEnd);
+			output->sync();
+		}
+	}
+	committedSequence = appendedSequence;
+	flusher = std::thread{[this]() { flush(); }};
+}
+
+Indexer::WriteAheadLog::~WriteAheadLog()
+{
+	{
+		std::lock_guard pin{mutex};
+		isStopping = true;
+	}
+	wakeFlusher.notify_one();
+	flusher.join();
+}
+
+void Indexer::WriteAheadLog::replay(std::uint64_t afterSequence, std::function<void(Change)> const& onChange)
+{
+	sync();
+	std::optional<MappedFile> mapped;
+	{
+		std::lock_guard filePin{fileMutex};
+		mapped.emplace(file);
+	}
+	auto contents = mapped->contents();
+	scan(contents, baseSequenceOf(contents, file), [&](std::uint64_t sequence, auto, std::string_view body)
+	{
+		if (sequence > afterSequence)
+		{
+			onChange(decode(body));
+		}
+	});
+}
+
+std::uint64_t Indexer::WriteAheadLog::append(Change const& change)
+{
+	std::unique_lock pin{mutex};
+	committed.wait(pin, [this]() { return pending.size() < options.maxBatchBytes || isDisabled; });  // the disk is falling behind
+	if (isDisabled)
+	{
+		return appendedSequence;
+	}
+	auto wasEmpty = pending.empty();
+	encode(++appendedSequence, change, pending);
+	if (wasEmpty || pending.size() >= options.maxBatchBytes)
+	{
+		wakeFlusher.notify_one();
+	}
+	return appendedSequence;
+}
+
+void Indexer::WriteAheadLog::sync()
+{
+	std::unique_lock pin{mutex};
+	auto sequence = appendedSequence;
+	if (not pending.empty())
+	{
+		isSyncRequested = true;  // no point waiting out the interval
+		wakeFlusher.notify_one();
+	}
+	committed.wait(pin, [&]() { return committedSequence >= sequence || isDisabled; });
+}
+
+std::uint64_t Indexer::WriteAheadLog::lastSequence() const
+{
+	std::lock_guard pin{mutex};
+	return appendedSequence;
+}
+
+void Indexer::WriteAheadLog::truncateThrough(std::uint64_t sequence)
+{
+	sync();
+	std::lock_guard filePin{fileMutex};
+	{
+		std::lock_guard pin{mutex};
+		if (isDisabled)
+		{
+			return;
+		}
+		if (appendedSequence < sequence)  // the log was lost or is older than the snapshot
+		{
+			appendedSequence = sequence;
+			committedSequence = sequence;
+		}
+	}
+
+	try
+	{
+		auto kept = header(sequence);
+		{
+			MappedFile mapped{file};
+			auto contents = mapped.contents();
+			auto baseSequence = baseSequenceOf(contents, file);
+			if (baseSequence >= sequence)
+			{
+				return;  // truncated that far already
+			}
+			scan(contents, baseSequence, [&](std::uint64_t recordSequence, std::string_view record, auto)
+			{
+				if (recordSequence > sequence)  // appended since the snapshot was taken
+				{
+					kept.append(record);
+				}
+			});
+		}
+
+		// a crash leaves either log whole, the old one only holds more records that replay skips
+		auto temporary = file;
+		temporary += ".tmp";
+		{
+			AppendFile newLog{temporary};
+			newLog.truncate(0);
+			newLog.append(kept);
+			newLog.sync();
+		}
+		output.reset();  // some platforms won't rename over an open file
+		std::filesystem::rename(temporary, file);
+		AppendFile::syncDirectoryOf(file);
+		output.emplace(file);
+	}
+	catch (std::exception const& e)
+	{
+		std::lock_guard pin{mutex};
+		disable(e);
+	}
+}
+
+void Indexer::WriteAheadLog::flush()
+{
+	std::string batch;
+	std::unique_lock pin{mutex};
+	while (true)
+	{
+		wakeFlusher.wait(pin, [this]() { return isStopping || not pending.empty(); });
+		if (pending.empty())
+		{
+			return;  // stopping, with everything committed
+		}
+		// whatever else comes in meanwhile shares the write and the sync
+		wakeFlusher.wait_for(pin, options.commitInterval, [this]() {
+			return isStopping || isSyncRequested || pending.size() >= options.maxBatchBytes;
+		});
+		batch.swap(pending);
+		auto sequence = appendedSequence;
+		isSyncRequested = false;
+		pin.unlock();
+		committed.notify_all();  // room for appends held back by maxBatchBytes
+
+		try
+		{
+			std::lock_guard filePin{fileMutex};
+			if (output)  // otherwise disabled by a failed truncation
+			{
+				output->append(batch);
+				output->sync();
+			}
+		}
+		catch (std::exception const& e)
+		{
+			pin.lock();
+			disable(e);
+			pin.unlock();
+		}
+		batch.clear();
+
+		pin.lock();
+		committedSequence = std::max(committedSequence, sequence);
+		committed.notify_all();
+	}
+}
+
+void Indexer::WriteAheadLog::disable(std::exception const& e)
+{
+	std::cerr << e.what() << '\n';
+	std::cerr << "Write-ahead log disabled\n";
+	isDisabled = true;
+	pending.clear();
+	committed.notify_all();
+}
@@ -1,5 +1,8 @@
 #include <catch2/catch_test_macros.hpp>
 
+#include <chrono>
+#include <thread>
+
 #include "indexer/indexer.h"
 
 #include "filesystem_utils.h"
@@ -74,3 +77,91 @@ TEST_CASE("Path normalization test")
 	}
 	std::filesystem::remove(test);
 }
+
+TEST_CASE("File id reuse")
+{
+	auto testDir = std::filesystem::current_path() / "__test_dir";
+	std::filesystem::create_directory(testDir);
+
+	Indexer::Indexer indexer;
+	std::vector<std::filesystem::path> files;
+	for (int i = 0; i < 8; i++)
+	{
+		files.push_back(testDir / ("__file" + std::to_string(i)));
+		write(files.back(), "TEST\nFILE" + std::to_string(i) + "\n");
+	}
+	indexer.addPath(testDir);
+
+	SECTION("Compaction keeps every file findable")
+	{
+		for (int i = 0; i < 8; i += 2)
+		{
+			std::filesystem::remove(files[static_cast<std::size_t>(i)]);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds{50});  // allow the watcher to catch up
+
+		indexer.compactFileIds();
+
+		auto found = indexer.search("TEST");
+		REQUIRE(found.size() == 4);
+		for (int i = 1; i < 8; i += 2)
+		{
+			auto const& file = files[static_cast<std::size_t>(i)];
+			REQUIRE(found.contains(file));
+			REQUIRE(indexer.search("FILE" + std::to_string(i)) == Indexer::PathSet{file});
+		}
+	}
+
+	std::filesystem::remove_all(testDir);
+}
+
+TEST_CASE("Scoped search")
+{
+	auto testDir = std::filesystem::current_path() / "__test_scoped_dir";
+	std::filesystem::create_directories(testDir / "src" / "net");
+	std::filesystem::create_directories(testDir / "docs");
+	write(testDir / "src" / "main.cpp", "TODO\n");
+	write(testDir / "src" / "net" / "socket.cpp", "TODO\n");
+	write(testDir / "docs" / "guide", "TODO\n");
+	write(testDir / "README", "TODO\n");
+
+	Indexer::Indexer indexer;
+	indexer.addPath(testDir, Indexer::Recursive::Yes);
+
+	auto check = [&]()
+	{
+		REQUIRE(indexer.search("TODO", testDir / "src") == Indexer::PathSet{testDir / "src" / "main.cpp", testDir / "src" / "net" / "socket.cpp"});
+		REQUIRE(indexer.search("TODO", testDir / "src" / "net") == Indexer::PathSet{testDir / "src" / "net" / "socket.cpp"});
+		REQUIRE(indexer.search("TODO", testDir / "docs" / "") == Indexer::PathSet{testDir / "docs" / "guide"});
+		REQUIRE(indexer.search("TODO", testDir) == indexer.search("TODO"));
+		REQUIRE(indexer.search("TODO", testDir / "missing").empty());
+		REQUIRE(indexer.search("OTHER", testDir / "src").empty());
+	};
+
+	SECTION("Before and after the ids are laid out by directory")
+	{
+		check();
+		indexer.compactFileIds();
+		check();
+	}
+
+	SECTION("Following changes since the layout")
+	{
+		indexer.compactFileIds();
+		std::filesystem::remove(testDir / "src" / "main.cpp");
+		write(testDir / "docs" / "faq", "TODO\n");  // may reuse the freed id, inside the range of src
+		std::this_thread::sleep_for(std::chrono::milliseconds{50});  // allow the watcher to catch up
+
+		REQUIRE(indexer.search("TODO", testDir / "src") == Indexer::PathSet{testDir / "src" / "net" / "socket.cpp"});
+		REQUIRE(indexer.search("TODO", testDir / "docs") == Indexer::PathSet{testDir / "docs" / "guide", testDir / "docs" / "faq"});
+
+		std::filesystem::rename(testDir / "src" / "net", testDir / "docs" / "net");
+		std::this_thread::sleep_for(std::chrono::milliseconds{50});
+
+		REQUIRE(indexer.search("TODO", testDir / "src").empty());
+		REQUIRE(indexer.search("TODO", testDir / "docs").size() == 3);
+		REQUIRE(indexer.search("TODO", testDir / "docs" / "net") == Indexer::PathSet{testDir / "docs" / "net" / "socket.cpp"});
+	}
+
+	std::filesystem::remove_all(testDir);
+}
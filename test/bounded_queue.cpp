@@ -0,0 +1,78 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "indexer/bounded_queue.h"
+
+TEST_CASE("Bounded queue")
+{
+	SECTION("Is first in, first out")
+	{
+		Indexer::BoundedQueue<int> queue{4};
+		REQUIRE_FALSE(queue.tryPop());
+		for (int i = 0; i < 4; i++)
+		{
+			queue.push(i);
+		}
+		REQUIRE(queue.pop() == 0);
+		queue.push(4);  // wraps around
+		for (int i = 1; i <= 4; i++)
+		{
+			REQUIRE(queue.tryPop() == i);
+		}
+		REQUIRE_FALSE(queue.tryPop());
+	}
+
+	SECTION("Hands every item to exactly one consumer")
+	{
+		constexpr std::size_t producerCount = 4;
+		constexpr std::size_t consumerCount = 4;
+		constexpr std::uint64_t itemsPerProducer = 20000;
+		Indexer::BoundedQueue<std::uint64_t> queue{16};  // small, so that both sides have to wait
+
+		std::atomic<std::uint64_t> sum{0};
+		std::atomic<std::uint64_t> count{0};
+		std::vector<std::thread> threads;
+		for (std::size_t c = 0; c < consumerCount; c++)
+		{
+			threads.emplace_back([&]()
+			{
+				while (auto item = queue.pop())  // 0 stops
+				{
+					sum += item;
+					count++;
+				}
+			});
+		}
+		for (std::size_t p = 0; p < producerCount; p++)
+		{
+			threads.emplace_back([&, p]()
+			{
+				for (std::uint64_t i = 1; i <= itemsPerProducer; i++)
+				{
+					queue.push(p * itemsPerProducer + i);
+				}
+			});
+		}
+		for (std::size_t p = 0; p < producerCount; p++)
+		{
+			threads[consumerCount + p].join();
+		}
+		for (std::size_t c = 0; c < consumerCount; c++)
+		{
+			queue.push(0);
+		}
+		for (std::size_t c = 0; c < consumerCount; c++)
+		{
+			threads[c].join();
+		}
+
+		constexpr auto total = producerCount * itemsPerProducer;
+		REQUIRE(count == total);
+		REQUIRE(sum == total * (total + 1) / 2);
+	}
+}
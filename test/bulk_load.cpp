@@ -0,0 +1,99 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "indexer/bulk_inverter.h"
+#include "indexer/indexer.h"
+
+#include "filesystem_utils.h"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Bulk inverter")
+{
+	auto runDir = std::filesystem::current_path() / "__test_bulk_runs";
+	std::filesystem::create_directory(runDir);
+
+	std::map<std::string, std::vector<Indexer::FileId>> merged;
+	std::size_t runCount = 0;
+	{
+		Indexer::BulkInverter inverter{1, 2, runDir / "run-"};  // every buffer spills as soon as it's full
+		for (Indexer::FileId fileId = 10; fileId > 0; fileId--)
+		{
+			std::vector<std::string> tokens{"COMMON", std::string{"F"}.append(std::to_string(fileId % 3))};
+			for (int i = 0; i < 500; i++)
+			{
+				tokens.push_back(std::string{"T"}.append(std::to_string(i)));
+			}
+			inverter.add(fileId, tokens);
+		}
+		runCount = inverter.runCount();
+		inverter.merge([&](std::string const& term, std::span<Indexer::FileId const> fileIds)
+		{
+			REQUIRE_FALSE(merged.contains(term));
+			merged[term].assign(fileIds.begin(), fileIds.end());
+		});
+	}
+
+	REQUIRE(runCount > 1);
+	REQUIRE(merged.size() == 504);
+	REQUIRE(merged["COMMON"] == std::vector<Indexer::FileId>{1, 2, 3, 4, 5, 6, 7, 8, 9, 10});
+	REQUIRE(merged["F0"] == std::vector<Indexer::FileId>{3, 6, 9});
+	REQUIRE(merged["T499"].size() == 10);
+	REQUIRE(std::filesystem::is_empty(runDir));
+	std::filesystem::remove_all(runDir);
+}
+
+TEST_CASE("Bulk load")
+{
+	auto testDir = std::filesystem::current_path() / "__test_bulk_dir";
+	auto spillDir = std::filesystem::current_path() / "__test_bulk_spill";
+	std::filesystem::create_directories(testDir / "nested");
+	std::filesystem::create_directory(spillDir);
+	constexpr int fileCount = 40;
+	for (int i = 0; i < fileCount; i++)
+	{
+		write((i % 2 ? testDir : testDir / "nested") / std::to_string(i), uniqueTokens(i, 100));
+	}
+
+	Indexer::Indexer regular;
+	regular.addPath(testDir, Indexer::Recursive::Yes);
+
+	Indexer::Indexer bulk;
+	bulk.setMemoryBudget(std::numeric_limits<std::size_t>::max(), spillDir);  // runs go next to the segments
+	bulk.addPath(testDir, Indexer::Recursive::Yes, Indexer::BulkLoad{.runBytes = 1});
+
+	SECTION("Finds the same files as indexing one by one")
+	{
+		REQUIRE(std::filesystem::is_empty(spillDir));
+		REQUIRE(bulk.stats().indexedFiles == fileCount);
+		REQUIRE(bulk.stats().filesIndexed == fileCount);
+		REQUIRE(bulk.stats().distinctTokens == regular.stats().distinctTokens);
+		REQUIRE(bulk.stats().postingsBytes == regular.stats().postingsBytes);
+		for (auto needle: {"COMMON", "T3", "F3T17", "F12T99", "MISSING"})
+		{
+			REQUIRE(bulk.search(needle) == regular.search(needle));
+		}
+	}
+
+	SECTION("Follows updates afterwards")
+	{
+		write(testDir / "3", "REWRITTEN\n");
+		std::filesystem::remove(testDir / "nested" / "4");
+		std::this_thread::sleep_for(50ms);
+
+		REQUIRE(bulk.search("F3T17").empty());
+		REQUIRE(bulk.search("REWRITTEN").contains(testDir / "3"));
+		REQUIRE(bulk.search("COMMON").size() == fileCount - 2);
+	}
+
+	std::filesystem::remove_all(testDir);
+	std::filesystem::remove_all(spillDir);
+}
@@ -0,0 +1,167 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+#include "indexer/file_filter.h"
+#include "indexer/indexer.h"
+
+#include "filesystem_utils.h"
+
+TEST_CASE("Glob matching")
+{
+	SECTION("Wildcards stay within a path component")
+	{
+		REQUIRE(Indexer::Glob{"*.o"}.matches("main.o"));
+		REQUIRE_FALSE(Indexer::Glob{"*.o"}.matches("main.cpp"));
+		REQUIRE_FALSE(Indexer::Glob{"*.o"}.matches("build/main.o"));
+		REQUIRE(Indexer::Glob{"?.tar.[gx]z"}.matches("a.tar.gz"));
+		REQUIRE_FALSE(Indexer::Glob{"?.tar.[!gx]z"}.matches("a.tar.gz"));
+	}
+
+	SECTION("Double star crosses directories")
+	{
+		REQUIRE(Indexer::Glob{"**/build/**"}.matches("/src/build/main.o"));
+		REQUIRE(Indexer::Glob{"src/**/*.h"}.matches("src/indexer.h"));
+		REQUIRE(Indexer::Glob{"src/**/*.h"}.matches("src/a/b/indexer.h"));
+		REQUIRE_FALSE(Indexer::Glob{"src/**/*.h"}.matches("include/indexer.h"));
+	}
+
+	SECTION("Many wildcards don't backtrack exponentially")
+	{
+		std::string name(10000, 'a');
+		REQUIRE_FALSE(Indexer::Glob{"*a*a*a*a*a*a*a*a*a*a*b"}.matches(name));
+		REQUIRE_FALSE(Indexer::Glob{"**a**a**a**a**a**a**a**a**b"}.matches(name + "/" + name));
+		REQUIRE(Indexer::Glob{"*a*a*a*a*a*a*a*a*a*a"}.matches(name));
+	}
+}
+
+TEST_CASE("Binary content sniffing")
+{
+	REQUIRE_FALSE(Indexer::looksBinary("plain text\n", false));
+	REQUIRE_FALSE(Indexer::looksBinary("\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82\n", false));
+	REQUIRE(Indexer::looksBinary(std::string_view{"ELF\0\0\0", 6}, false));
+	REQUIRE(Indexer::looksBinary("\xff\xfe", false));
+
+	// a multibyte sequence cut off by the end of the sniffed block
+	REQUIRE_FALSE(Indexer::looksBinary("text \xd0", true));
+	REQUIRE(Indexer::looksBinary("text \xd0", false));
+}
+
+TEST_CASE("Filtered files are not indexed")
+{
+	auto testDir = std::filesystem::current_path() / "__test_dir";
+	std::filesystem::create_directory(testDir);
+
+	auto textFile = testDir / "__text.txt";
+	auto binaryFile = testDir / "__binary.txt";
+	auto excludedFile = testDir / "__excluded.o";
+	auto largeFile = testDir / "__large.txt";
+	write(textFile, "TEST\n");
+	write(binaryFile, std::string{"TEST\n\0\0\0", 8});
+	write(excludedFile, "TEST\n");
+	write(largeFile, "TEST\n" + std::string(1024, 'x'));
+
+	Indexer::Indexer indexer;
+	indexer.setFileFilter({.maxFileSize = 1024, .skipBinaryFiles = true, .excludes = {Indexer::Glob{"*.o"}}});
+	indexer.addPath(testDir);
+
+	REQUIRE(indexer.search("TEST").contains(textFile));
+	REQUIRE(indexer.search("TEST").size() == 1);
+	REQUIRE(indexer.stats().indexedFiles == 1);  // the skipped files got no file id either
+
+	std::filesystem::remove_all(testDir);
+}
+
+TEST_CASE("Binary files added by path are skipped")
+{
+	auto binaryFile = std::filesystem::current_path() / "__binary.txt";
+	write(binaryFile, std::string{"TEST\n\0\0\0", 8});
+
+	Indexer::Indexer indexer;
+	indexer.addPath(binaryFile);  // binary files are skipped by default
+
+	REQUIRE(indexer.search("TEST").empty());
+	REQUIRE(indexer.stats().indexedFiles == 0);
+
+	std::filesystem::remove(binaryFile);
+}
+
+TEST_CASE("Ignore files are honoured")
+{
+	auto testDir = std::filesystem::current_path() / "__test_dir";
+	std::filesystem::create_directories(testDir / "build");
+	std::filesystem::create_directories(testDir / "sub");
+
+	write(testDir / ".gitignore", "# build outputs\nbuild/\n*.log\n!keep.log\n");
+	write(testDir / "sub" / ".ignore", "secret.txt\n");
+
+	write(testDir / "source.txt", "TEST\n");
+	write(testDir / "debug.log", "TEST\n");
+	write(testDir / "keep.log", "TEST\n");
+	write(testDir / "build" / "output.txt", "TEST\n");
+	write(testDir / "sub" / "secret.txt", "TEST\n");
+	write(testDir / "sub" / "public.txt", "TEST\n");
+	write(testDir / "sub" / "trace.log", "TEST\n");
+
+	SECTION("Ignored files and directories are skipped")
+	{
+		Indexer::Indexer indexer;
+		indexer.addPath(testDir, Indexer::Recursive::Yes);
+
+		auto found = indexer.search("TEST");
+		REQUIRE(found.contains(testDir / "source.txt"));
+		REQUIRE(found.contains(testDir / "keep.log"));
+		REQUIRE(found.contains(testDir / "sub" / "public.txt"));
+		REQUIRE(found.size() == 3);
+	}
+
+	SECTION("Ignore files can be disregarded")
+	{
+		Indexer::Indexer indexer;
+		Indexer::FileFilter filter;
+		filter.respectIgnoreFiles = false;
+		indexer.setFileFilter(filter);
+		indexer.addPath(testDir, Indexer::Recursive::Yes);
+
+		REQUIRE(indexer.search("TEST").size() == 7);
+	}
+
+	std::filesystem::remove_all(testDir);
+}
+
+TEST_CASE("Ignore rules are inherited from the repository root down")
+{
+	auto outerDir = std::filesystem::temp_directory_path() / "__test_outer";  // e.g. the home directory, not in a repository
+	auto testDir = outerDir / "tree";
+	std::filesystem::create_directories(testDir / "sub");
+
+	write(outerDir / ".gitignore", "*.txt\n");
+	write(testDir / ".gitignore", "*.log\n");
+	write(testDir / "sub" / "source.txt", "TEST\n");
+	write(testDir / "sub" / "debug.log", "TEST\n");
+
+	SECTION("Outside a repository, only from the added path down")
+	{
+		Indexer::Indexer indexer;
+		indexer.addPath(testDir, Indexer::Recursive::Yes);
+		REQUIRE(indexer.search("TEST") == Indexer::PathSet{testDir / "sub" / "source.txt"});
+	}
+
+	SECTION("Up to the repository root")
+	{
+		std::filesystem::create_directory(outerDir / ".git");
+		Indexer::Indexer indexer;
+		indexer.addPath(testDir, Indexer::Recursive::Yes);
+		REQUIRE(indexer.search("TEST").empty());
+	}
+
+	SECTION("But not beyond it")
+	{
+		std::filesystem::create_directory(testDir / ".git");
+		Indexer::Indexer indexer;
+		indexer.addPath(testDir / "sub", Indexer::Recursive::Yes);
+		REQUIRE(indexer.search("TEST") == Indexer::PathSet{testDir / "sub" / "source.txt"});
+	}
+
+	std::filesystem::remove_all(outerDir);
+}
@@ -0,0 +1,56 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "indexer/file_reader.h"
+#include "indexer/indexer.h"
+
+#include "filesystem_utils.h"
+
+TEST_CASE("Batched file reads")
+{
+	auto testDir = std::filesystem::current_path() / "__test_reader_dir";
+	std::filesystem::create_directory(testDir);
+
+	std::vector<std::filesystem::path> paths;
+	for (int i = 0; i < 100; i++)  // more than fit in the ring at once
+	{
+		paths.push_back(testDir / std::to_string(i));
+		write(paths.back(), std::string(static_cast<std::size_t>(i) * 100, static_cast<char>('a' + i % 26)));
+	}
+	paths.push_back(testDir / "missing");
+
+	Indexer::FileReader reader{8};
+
+	SECTION("Reads whole files, or leaves them to the caller")
+	{
+		auto contents = reader.read(paths, 5000);
+		REQUIRE(contents.size() == paths.size());
+		if (not reader.isAvailable())
+		{
+			for (auto const& c: contents)
+			{
+				REQUIRE_FALSE(c);
+			}
+			return;
+		}
+
+		REQUIRE(contents[0] == "");
+		REQUIRE(contents[3] == std::string(300, 'd'));
+		REQUIRE(contents[50] == std::string(5000, 'y'));
+		REQUIRE_FALSE(contents[51]);  // over the limit
+		REQUIRE_FALSE(contents.back());
+	}
+
+	SECTION("Indexing goes through the reader")
+	{
+		Indexer::Indexer indexer;
+		indexer.addPath(testDir);
+		REQUIRE(indexer.search(std::string(300, 'd')).contains(testDir / "3"));
+		REQUIRE(indexer.stats().filesReadInBatches == (reader.isAvailable() ? 100u : 0u));
+	}
+
+	std::filesystem::remove_all(testDir);
+}
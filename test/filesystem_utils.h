@@ -1,5 +1,6 @@
 #include <filesystem>
 #include <fstream>
+#include <string>
 
 inline void touch(std::filesystem::path const& file)
 {
@@ -11,3 +12,21 @@ inline void write(std::filesystem::path const& file, std::string const& string)
 	std::ofstream fout{file};  // creates the file
 	fout << string;
 }
+
+inline void append(std::filesystem::path const& file, std::string const& string)
+{
+	std::ofstream fout{file, std::ios_base::app};
+	fout << string;
+}
+
+// COMMON, `count` tokens of the file's own like F3T17, and T0 to T6 shared with other files
+inline std::string uniqueTokens(int file, int count)
+{
+	std::string contents = "COMMON\n";
+	for (int i = 0; i < count; i++)
+	{
+		contents.append("F").append(std::to_string(file)).append("T").append(std::to_string(i));
+		contents.append(" T").append(std::to_string(i % 7)).append("\n");
+	}
+	return contents;
+}
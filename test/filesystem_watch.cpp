@@ -39,6 +39,66 @@ TEST_CASE("Watching filesystem")
 		std::filesystem::remove(testFile);
 	}
 
+	SECTION("Rewriting the same contents keeps the file indexed")
+	{
+		auto testFile = testDir / "section_rewrite";
+		write(testFile, "UNMODIFIED\n");
+
+		indexer.addPath(testFile);
+		write(testFile, "UNMODIFIED\n");
+		touch(testFile);
+		wait();
+
+		REQUIRE(indexer.search("UNMODIFIED").contains(testFile));
+
+		std::filesystem::remove(testFile);
+	}
+
+	SECTION("Modifying one of several identical files")
+	{
+		auto testFile = testDir / "section_identical";
+		auto twinFile = testDir / "section_identical_twin";
+		write(testFile, "IDENTICAL\n");
+		write(twinFile, "IDENTICAL\n");
+
+		indexer.addPath(testDir);
+		REQUIRE(indexer.search("IDENTICAL").contains(testFile));
+		REQUIRE(indexer.search("IDENTICAL").contains(twinFile));
+
+		write(testFile, "MODIFY\n");
+		wait();
+
+		REQUIRE(indexer.search("MODIFY").contains(testFile));
+		REQUIRE_FALSE(indexer.search("MODIFY").contains(twinFile));
+		REQUIRE_FALSE(indexer.search("IDENTICAL").contains(testFile));
+		REQUIRE(indexer.search("IDENTICAL").contains(twinFile));
+
+		std::filesystem::remove(testFile);
+		std::filesystem::remove(twinFile);
+	}
+
+	SECTION("Appending to a file")
+	{
+		auto testFile = testDir / "section_append";
+		write(testFile, "ORIGINAL\n");
+
+		indexer.addPath(testFile);
+		append(testFile, "APPENDED\n");
+		wait();
+
+		REQUIRE(indexer.search("ORIGINAL").contains(testFile));
+		REQUIRE(indexer.search("APPENDED").contains(testFile));
+
+		write(testFile, "REWRITTEN\nAND\nLONGER\n");
+		wait();
+
+		REQUIRE(indexer.search("REWRITTEN").contains(testFile));
+		REQUIRE_FALSE(indexer.search("ORIGINAL").contains(testFile));
+		REQUIRE_FALSE(indexer.search("APPENDED").contains(testFile));
+
+		std::filesystem::remove(testFile);
+	}
+
 	SECTION("File creation and modification is caught")
 	{
 		indexer.addPath(testDir, Indexer::Recursive::Yes);
@@ -62,6 +122,84 @@ TEST_CASE("Watching filesystem")
 		std::filesystem::remove(testFile);
 	}
 
+	SECTION("Ignored directories created later are skipped")
+	{
+		write(testDir / ".gitignore", "section_ignored/\n");
+		indexer.addPath(testDir, Indexer::Recursive::Yes);
+
+		auto subdir = testDir / "section_ignored";
+		std::filesystem::create_directory(subdir);
+		auto subdirFile = subdir / "section_ignored_inner";
+		wait();
+		write(subdirFile, "IGNORED\n");
+		wait();
+
+		REQUIRE_FALSE(indexer.search("IGNORED").contains(subdirFile));
+
+		std::filesystem::remove_all(subdir);
+	}
+
+	SECTION("Renamed files are found under the new name")
+	{
+		auto testFile = testDir / "section_rename";
+		auto renamedFile = testDir / "section_rename_renamed";
+		write(testFile, "RENAME\n");
+
+		indexer.addPath(testDir);
+		std::filesystem::rename(testFile, renamedFile);
+		wait();
+
+		REQUIRE(indexer.search("RENAME").contains(renamedFile));
+		REQUIRE_FALSE(indexer.search("RENAME").contains(testFile));
+
+		write(renamedFile, "MODIFY\n");
+		wait();
+
+		REQUIRE(indexer.search("MODIFY").contains(renamedFile));
+		REQUIRE_FALSE(indexer.search("RENAME").contains(renamedFile));
+
+		std::filesystem::remove(renamedFile);
+	}
+
+	SECTION("Moved directories keep their files indexed and watched")
+	{
+		auto subdir = testDir / "section_move";
+		auto movedDir = testDir / "section_move_moved";
+		std::filesystem::create_directory(subdir);
+		write(subdir / "section_move_inner", "MOVE\n");
+
+		indexer.addPath(testDir, Indexer::Recursive::Yes);
+		std::filesystem::rename(subdir, movedDir);
+		wait();
+
+		auto movedFile = movedDir / "section_move_inner";
+		REQUIRE(indexer.search("MOVE").contains(movedFile));
+		REQUIRE_FALSE(indexer.search("MOVE").contains(subdir / "section_move_inner"));
+
+		write(movedFile, "MODIFY\n");
+		wait();
+
+		REQUIRE(indexer.search("MODIFY").contains(movedFile));
+
+		std::filesystem::remove_all(movedDir);
+	}
+
+	SECTION("Files moved out of the tree are removed")
+	{
+		auto outsideDir = std::filesystem::current_path() / "__test_dir_outside";
+		std::filesystem::create_directory(outsideDir);
+		auto testFile = testDir / "section_move_out";
+		write(testFile, "MOVEOUT\n");
+
+		indexer.addPath(testDir);
+		std::filesystem::rename(testFile, outsideDir / "section_move_out");
+		wait();
+
+		REQUIRE(indexer.search("MOVEOUT").empty());
+
+		std::filesystem::remove_all(outsideDir);
+	}
+
 	SECTION("File deletion is caught")
 	{
 		auto testFile = testDir / "section_delete";
@@ -0,0 +1,120 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "indexer/index_snapshot.h"
+#include "indexer/indexer.h"
+#include "indexer/unicode_tokenizer.h"
+
+#include "filesystem_utils.h"
+
+namespace
+{
+std::vector<std::string> sorted(std::vector<std::string_view> const& paths)
+{
+	std::vector<std::string> strings{paths.begin(), paths.end()};
+	std::sort(strings.begin(), strings.end());
+	return strings;
+}
+}
+
+TEST_CASE("Published snapshots")
+{
+	auto testDir = std::filesystem::current_path() / "__test_snapshot_dir";
+	std::filesystem::create_directory(testDir);
+	write(testDir / "a", "alpha common\n");
+	write(testDir / "b", "beta common\n");
+	auto snapshotFile = std::filesystem::current_path() / "__test_snapshot";
+
+	Indexer::Indexer indexer;
+	indexer.addPath(testDir, Indexer::Recursive::Yes);
+	indexer.publishSnapshot(snapshotFile);
+	Indexer::IndexSnapshot snapshot{snapshotFile};
+
+	SECTION("Answer searches like the index they were published from")
+	{
+		REQUIRE(snapshot.fileCount() == 2);
+		REQUIRE(snapshot.termCount() == 3);
+		REQUIRE(sorted(snapshot.search("common")) == std::vector<std::string>{(testDir / "a").string(), (testDir / "b").string()});
+		REQUIRE(sorted(snapshot.search("beta")) == std::vector<std::string>{(testDir / "b").string()});
+		REQUIRE(snapshot.search("gamma").empty());
+		REQUIRE(snapshot.search("").empty());
+	}
+
+	SECTION("Keep their generation until refreshed")
+	{
+		auto generation = snapshot.generation();
+		REQUIRE_FALSE(snapshot.refresh());
+
+		write(testDir / "c", "gamma common\n");
+		indexer.addPath(testDir / "c");
+		indexer.publishSnapshot(snapshotFile);
+		REQUIRE(snapshot.search("gamma").empty());
+		REQUIRE(snapshot.search("common").size() == 2);
+
+		REQUIRE(snapshot.refresh());
+		REQUIRE(snapshot.generation() == generation + 1);
+		REQUIRE(snapshot.search("gamma").size() == 1);
+		REQUIRE(snapshot.search("common").size() == 3);
+	}
+
+	SECTION("Include spilled posting lists")
+	{
+		indexer.setMemoryBudget(0);
+		indexer.publishSnapshot(snapshotFile);
+		snapshot.refresh();
+		REQUIRE(snapshot.search("common").size() == 2);
+		REQUIRE(snapshot.search("alpha").size() == 1);
+	}
+
+	SECTION("Refuse files that aren't snapshots")
+	{
+		write(testDir / "bogus", "not a snapshot, but long enough to hold a header of one\n");
+		REQUIRE_THROWS(Indexer::IndexSnapshot{testDir / "bogus"});
+		REQUIRE_FALSE(Indexer::IndexSnapshot::generationOf(testDir / "bogus"));
+	}
+
+	std::filesystem::remove(snapshotFile);
+	std::filesystem::remove_all(testDir);
+}
+
+TEST_CASE("Snapshots normalize needles like the index")
+{
+	auto testDir = std::filesystem::current_path() / "__test_snapshot_folded_dir";
+	std::filesystem::create_directory(testDir);
+	write(testDir / "folded.md", "Foo Straße\n");
+	write(testDir / "lower.txt", "foo\n");
+	write(testDir / "upper.txt", "Foo\n");
+	auto snapshotFile = std::filesystem::current_path() / "__test_snapshot_folded";
+
+	Indexer::TokenizerRegistry registry;
+	registry.add("*.md", Indexer::TokenizerRegistry::factoryOf(Indexer::UnicodeTokenizer{}));
+	Indexer::Indexer indexer{std::move(registry)};
+	indexer.addPath(testDir, Indexer::Recursive::Yes);
+	indexer.publishSnapshot(snapshotFile);
+	Indexer::IndexSnapshot snapshot{snapshotFile};
+
+	auto both = [&](std::string const& needle)
+	{
+		std::vector<std::string> live;
+		for (auto const& path: indexer.search(needle))
+		{
+			live.push_back(path.string());
+		}
+		std::sort(live.begin(), live.end());
+		REQUIRE(sorted(snapshot.search(needle)) == live);
+		return live;
+	};
+	// the case folded needle only matches where case was folded too
+	REQUIRE(both("Foo") == std::vector<std::string>{(testDir / "folded.md").string(), (testDir / "upper.txt").string()});
+	REQUIRE(both("FOO") == std::vector<std::string>{(testDir / "folded.md").string()});
+	REQUIRE(both("foo") == std::vector<std::string>{(testDir / "folded.md").string(), (testDir / "lower.txt").string()});
+	REQUIRE(both("STRASSE").empty());
+	REQUIRE(both("STRAßE") == std::vector<std::string>{(testDir / "folded.md").string()});
+
+	std::filesystem::remove(snapshotFile);
+	std::filesystem::remove_all(testDir);
+}
@@ -0,0 +1,149 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "indexer/indexer.h"
+
+#include "filesystem_utils.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+std::atomic<bool> isHeld{false};
+
+// each line is a token, once released
+class HeldTokenizer final: public Indexer::Tokenizer
+{
+public:
+	virtual void sendLine(std::string_view newLine) override
+	{
+		isHeld.wait(true);
+		line = newLine;
+		isDone = line.empty();
+	}
+
+	virtual void sendEof() override {}
+
+	virtual std::unique_ptr<Indexer::Tokenizer> clone() const override { return std::make_unique<HeldTokenizer>(); }
+
+	[[nodiscard]] virtual std::string_view next() override
+	{
+		isDone = true;
+		return line;
+	}
+
+	virtual bool done() const override { return isDone; }
+
+private:
+	std::string_view line;
+	bool isDone{true};
+};
+}
+
+TEST_CASE("Shared runtime")
+{
+	auto testDir = std::filesystem::current_path() / "__test_runtime_dir";
+	std::filesystem::create_directories(testDir / "first");
+	std::filesystem::create_directories(testDir / "second");
+	write(testDir / "first" / "a", "FIRST SHARED\n");
+	write(testDir / "second" / "b", "SECOND SHARED\n");
+
+	auto runtime = std::make_shared<Indexer::IndexerRuntime>(2);
+	std::optional<Indexer::Indexer> first{std::in_place, runtime};
+	Indexer::Indexer second{runtime};
+	first->addPath(testDir / "first", Indexer::Recursive::Yes);
+	second.addPath(testDir / "second", Indexer::Recursive::Yes);
+
+	SECTION("Each indexer has only its own files")
+	{
+		REQUIRE(first->search("SHARED").size() == 1);
+		REQUIRE(first->search("FIRST").contains(testDir / "first" / "a"));
+		REQUIRE(second.search("SHARED").size() == 1);
+		REQUIRE(second.search("SECOND").contains(testDir / "second" / "b"));
+	}
+
+	SECTION("Events go to the indexer watching the path")
+	{
+		write(testDir / "first" / "c", "CREATED\n");
+		write(testDir / "second" / "b", "MODIFIED\n");
+		std::this_thread::sleep_for(50ms);
+
+		REQUIRE(first->search("CREATED").contains(testDir / "first" / "c"));
+		REQUIRE(second.search("CREATED").empty());
+		REQUIRE(second.search("MODIFIED").contains(testDir / "second" / "b"));
+		REQUIRE(first->search("MODIFIED").empty());
+	}
+
+	SECTION("Overlapping indexers both keep their watches")
+	{
+		Indexer::Indexer overlapping{runtime};
+		overlapping.addPath(testDir, Indexer::Recursive::Yes);
+		REQUIRE(overlapping.search("SHARED").size() == 2);
+
+		first.reset();
+		write(testDir / "first" / "a", "AFTER\n");
+		std::this_thread::sleep_for(50ms);
+
+		REQUIRE(overlapping.search("AFTER").contains(testDir / "first" / "a"));
+	}
+
+	SECTION("Large adds to one indexer don't hold up another")
+	{
+		std::filesystem::create_directory(testDir / "bulk");
+		for (int i = 0; i < 500; i++)
+		{
+			write(testDir / "bulk" / std::to_string(i), "BULK\n");
+		}
+		auto task = first->addPathAsync(testDir / "bulk", Indexer::Recursive::Yes);
+		write(testDir / "second" / "d", "QUICK\n");
+		second.addPath(testDir / "second" / "d");
+
+		REQUIRE(second.search("QUICK").contains(testDir / "second" / "d"));
+		task.wait();
+		REQUIRE(first->search("BULK").size() == 500);
+	}
+
+	first.reset();
+	std::filesystem::remove_all(testDir);
+}
+
+TEST_CASE("A held up indexer doesn't hold up the events of another")
+{
+	auto testDir = std::filesystem::current_path() / "__test_runtime_held_dir";
+	std::filesystem::create_directories(testDir / "held");
+	std::filesystem::create_directories(testDir / "free");
+	std::filesystem::create_directories(testDir / "flood");
+	write(testDir / "free" / "a", "FREE\n");
+	for (int i = 0; i < 2000; i++)  // more than the held indexer's pipeline takes in
+	{
+		write(testDir / "flood" / std::to_string(i), "FLOOD\n");
+	}
+
+	auto runtime = std::make_shared<Indexer::IndexerRuntime>(2);
+	std::optional<Indexer::Indexer> held{std::in_place, HeldTokenizer{}, runtime};
+	Indexer::Indexer free{runtime};
+	held->addPath(testDir / "held", Indexer::Recursive::Yes);
+	free.addPath(testDir / "free", Indexer::Recursive::Yes);
+	REQUIRE(free.search("FREE").contains(testDir / "free" / "a"));
+
+	isHeld = true;
+	std::filesystem::rename(testDir / "flood", testDir / "held" / "flood");  // handling it blocks on the full pipeline
+	std::this_thread::sleep_for(50ms);
+	std::filesystem::remove(testDir / "free" / "a");
+	std::this_thread::sleep_for(50ms);
+	auto isRemoved = free.search("FREE").empty();
+
+	isHeld = false;  // before anything can fail, or the held indexer never stops
+	isHeld.notify_all();
+	REQUIRE(isRemoved);
+	held.reset();
+	std::filesystem::remove_all(testDir);
+}
@@ -0,0 +1,72 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+#include "indexer/indexer.h"
+
+#include "filesystem_utils.h"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Background indexing")
+{
+	auto testDir = std::filesystem::current_path() / "__test_task_dir";
+	constexpr int fileCount = 200;
+	for (int i = 0; i < fileCount; i++)
+	{
+		auto directory = testDir / std::to_string(i % 10);
+		std::filesystem::create_directories(directory);
+		write(directory / std::to_string(i), "COMMON F" + std::to_string(i) + "\n");
+	}
+	write(testDir / "binary", std::string{"\0\1\2", 3});
+
+	Indexer::Indexer indexer;
+
+	SECTION("Reports progress until done")
+	{
+		auto task = indexer.addPathAsync(testDir, Indexer::Recursive::Yes);
+		REQUIRE(task.waitFor(10s));
+
+		auto progress = task.progress();
+		REQUIRE(progress.isDone);
+		REQUIRE(progress.filesDiscovered == fileCount + 1);
+		REQUIRE(progress.filesIndexed == fileCount);
+		REQUIRE(progress.filesSkipped == 1);
+		REQUIRE(progress.bytesRead > 0);
+		REQUIRE(indexer.search("COMMON").size() == fileCount);
+	}
+
+	SECTION("Can be cancelled")
+	{
+		std::stop_source stopSource;
+		stopSource.request_stop();
+		auto task = indexer.addPathAsync(testDir, Indexer::Recursive::Yes, stopSource.get_token());
+		task.wait();
+		REQUIRE(task.progress().filesDiscovered == 0);
+		REQUIRE(indexer.search("COMMON").empty());
+
+		auto cancelled = indexer.addPathAsync(testDir, Indexer::Recursive::Yes);
+		cancelled.cancel();
+		cancelled.wait();
+		auto progress = cancelled.progress();
+		REQUIRE(progress.filesIndexed + progress.filesSkipped == progress.filesDiscovered);
+		REQUIRE(indexer.search("COMMON").size() == progress.filesIndexed);
+	}
+
+	SECTION("Leaves the index usable meanwhile")
+	{
+		auto task = indexer.addPathAsync(testDir, Indexer::Recursive::Yes);
+		while (not task.isDone())
+		{
+			REQUIRE(indexer.search("COMMON").size() <= fileCount);
+			std::this_thread::sleep_for(1ms);
+		}
+		REQUIRE(indexer.search("COMMON").size() == fileCount);
+	}
+
+	std::filesystem::remove_all(testDir);
+}
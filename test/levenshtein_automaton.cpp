@@ -0,0 +1,179 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "indexer/indexer.h"
+#include "indexer/levenshtein_automaton.h"
+
+#include "filesystem_utils.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+std::size_t editDistance(std::string const& a, std::string const& b)
+{
+	std::vector<std::size_t> row(b.size() + 1);
+	for (std::size_t j = 0; j <= b.size(); j++)
+	{
+		row[j] = j;
+	}
+	for (std::size_t i = 1; i <= a.size(); i++)
+	{
+		auto diagonal = row[0];
+		row[0] = i;
+		for (std::size_t j = 1; j <= b.size(); j++)
+		{
+			auto above = row[j];
+			row[j] = std::min({row[j] + 1, row[j - 1] + 1, diagonal + (a[i - 1] == b[j - 1] ? 0 : 1)});
+			diagonal = above;
+		}
+	}
+	return row[b.size()];
+}
+
+// every string of up to `length` bytes over "abc"
+std::vector<std::string> allStrings(std::size_t length)
+{
+	std::vector<std::string> strings{""};
+	for (std::size_t i = 0; i < strings.size(); i++)
+	{
+		if (strings[i].size() < length)
+		{
+			for (auto c: {'a', 'b', 'c'})
+			{
+				strings.push_back(strings[i] + c);
+			}
+		}
+	}
+	return strings;
+}
+}
+
+TEST_CASE("Levenshtein automaton")
+{
+	SECTION("Exact matches only at distance 0")
+	{
+		Indexer::LevenshteinAutomaton automaton{"index", 0};
+		REQUIRE(automaton.matches("index"));
+		REQUIRE(not automaton.matches("indx"));
+		REQUIRE(not automaton.matches("indexes"));
+		REQUIRE(not automaton.matches(""));
+	}
+
+	SECTION("One insertion, deletion or substitution")
+	{
+		Indexer::LevenshteinAutomaton automaton{"index", 1};
+		for (auto text: {"index", "indexs", "xindex", "indx", "ndex", "indez", "undex"})
+		{
+			REQUIRE(automaton.matches(text));
+		}
+		for (auto text: {"idnex", "indexes", "ind", "", "other"})
+		{
+			REQUIRE(not automaton.matches(text));
+		}
+	}
+
+	SECTION("Two edits")
+	{
+		Indexer::LevenshteinAutomaton automaton{"index", 2};
+		for (auto text: {"idnex", "indexes", "ind", "inflex", "xindexx"})
+		{
+			REQUIRE(automaton.matches(text));
+		}
+		for (auto text: {"in", "indexers", "other"})
+		{
+			REQUIRE(not automaton.matches(text));
+		}
+	}
+
+	SECTION("Short words")
+	{
+		REQUIRE(Indexer::LevenshteinAutomaton{"", 1}.matches("a"));
+		REQUIRE(Indexer::LevenshteinAutomaton{"", 1}.matches(""));
+		REQUIRE(not Indexer::LevenshteinAutomaton{"", 1}.matches("ab"));
+		REQUIRE(Indexer::LevenshteinAutomaton{"a", 2}.matches(""));
+		REQUIRE(Indexer::LevenshteinAutomaton{"a", 2}.matches("bca"));
+	}
+
+	SECTION("Agrees with the edit distance")
+	{
+		auto strings = allStrings(5);
+		for (unsigned maxDistance = 0; maxDistance <= Indexer::LevenshteinAutomaton::maxSupportedDistance; maxDistance++)
+		{
+			for (auto const& word: allStrings(4))
+			{
+				Indexer::LevenshteinAutomaton automaton{word, maxDistance};
+				for (auto const& text: strings)
+				{
+					if (automaton.matches(text) != (editDistance(word, text) <= maxDistance))
+					{
+						FAIL(word << " vs " << text << " at distance " << maxDistance);
+					}
+				}
+			}
+		}
+	}
+
+	SECTION("Larger distances are rejected")
+	{
+		REQUIRE_THROWS_AS((Indexer::LevenshteinAutomaton{"index", 3}), std::invalid_argument);
+	}
+}
+
+TEST_CASE("Fuzzy search")
+{
+	auto testDir = std::filesystem::current_path() / "__test_fuzzy_dir";
+	auto spillDir = std::filesystem::current_path() / "__test_fuzzy_spill";
+	std::filesystem::create_directory(testDir);
+	std::filesystem::create_directory(spillDir);
+	write(testDir / "a", "indexer\nindexes\n");
+	write(testDir / "b", "index\ninbox\n");
+	write(testDir / "c", "unrelated\n");
+	std::string filler;
+	for (int i = 0; i < 5000; i++)
+	{
+		filler += "filler" + std::to_string(i) + "\n";  // enough terms for the budget to spill some
+	}
+	write(testDir / "d", filler);
+
+	Indexer::Indexer indexer;
+	indexer.addPath(testDir);
+
+	SECTION("Terms within the distance")
+	{
+		REQUIRE(indexer.similarTerms("indx", 0).empty());
+		REQUIRE(indexer.similarTerms("indx", 1) == std::vector<std::string>{"index"});
+		REQUIRE(indexer.similarTerms("indexe", 1) == std::vector<std::string>{"index", "indexer", "indexes"});
+		REQUIRE(indexer.similarTerms("inbex", 2) == std::vector<std::string>{"inbox", "index"});
+
+		REQUIRE(indexer.searchFuzzy("indx", 1) == Indexer::PathSet{testDir / "b"});
+		REQUIRE(indexer.searchFuzzy("indexe", 1) == Indexer::PathSet{testDir / "a", testDir / "b"});
+		REQUIRE(indexer.searchFuzzy("index", 0) == indexer.search("index"));
+		REQUIRE_THROWS_AS(indexer.searchFuzzy("index", 3), std::invalid_argument);
+	}
+
+	SECTION("Removed terms are forgotten")
+	{
+		std::filesystem::remove(testDir / "b");
+		std::this_thread::sleep_for(50ms);
+		REQUIRE(indexer.similarTerms("indx", 1).empty());
+		REQUIRE(indexer.searchFuzzy("indexe", 1) == Indexer::PathSet{testDir / "a"});
+	}
+
+	SECTION("Spilled terms are still found")
+	{
+		indexer.setMemoryBudget(1, spillDir);
+		REQUIRE(indexer.stats().spilledTokens > 0);
+		REQUIRE(indexer.similarTerms("indexe", 1) == std::vector<std::string>{"index", "indexer", "indexes"});
+		REQUIRE(indexer.searchFuzzy("unrelatd", 1) == Indexer::PathSet{testDir / "c"});
+	}
+
+	std::filesystem::remove_all(testDir);
+	std::filesystem::remove_all(spillDir);
+}
@@ -0,0 +1,93 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include "indexer/indexer.h"
+
+#include "filesystem_utils.h"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Memory budget")
+{
+	auto testDir = std::filesystem::current_path() / "__test_budget_dir";
+	auto spillDir = std::filesystem::current_path() / "__test_budget_spill";
+	std::filesystem::create_directory(testDir);
+	std::filesystem::create_directory(spillDir);
+	constexpr int fileCount = 40;
+	for (int i = 0; i < fileCount; i++)
+	{
+		write(testDir / std::to_string(i), uniqueTokens(i, 200));
+	}
+
+	SECTION("Spilled posting lists are still searchable")
+	{
+		Indexer::Indexer indexer;
+		indexer.addPath(testDir);
+		auto unlimited = indexer.stats();
+		REQUIRE(unlimited.spilledTokens == 0);
+
+		indexer.setMemoryBudget(1, spillDir);
+		auto spilled = indexer.stats();
+		REQUIRE(spilled.spilledTokens > 0);
+		REQUIRE(spilled.spilledBytes > 0);
+		REQUIRE(spilled.postingsBytes < unlimited.postingsBytes);
+		REQUIRE(spilled.distinctTokens == unlimited.distinctTokens);
+		REQUIRE_FALSE(std::filesystem::is_empty(spillDir));
+
+		REQUIRE(indexer.search("COMMON").size() == fileCount);
+		REQUIRE(indexer.search("F3T17").contains(testDir / "3"));
+		REQUIRE(indexer.search("F3T17").size() == 1);
+		REQUIRE(indexer.search("F3T17", testDir) == Indexer::PathSet{testDir / "3"});
+
+		SECTION("and follow updates")
+		{
+			write(testDir / "3", "REWRITTEN\nF4T17\n");
+			std::this_thread::sleep_for(50ms);
+
+			REQUIRE(indexer.search("F3T17").empty());
+			REQUIRE(indexer.search("F4T17").size() == 2);
+			REQUIRE(indexer.search("REWRITTEN").contains(testDir / "3"));
+			REQUIRE(indexer.search("COMMON").size() == fileCount - 1);
+		}
+
+		SECTION("and follow file id compaction")
+		{
+			for (int i = 0; i < fileCount; i += 2)
+			{
+				std::filesystem::remove(testDir / std::to_string(i));
+			}
+			std::this_thread::sleep_for(50ms);
+			indexer.compactFileIds();
+
+			REQUIRE(indexer.search("COMMON").size() == fileCount / 2);
+			REQUIRE(indexer.search("F3T17").contains(testDir / "3"));
+			REQUIRE(indexer.search("F4T17").empty());
+			REQUIRE(indexer.search("F3T17", testDir) == Indexer::PathSet{testDir / "3"});
+		}
+	}
+
+	SECTION("Accounting drops back once files are gone")
+	{
+		Indexer::Indexer indexer;
+		indexer.addPath(testDir);
+		REQUIRE(indexer.stats().postingsBytes > 0);
+		REQUIRE(indexer.stats().dictionaryBytes > 0);
+
+		std::filesystem::remove_all(testDir);
+		std::this_thread::sleep_for(100ms);
+
+		auto stats = indexer.stats();
+		REQUIRE(stats.indexedFiles == 0);
+		REQUIRE(stats.distinctTokens == 0);
+		REQUIRE(stats.postingsBytes == 0);
+		REQUIRE(stats.dictionaryBytes == 0);
+	}
+
+	REQUIRE(std::filesystem::is_empty(spillDir));  // segments are deleted with the indexer
+	std::filesystem::remove_all(testDir);
+	std::filesystem::remove_all(spillDir);
+}
@@ -0,0 +1,87 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include "indexer/indexer.h"
+
+#include "filesystem_utils.h"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Histogram percentiles")
+{
+	Indexer::Histogram histogram;
+	histogram.buckets[4] = 90;  // [8, 16) ns
+	histogram.buckets[10] = 10;  // [512, 1024) ns
+	histogram.count = 100;
+	histogram.total = 90 * 10 + 10 * 600;
+	histogram.max = 700;
+
+	REQUIRE(histogram.mean() == 69ns);
+	REQUIRE(histogram.percentile(50) == 15ns);
+	REQUIRE(histogram.percentile(99) == 700ns);  // capped by the largest sample
+	REQUIRE(Indexer::Histogram{}.percentile(99) == 0ns);
+}
+
+TEST_CASE("Indexer stats")
+{
+	auto testDir = std::filesystem::current_path() / "__test_stats_dir";
+	std::filesystem::create_directory(testDir);
+	write(testDir / "one", "STATS\nONE\n");
+	write(testDir / "two", "STATS\nTWO\n");
+
+	Indexer::Indexer indexer;
+
+	SECTION("Counters follow indexing, searching and watcher events")
+	{
+		indexer.addPath(testDir);
+		REQUIRE(indexer.search("STATS").size() == 2);
+
+		auto stats = indexer.stats();
+		REQUIRE(stats.filesIndexed == 2);
+		REQUIRE(stats.indexedFiles == 2);
+		REQUIRE(stats.bytesTokenized > 0);
+		REQUIRE(stats.tokenizeTime.count == 2);
+		REQUIRE(stats.searches == 1);
+		REQUIRE(stats.searchTime.count == 1);
+		REQUIRE(stats.indexLockWait.count > 0);
+		REQUIRE(stats.activeWorkers == 0);
+
+		append(testDir / "one", "MORE\n");
+		std::this_thread::sleep_for(50ms);
+		std::filesystem::remove(testDir / "two");
+		std::this_thread::sleep_for(50ms);
+
+		stats = indexer.stats();
+		REQUIRE(stats.modifiedEvents >= 1);
+		REQUIRE(stats.appendReindexes == 1);
+		REQUIRE(stats.deletedEvents == 1);
+		REQUIRE(stats.filesRemoved == 1);
+		REQUIRE(stats.indexedFiles == 1);
+	}
+
+	SECTION("Traces are only recorded while tracing")
+	{
+		indexer.addPath(testDir / "one");
+		indexer.setTracing(true);
+		indexer.addPath(testDir / "two");
+		(void)indexer.search("STATS");
+		indexer.setTracing(false);
+		(void)indexer.search("TWO");
+
+		std::ostringstream trace;
+		indexer.writeTrace(trace);
+		auto json = trace.str();
+
+		REQUIRE(json.starts_with("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+		REQUIRE(json.find("\"name\":\"getFileTokens\"") != std::string::npos);
+		REQUIRE(json.find("\"name\":\"merge\"") != std::string::npos);
+		auto firstSearch = json.find("\"name\":\"search\"");
+		REQUIRE(firstSearch != std::string::npos);
+		REQUIRE(json.find("\"name\":\"search\"", firstSearch + 1) == std::string::npos);
+	}
+
+	std::filesystem::remove_all(testDir);
+}
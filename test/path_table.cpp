@@ -0,0 +1,108 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "indexer/path_table.h"
+
+TEST_CASE("Path table")
+{
+	Indexer::PathTable paths;
+	paths.insert(0, "/home/user/project/src/main.cpp");
+	paths.insert(1, "/home/user/project/src/util.cpp");
+	paths.insert(2, "/home/user/project/README");
+
+	SECTION("Lookup both ways")
+	{
+		REQUIRE(paths.at("/home/user/project/src/util.cpp") == 1);
+		REQUIRE(paths.path(2) == "/home/user/project/README");
+		REQUIRE_FALSE(paths.contains("/home/user/project/src"));
+		REQUIRE_FALSE(paths.contains("/home/user/project/src/other.cpp"));
+		REQUIRE(paths.size() == 3);
+	}
+
+	SECTION("Moving a directory relocates its contents")
+	{
+		paths.moveDirectory("/home/user/project/src", "/home/user/elsewhere/source");
+		REQUIRE(paths.path(0) == "/home/user/elsewhere/source/main.cpp");
+		REQUIRE(paths.at("/home/user/elsewhere/source/util.cpp") == 1);
+		REQUIRE_FALSE(paths.contains("/home/user/project/src/main.cpp"));
+		REQUIRE(paths.path(2) == "/home/user/project/README");
+	}
+
+	SECTION("Moving onto existing files")
+	{
+		paths.insert(3, "/home/user/backup/src/main.cpp");
+		auto displaced = paths.moveDirectory("/home/user/project/src", "/home/user/backup/src");
+		REQUIRE(displaced == std::vector<Indexer::FileId>{3});
+		REQUIRE(paths.at("/home/user/backup/src/main.cpp") == 0);
+		REQUIRE(paths.path(1) == "/home/user/backup/src/util.cpp");
+
+		REQUIRE(paths.moveFile("/home/user/backup/src/util.cpp", "/home/user/backup/src/main.cpp") == 0);
+		REQUIRE(paths.at("/home/user/backup/src/main.cpp") == 1);
+		REQUIRE_FALSE(paths.contains(Indexer::FileId{0}));
+	}
+
+	SECTION("Remapping ids")
+	{
+		paths.erase(0);
+		REQUIRE_FALSE(paths.contains("/home/user/project/src/main.cpp"));
+
+		paths.remap({Indexer::FileIdAllocator::none, 1, 0});
+		REQUIRE(paths.path(0) == "/home/user/project/README");
+		REQUIRE(paths.at("/home/user/project/src/util.cpp") == 1);
+		REQUIRE(paths.size() == 2);
+	}
+
+	SECTION("Directory order gives each directory an id range")
+	{
+		paths.insert(3, "/home/user/project/src/net/socket.cpp");
+		paths.insert(4, "/home/user/project/NOTES");
+
+		Indexer::FileIdAllocator allocator;
+		for (int i = 0; i < 5; i++)
+		{
+			allocator.allocate();
+		}
+		auto newIds = allocator.compact(paths.directoryOrder());
+		paths.remap(newIds);
+
+		auto src = paths.scope("/home/user/project/src").value();
+		REQUIRE(src.end - src.begin == 3);
+		for (auto fileId = src.begin; fileId < src.end; fileId++)
+		{
+			REQUIRE(paths.isUnder(fileId, src));
+			REQUIRE(paths.path(fileId).string().starts_with("/home/user/project/src/"));
+		}
+		REQUIRE(not paths.isUnder(newIds[2], src));
+		REQUIRE(src.others->empty());
+		REQUIRE_FALSE(paths.scope("/home/user/other"));
+
+		SECTION("Files placed since are listed apart")
+		{
+			paths.insert(5, "/home/user/project/src/new.cpp");
+			auto scope = paths.scope("/home/user/project/src").value();
+			REQUIRE(scope.end - scope.begin == 3);
+			REQUIRE(*scope.others == std::unordered_set<Indexer::FileId>{5});
+			REQUIRE(paths.isUnder(5, scope));
+
+			paths.placeFiles();
+			scope = paths.scope("/home/user/project/src").value();
+			REQUIRE(scope.end == 6);  // stretched to new.cpp, past whatever is in between
+			REQUIRE(scope.others->empty());
+		}
+
+		SECTION("Moved directories widen the range")
+		{
+			paths.moveDirectory("/home/user/project/src/net", "/home/user/net");
+			auto scope = paths.scope("/home/user/net").value();
+			REQUIRE(scope.begin == 0);
+			REQUIRE(scope.end == 5);
+			REQUIRE(paths.isUnder(paths.at("/home/user/net/socket.cpp"), scope));
+			REQUIRE(not paths.isUnder(paths.at("/home/user/project/src/main.cpp"), scope));
+
+			REQUIRE(paths.shouldPlaceFiles());
+			paths.placeFiles();
+			scope = paths.scope("/home/user/net").value();
+			REQUIRE(scope.end - scope.begin == 1);
+			REQUIRE(paths.path(scope.begin) == "/home/user/net/socket.cpp");
+		}
+	}
+}
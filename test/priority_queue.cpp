@@ -0,0 +1,74 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "indexer/priority_queue.h"
+
+TEST_CASE("Priority queue")
+{
+	Indexer::PriorityQueue<int, 3> queue{64};
+
+	SECTION("Serves the most urgent class first")
+	{
+		for (int i = 1; i <= 3; i++)
+		{
+			queue.push(2, 20 + i);
+			queue.push(0, i);
+			queue.push(1, 10 + i);
+		}
+		REQUIRE(queue.size(0) == 3);
+		for (int expected: {1, 2, 3, 11, 12, 13, 21, 22, 23})
+		{
+			REQUIRE(queue.pop() == expected);
+		}
+		REQUIRE(queue.size(2) == 0);
+		REQUIRE_FALSE(queue.tryPop());
+	}
+
+	SECTION("Passed over classes are not starved")
+	{
+		for (int i = 1; i <= 20; i++)
+		{
+			queue.push(0, i);
+			queue.push(2, -i);
+		}
+		for (unsigned round = 1; round <= 2; round++)
+		{
+			for (unsigned i = 0; i < queue.starvationLimit; i++)
+			{
+				REQUIRE(queue.pop() > 0);
+			}
+			REQUIRE(queue.pop() == -static_cast<int>(round));
+		}
+	}
+
+	SECTION("Hands out everything queued before the close, then stops every consumer")
+	{
+		for (int i = 1; i <= 50; i++)
+		{
+			queue.push(static_cast<std::size_t>(i % 3), i);
+		}
+		queue.close();
+
+		std::atomic<int> sum{0};
+		std::vector<std::thread> consumers;
+		for (int c = 0; c < 4; c++)
+		{
+			consumers.emplace_back([&]()
+			{
+				while (auto item = queue.pop())  // 0 once drained
+				{
+					sum += item;
+				}
+			});
+		}
+		for (auto& consumer: consumers)
+		{
+			consumer.join();
+		}
+		REQUIRE(sum == 50 * 51 / 2);
+		REQUIRE(queue.tryPop() == 0);
+	}
+}
@@ -0,0 +1,167 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "indexer/client.h"
+#include "indexer/indexer.h"
+#include "indexer/protocol.h"
+#include "indexer/server.h"
+
+#include "filesystem_utils.h"
+
+TEST_CASE("Protocol")
+{
+	using namespace Indexer::Protocol;
+
+	std::string stream;
+	encode(Request{.id = 7, .opcode = Opcode::Add, .arguments = {"/some/path"}, .isRecursive = true}, stream);
+	encode(Request{.id = 8, .opcode = Opcode::Search, .arguments = {"foo", "", "bar"}}, stream);
+	encode(Response{.id = 8, .opcode = Opcode::Search, .results = {{"/a", "/b"}, {}, {"/c"}}}, stream);
+	encode(Response{.id = 9, .opcode = Opcode::Stats, .status = Status::Error, .message = "no"}, stream);
+
+	std::string_view in = stream;
+	Request request;
+	Response response;
+
+	SECTION("Frames come back as they were sent")
+	{
+		in.remove_prefix(decode(in, request));
+		REQUIRE(request.id == 7);
+		REQUIRE(request.opcode == Opcode::Add);
+		REQUIRE(request.isRecursive);
+		REQUIRE(request.arguments == std::vector<std::string>{"/some/path"});
+
+		in.remove_prefix(decode(in, request));
+		REQUIRE(request.opcode == Opcode::Search);
+		REQUIRE(request.arguments == std::vector<std::string>{"foo", "", "bar"});
+
+		in.remove_prefix(decode(in, response));
+		REQUIRE(response.id == 8);
+		REQUIRE(response.status == Status::Ok);
+		REQUIRE(response.results == std::vector<std::vector<std::string>>{{"/a", "/b"}, {}, {"/c"}});
+
+		in.remove_prefix(decode(in, response));
+		REQUIRE(response.status == Status::Error);
+		REQUIRE(response.message == "no");
+		REQUIRE(in.empty());
+	}
+
+	SECTION("Partial frames wait for the rest")
+	{
+		for (std::size_t size = 0; size < 12; size++)
+		{
+			REQUIRE(decode(in.substr(0, size), request) == 0);
+		}
+	}
+
+	SECTION("Malformed frames are rejected")
+	{
+		auto corrupt = stream;
+		corrupt[8] = 42;  // opcode
+		REQUIRE_THROWS_AS(decode(corrupt, request), ProtocolError);
+
+		corrupt = stream;
+		corrupt[0] += 1;  // the frame claims a byte that belongs to the next one
+		REQUIRE_THROWS_AS(decode(corrupt, request), ProtocolError);
+
+		REQUIRE_THROWS_AS(decode(std::string{"\xff\xff\xff\xff", 4}, request), ProtocolError);  // too large
+	}
+}
+
+TEST_CASE("Index server")
+{
+	auto testDir = std::filesystem::current_path() / "__test_server_dir";
+	std::filesystem::create_directories(testDir / "sub");
+	write(testDir / "a", "alpha common\n");
+	write(testDir / "sub" / "b", "beta common\n");
+	auto socketPath = std::filesystem::current_path() / "__test_server.sock";
+
+	Indexer::Indexer indexer;
+	Indexer::Server server{indexer, socketPath};
+	std::thread serving{[&server]() { server.run(); }};
+
+	SECTION("Answers adds, searches and stats")
+	{
+		Indexer::Client client{socketPath};
+		client.add(testDir, true);
+		auto results = client.search({"common", "beta", "missing"});
+		REQUIRE(results.size() == 3);
+		REQUIRE(results[0].size() == 2);
+		REQUIRE(results[1] == std::vector<std::string>{(testDir / "sub" / "b").string()});
+		REQUIRE(results[2].empty());
+		REQUIRE(client.stats().find("index: 2 files") != std::string::npos);
+	}
+
+	SECTION("Rejects adds of empty and relative paths")
+	{
+		Indexer::Client client{socketPath};
+		REQUIRE_THROWS(client.add(""));
+		REQUIRE_THROWS(client.add("sub", true));
+		REQUIRE(client.search({"common"}) == std::vector<std::vector<std::string>>{{}});
+	}
+
+	SECTION("Answers pipelined requests from many clients")
+	{
+		indexer.addPath(testDir, Indexer::Recursive::Yes);
+
+		std::vector<std::thread> clients;
+		std::vector<std::size_t> answered(8, 0);
+		for (std::size_t c = 0; c < answered.size(); c++)
+		{
+			clients.emplace_back([&, c]()
+			{
+				Indexer::Client client{socketPath};
+				std::vector<std::uint32_t> ids;
+				for (int i = 0; i < 500; i++)
+				{
+					ids.push_back(client.send({.opcode = Indexer::Protocol::Opcode::Search, .arguments = {"alpha", "common"}}));
+				}
+				for (auto id: ids)
+				{
+					auto response = client.receive();
+					if (response.id == id && response.results.size() == 2 && response.results[1].size() == 2)
+					{
+						answered[c]++;
+					}
+				}
+			});
+		}
+		for (auto& client: clients)
+		{
+			client.join();
+		}
+		for (auto count: answered)
+		{
+			REQUIRE(count == 500);
+		}
+	}
+
+	SECTION("Drops clients that send garbage, and only them")
+	{
+		Indexer::Client client{socketPath};
+
+		auto garbage = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		socketPath.native().copy(address.sun_path, sizeof(address.sun_path) - 1);
+		REQUIRE(connect(garbage, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) == 0);
+		std::string frame{"\x05\x00\x00\x00\x01\x00\x00\x00\x2a", 9};  // unknown opcode
+		REQUIRE(::send(garbage, frame.data(), frame.size(), 0) == static_cast<ssize_t>(frame.size()));
+		char byte;
+		REQUIRE(recv(garbage, &byte, 1, 0) == 0);  // closed on us
+		close(garbage);
+
+		REQUIRE(client.search({"alpha"}).size() == 1);
+	}
+
+	server.requestStop();
+	serving.join();
+	std::filesystem::remove_all(testDir);
+}
@@ -0,0 +1,68 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "indexer/token_list.h"
+
+namespace
+{
+std::vector<std::string> contents(Indexer::TokenList const& list)
+{
+	return {list.begin(), list.end()};
+}
+}
+
+TEST_CASE("Token lists")
+{
+	Indexer::TokenCollector collector;
+
+	SECTION("Distinct tokens, sorted")
+	{
+		for (auto token: {"b", "a", "c", "a", "", "b"})
+		{
+			collector.insert(token);
+		}
+		REQUIRE(collector.size() == 4);
+
+		auto list = collector.take();
+		REQUIRE(contents(list) == std::vector<std::string>{"", "a", "b", "c"});
+		REQUIRE(list.contains("a"));
+		REQUIRE(list.contains(""));
+		REQUIRE(not list.contains("d"));
+		REQUIRE(not list.contains("aa"));
+	}
+
+	SECTION("Reused from one file to the next")
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			collector.insert("token" + std::to_string(i % 700));
+		}
+		REQUIRE(collector.take().size() == 700);
+		REQUIRE(collector.size() == 0);
+
+		collector.insert("token1");
+		collector.insert("other");
+		REQUIRE(contents(collector.take()) == std::vector<std::string>{"other", "token1"});
+		REQUIRE(collector.take().empty());
+	}
+
+	SECTION("Merging")
+	{
+		for (auto token: {"a", "c", "e"})
+		{
+			collector.insert(token);
+		}
+		auto first = collector.take();
+		for (auto token: {"b", "c", "f"})
+		{
+			collector.insert(token);
+		}
+		auto second = collector.take();
+
+		REQUIRE(contents(Indexer::TokenList::merged(first, second)) == std::vector<std::string>{"a", "b", "c", "e", "f"});
+		REQUIRE(contents(Indexer::TokenList::merged(first, {})) == contents(first));
+	}
+}
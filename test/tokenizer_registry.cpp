@@ -0,0 +1,81 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <thread>
+
+#include "indexer/indexer.h"
+#include "indexer/tokenizer_registry.h"
+#include "indexer/unicode_tokenizer.h"
+
+#include "filesystem_utils.h"
+
+TEST_CASE("Tokenizer registry")
+{
+	SECTION("Patterns, then sniffers, then the fallback")
+	{
+		Indexer::TokenizerRegistry registry;
+		registry.add("*.cpp", Indexer::TokenizerRegistry::factoryOf(Indexer::IdentifierTokenizer{}));
+		registry.add("docs/**", Indexer::TokenizerRegistry::factoryOf(Indexer::UnicodeTokenizer{}));
+		registry.add([](std::string_view contents) { return contents.starts_with("#!"); },
+			Indexer::TokenizerRegistry::factoryOf(Indexer::IdentifierTokenizer{}));
+
+		REQUIRE(registry.select("src/main.cpp", "#!") == 1);
+		REQUIRE(registry.select("docs/guide/intro.md", "") == 2);
+		REQUIRE(registry.select("bin/run", "#!/bin/sh\n") == 3);
+		REQUIRE(registry.select("notes.txt", "plain\n") == 0);
+	}
+
+	SECTION("Each thread reuses its own instances")
+	{
+		auto registry = Indexer::TokenizerRegistry::sourceCode();
+		auto* mine = &registry.get(1);
+		REQUIRE(&registry.get(1) == mine);
+		REQUIRE(&registry.get(0) != mine);
+
+		Indexer::Tokenizer* theirs = nullptr;
+		std::thread{[&]() { theirs = &registry.get(1); }}.join();
+		REQUIRE(theirs != mine);
+
+		Indexer::TokenizerRegistry other;
+		REQUIRE(&other.get(0) != &registry.get(0));
+	}
+
+	SECTION("Needles are normalized for each tokenizer")
+	{
+		Indexer::TokenizerRegistry registry;
+		registry.add("*.md", Indexer::TokenizerRegistry::factoryOf(Indexer::UnicodeTokenizer{}));
+		auto needles = registry.normalize("Word");
+		REQUIRE(needles.size() == 2);
+		REQUIRE(needles[0].term == "Word");
+		REQUIRE(needles[0].tokenizers == std::vector<Indexer::TokenizerRegistry::Index>{0});
+		REQUIRE(needles[1].term == "word");
+		REQUIRE(needles[1].tokenizers == std::vector<Indexer::TokenizerRegistry::Index>{1});
+
+		needles = registry.normalize("word");
+		REQUIRE(needles.size() == 1);
+		REQUIRE(needles[0].tokenizers == std::vector<Indexer::TokenizerRegistry::Index>{0, 1});
+	}
+}
+
+TEST_CASE("Tokenizers by file type")
+{
+	auto testDir = std::filesystem::current_path() / "__test_file_types";
+	std::filesystem::create_directory(testDir);
+	write(testDir / "main.cpp", "int snake_case_name;\n");
+	write(testDir / "notes.txt", "int snake_case_name;\n");
+	write(testDir / "script", "#!/bin/sh\nrun_all\n");
+
+	Indexer::Indexer indexer{Indexer::TokenizerRegistry::sourceCode()};
+	indexer.addPath(testDir, Indexer::Recursive::Yes);
+
+	REQUIRE(indexer.search("snake_case_name") == Indexer::PathSet{testDir / "main.cpp"});
+	REQUIRE(indexer.search("snake") == Indexer::PathSet{testDir / "notes.txt"});  // the same contents, tokenized apart
+	REQUIRE(indexer.search("run_all").contains(testDir / "script"));
+
+	write(testDir / "main.cpp", "int snake_case_name;\nint other_name;\n");
+	indexer.addPath(testDir / "main.cpp");
+	REQUIRE(indexer.search("other_name").contains(testDir / "main.cpp"));
+
+	std::filesystem::remove_all(testDir);
+}
@@ -0,0 +1,109 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "indexer/indexer.h"
+#include "indexer/unicode.h"
+#include "indexer/unicode_tokenizer.h"
+
+#include "filesystem_utils.h"
+
+namespace
+{
+std::vector<std::string> tokens(Indexer::UnicodeTokenizer& tokenizer, std::string_view line)
+{
+	std::vector<std::string> result;
+	tokenizer.sendLine(line);
+	while (not tokenizer.done())
+	{
+		result.emplace_back(tokenizer.next());
+	}
+	return result;
+}
+}
+
+TEST_CASE("Unicode tables")
+{
+	static_assert(Indexer::Unicode::isWordCharacter(U'z'));
+	static_assert(Indexer::Unicode::isWordCharacter(U'é'));
+	static_assert(Indexer::Unicode::isWordCharacter(U'ж'));
+	static_assert(Indexer::Unicode::isWordCharacter(U'中'));
+	static_assert(Indexer::Unicode::isWordCharacter(U'٣'));
+	static_assert(not Indexer::Unicode::isWordCharacter(U' '));
+	static_assert(not Indexer::Unicode::isWordCharacter(U'—'));
+	static_assert(not Indexer::Unicode::isWordCharacter(U'😀'));
+
+	static_assert(Indexer::Unicode::foldCase(U'Q') == U'q');
+	static_assert(Indexer::Unicode::foldCase(U'Ä') == U'ä');
+	static_assert(Indexer::Unicode::foldCase(U'Ж') == U'ж');
+	static_assert(Indexer::Unicode::foldCase(U'Σ') == U'σ');
+	static_assert(Indexer::Unicode::foldCase(U'ς') == U'σ');
+	static_assert(Indexer::Unicode::foldCase(U'Ŋ') == U'ŋ');
+	static_assert(Indexer::Unicode::foldCase(U'ŋ') == U'ŋ');
+	static_assert(Indexer::Unicode::foldCase(U'中') == U'中');
+
+	std::size_t position = 0;
+	REQUIRE(Indexer::Unicode::decode("\xC3\xA9", position) == U'é');
+	REQUIRE(position == 2);
+	position = 0;
+	REQUIRE(Indexer::Unicode::decode("\xC0\xAF", position) == Indexer::Unicode::invalid);  // overlong
+	REQUIRE(position == 1);
+	position = 0;
+	REQUIRE(Indexer::Unicode::decode("\xED\xA0\x80", position) == Indexer::Unicode::invalid);  // surrogate
+	position = 0;
+	REQUIRE(Indexer::Unicode::decode("\xE4\xB8", position) == Indexer::Unicode::invalid);  // truncated
+}
+
+TEST_CASE("Unicode tokenizer")
+{
+	Indexer::UnicodeTokenizer tokenizer;
+
+	SECTION("Words in any script")
+	{
+		REQUIRE(tokens(tokenizer, "naïve café, 中文 — слово") == std::vector<std::string>{"naïve", "café", "中文", "слово"});
+		REQUIRE(tokens(tokenizer, "x1 = y_2;") == std::vector<std::string>{"x1", "y", "2"});
+		REQUIRE(tokens(tokenizer, "").empty());
+		REQUIRE(tokens(tokenizer, " \t ").empty());
+	}
+
+	SECTION("Case folding")
+	{
+		REQUIRE(tokens(tokenizer, "Hello WORLD") == std::vector<std::string>{"hello", "world"});
+		REQUIRE(tokens(tokenizer, "ÉCOLE Привет ΣΟΦΟΣ") == std::vector<std::string>{"école", "привет", "σοφοσ"});
+
+		Indexer::UnicodeTokenizer preserving{{.foldCase = false}};
+		REQUIRE(tokens(preserving, "Hello ÉCOLE") == std::vector<std::string>{"Hello", "ÉCOLE"});
+	}
+
+	SECTION("Malformed UTF-8 separates words")
+	{
+		REQUIRE(tokens(tokenizer, "one\xFFtwo\xC3") == std::vector<std::string>{"one", "two"});
+		REQUIRE(tokens(tokenizer, "\xE2\x82word") == std::vector<std::string>{"word"});
+	}
+
+	SECTION("Overlong tokens are dropped")
+	{
+		Indexer::UnicodeTokenizer limited{{.foldCase = true, .maxTokenBytes = 4}};
+		REQUIRE(tokens(limited, "abcd abcde ÄÖ ÄÖÜ") == std::vector<std::string>{"abcd", "äö"});
+	}
+
+	SECTION("Needles are normalized like tokens")
+	{
+		REQUIRE(tokenizer.normalize("ΣΟΦΟΣ") == "σοφοσ");
+		REQUIRE(tokenizer.normalize("ascii") == "ascii");
+
+		auto test = std::filesystem::current_path() / "__test_unicode";
+		write(test, "Größe ΠΟΛΗ\n");
+		Indexer::Indexer indexer{Indexer::UnicodeTokenizer{}};
+		indexer.addPath(test);
+
+		REQUIRE(indexer.search("GRÖSSE").empty());  // simple folding, ß stays
+		REQUIRE(indexer.search("GRÖßE").contains(test));
+		REQUIRE(indexer.search("größe").contains(test));
+		REQUIRE(indexer.search("πολη").contains(test));
+		std::filesystem::remove(test);
+	}
+}
@@ -0,0 +1,277 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "indexer/indexer.h"
+#include "indexer/write_ahead_log.h"
+
+#include "filesystem_utils.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+using Change = Indexer::WriteAheadLog::Change;
+
+Change indexed(std::string path, std::vector<std::string_view> tokens)
+{
+	return {
+		.type = Change::Type::Indexed,
+		.path = std::move(path),
+		.size = 42,
+		.lastWriteTime = -7,
+		.indexedAt = 1234567890123,
+		.contentHash = 0xfedcba9876543210,
+		.tokenizer = 1,
+		.tokens = std::make_shared<Indexer::TokenList>(Indexer::TokenList::fromSorted(tokens)),
+	};
+}
+
+std::vector<Change> replayed(std::filesystem::path const& file, std::uint64_t afterSequence = 0)
+{
+	Indexer::WriteAheadLog log{file};
+	std::vector<Change> changes;
+	log.replay(afterSequence, [&](Change change) { changes.push_back(std::move(change)); });
+	return changes;
+}
+
+std::vector<std::string> paths(std::vector<Change> const& changes)
+{
+	std::vector<std::string> paths;
+	for (auto const& change: changes)
+	{
+		paths.push_back(change.path);
+	}
+	return paths;
+}
+
+void flipByte(std::filesystem::path const& file, std::uintmax_t offset)
+{
+	std::fstream f{file, std::ios::binary | std::ios::in | std::ios::out};
+	f.seekg(static_cast<std::streamoff>(offset));
+	auto c = static_cast<char>(f.get());
+	f.seekp(static_cast<std::streamoff>(offset));
+	f.put(static_cast<char>(~c));
+}
+
+void makeOld(std::filesystem::path const& file)
+{
+	std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now() - 1h);  // trusted by stat
+}
+}
+
+TEST_CASE("Write-ahead log")
+{
+	auto file = std::filesystem::current_path() / "__test_wal";
+	std::filesystem::remove(file);
+
+	SECTION("Changes replay in order")
+	{
+		{
+			Indexer::WriteAheadLog log{file};
+			REQUIRE(log.append(indexed("a", {"alpha", "alphabet", "beta"})) == 1);
+			REQUIRE(log.append({.type = Change::Type::Removed, .path = "b"}) == 2);
+			REQUIRE(log.append({.type = Change::Type::Moved, .path = "c", .target = "d", .isDirectory = true}) == 3);
+		}
+
+		auto changes = replayed(file);
+		REQUIRE(changes.size() == 3);
+		REQUIRE(changes[0].type == Change::Type::Indexed);
+		REQUIRE(changes[0].path == "a");
+		REQUIRE(changes[0].size == 42);
+		REQUIRE(changes[0].lastWriteTime == -7);
+		REQUIRE(changes[0].indexedAt == 1234567890123);
+		REQUIRE(changes[0].contentHash == 0xfedcba9876543210);
+		REQUIRE(changes[0].tokenizer == 1);
+		REQUIRE(std::vector<std::string>{changes[0].tokens->begin(), changes[0].tokens->end()} == std::vector<std::string>{"alpha", "alphabet", "beta"});
+		REQUIRE(changes[1].type == Change::Type::Removed);
+		REQUIRE(changes[1].path == "b");
+		REQUIRE(changes[2].type == Change::Type::Moved);
+		REQUIRE(changes[2].target == "d");
+		REQUIRE(changes[2].isDirectory);
+
+		REQUIRE(paths(replayed(file, 2)) == std::vector<std::string>{"c"});
+		REQUIRE(Indexer::WriteAheadLog{file}.lastSequence() == 3);
+	}
+
+	SECTION("A torn tail is cut off")
+	{
+		{
+			Indexer::WriteAheadLog log{file};
+			log.append(indexed("a", {"alpha"}));
+			log.append(indexed("b", {"beta"}));
+		}
+		std::filesystem::resize_file(file, std::filesystem::file_size(file) - 3);
+
+		{
+			Indexer::WriteAheadLog log{file};
+			REQUIRE(log.lastSequence() == 1);
+			REQUIRE(log.append(indexed("c", {"gamma"})) == 2);
+		}
+		REQUIRE(paths(replayed(file)) == std::vector<std::string>{"a", "c"});
+	}
+
+	SECTION("Replay stops at a corrupt record")
+	{
+		std::uintmax_t firstEnd = 0;
+		{
+			Indexer::WriteAheadLog log{file};
+			log.append(indexed("a", {"alpha"}));
+			log.sync();
+			firstEnd = std::filesystem::file_size(file);
+			log.append(indexed("b", {"beta"}));
+			log.append(indexed("c", {"gamma"}));
+		}
+		flipByte(file, firstEnd + 20);
+
+		REQUIRE(paths(replayed(file)) == std::vector<std::string>{"a"});
+		REQUIRE(Indexer::WriteAheadLog{file}.lastSequence() == 1);
+	}
+
+	SECTION("Truncation keeps the records after it")
+	{
+		{
+			Indexer::WriteAheadLog log{file};
+			log.append(indexed("a", {"alpha"}));
+			log.append(indexed("b", {"beta"}));
+			log.append(indexed("c", {"gamma"}));
+			log.truncateThrough(2);
+			REQUIRE(log.append(indexed("d", {"delta"})) == 4);
+		}
+		REQUIRE(paths(replayed(file)) == std::vector<std::string>{"c", "d"});
+
+		{
+			Indexer::WriteAheadLog log{file};
+			log.truncateThrough(10);  // e.g. the log was lost, but not the snapshot
+			REQUIRE(log.lastSequence() == 10);
+			REQUIRE(log.append(indexed("e", {"epsilon"})) == 11);
+		}
+		REQUIRE(paths(replayed(file)) == std::vector<std::string>{"e"});
+		REQUIRE(paths(replayed(file, 11)).empty());
+	}
+
+	SECTION("Refuse files that aren't logs")
+	{
+		write(file, "not a write-ahead log, but long enough for a header\n");
+		REQUIRE_THROWS(Indexer::WriteAheadLog{file});
+	}
+
+	std::filesystem::remove(file);
+}
+
+TEST_CASE("Persisted index")
+{
+	auto testDir = std::filesystem::current_path() / "__test_persisted_dir";
+	std::filesystem::create_directory(testDir);
+	auto snapshotFile = std::filesystem::current_path() / "__test_persisted";
+	auto logFile = std::filesystem::current_path() / "__test_persisted.wal";
+	std::filesystem::remove(snapshotFile);
+	std::filesystem::remove(logFile);
+
+	write(testDir / "a", "alpha common\n");
+	write(testDir / "b", "beta common\n");
+	write(testDir / "c", "gamma\n");
+	for (auto file: {"a", "b", "c"})
+	{
+		makeOld(testDir / file);
+	}
+	{
+		Indexer::Indexer indexer;
+		indexer.persist(snapshotFile);
+		indexer.addPath(testDir, Indexer::Recursive::Yes);
+	}
+
+	SECTION("Restored from the log")
+	{
+		Indexer::Indexer restored;
+		restored.persist(snapshotFile);
+		REQUIRE(restored.search("common") == Indexer::PathSet{testDir / "a", testDir / "b"});
+		REQUIRE(restored.search("gamma") == Indexer::PathSet{testDir / "c"});
+		REQUIRE(restored.stats().indexedFiles == 3);
+	}
+
+	SECTION("Restored from a snapshot and the changes after it")
+	{
+		{
+			Indexer::Indexer indexer;
+			indexer.persist(snapshotFile);
+			indexer.addPath(testDir, Indexer::Recursive::Yes);
+			indexer.publishSnapshot(snapshotFile);
+			REQUIRE(replayed(logFile).empty());
+
+			write(testDir / "d", "delta common\n");
+			write(testDir / "b", "beta changed\n");
+			indexer.addPath(testDir, Indexer::Recursive::Yes);
+		}
+
+		Indexer::Indexer restored;
+		restored.persist(snapshotFile);
+		REQUIRE(restored.search("common") == Indexer::PathSet{testDir / "a", testDir / "d"});
+		REQUIRE(restored.search("changed") == Indexer::PathSet{testDir / "b"});
+		REQUIRE(restored.search("gamma") == Indexer::PathSet{testDir / "c"});
+	}
+
+	SECTION("The log is kept when the snapshot can't be written")
+	{
+		auto temporary = snapshotFile;
+		temporary += ".tmp";
+		std::filesystem::create_directory(temporary);  // where the snapshot is written first
+		{
+			Indexer::Indexer indexer;
+			indexer.persist(snapshotFile);
+			REQUIRE_THROWS(indexer.publishSnapshot(snapshotFile));
+		}
+		std::filesystem::remove(temporary);
+		REQUIRE_FALSE(std::filesystem::exists(snapshotFile));
+		REQUIRE(replayed(logFile).size() == 3);
+
+		Indexer::Indexer restored;
+		restored.persist(snapshotFile);
+		REQUIRE(restored.search("common") == Indexer::PathSet{testDir / "a", testDir / "b"});
+	}
+
+	SECTION("Only files changed meanwhile are read again")
+	{
+		write(testDir / "b", "beta changed\n");
+		std::filesystem::remove(testDir / "c");
+
+		Indexer::Indexer restored;
+		restored.persist(snapshotFile);
+		REQUIRE(restored.search("gamma").empty());  // deleted while nobody was watching
+
+		restored.addPath(testDir, Indexer::Recursive::Yes);
+		REQUIRE(restored.stats().bytesTokenized == std::string{"beta changed\n"}.size());
+		REQUIRE(restored.search("common") == Indexer::PathSet{testDir / "a"});
+		REQUIRE(restored.search("changed") == Indexer::PathSet{testDir / "b"});
+	}
+
+	SECTION("Moves and deletions are logged")
+	{
+		{
+			Indexer::Indexer indexer;
+			indexer.persist(snapshotFile);
+			indexer.addPath(testDir, Indexer::Recursive::Yes);
+			std::filesystem::rename(testDir / "a", testDir / "moved");
+			std::filesystem::remove(testDir / "b");
+			std::this_thread::sleep_for(50ms);  // allow the watcher to catch up
+		}
+		auto changes = replayed(logFile);
+		REQUIRE(changes.size() == 5);
+		REQUIRE(changes[3].type == Change::Type::Moved);
+		REQUIRE(changes[4].type == Change::Type::Removed);
+
+		Indexer::Indexer restored;
+		restored.persist(snapshotFile);
+		REQUIRE(restored.search("alpha") == Indexer::PathSet{testDir / "moved"});
+		REQUIRE(restored.search("beta").empty());
+	}
+
+	std::filesystem::remove(snapshotFile);
+	std::filesystem::remove(logFile);
+	std::filesystem::remove_all(testDir);
+}